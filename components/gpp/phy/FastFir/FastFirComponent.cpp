@@ -0,0 +1,176 @@
+/**
+ * \file components/gpp/phy/FastFir/FastFirComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the FastFir component.
+ */
+
+#include "FastFirComponent.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "irisapi/LibraryDefs.h"
+#include "irisapi/Version.h"
+
+using namespace std;
+
+namespace iris
+{
+namespace phy
+{
+
+// export library symbols
+IRIS_COMPONENT_EXPORTS(PhyComponent, FastFirComponent);
+
+FastFirComponent::FastFirComponent(std::string name)
+  : PhyComponent(name,                          // component name
+                "fastfir",                      // component type
+                "An FIR filter using fast convolution for long filters",
+                "Paul Sutton",                  // author
+                "1.0")                          // version
+{
+  registerParameter(
+    "coeffs", "Filter taps, separated by spaces or commas",
+    "1", true, coeffs_x);
+
+  registerParameter(
+    "coeffsfile", "Text file of filter taps, used instead of coeffs if set",
+    "", true, coeffsFile_x);
+
+  string methods[] = {"auto", "direct", "fft"};
+  registerParameter(
+    "method", "Convolution method (auto, direct or fft)",
+    "auto", true, method_x, list<string>(begin(methods),end(methods)));
+
+  registerParameter(
+    "blocklength", "Typical number of samples per input DataSet (0 if "
+    "unknown), used to choose the convolution method",
+    "0", true, blockLength_x, Interval<int>(0,16777216));
+
+  string rigors[] = {"estimate", "measure", "patient", "exhaustive"};
+  registerParameter(
+    "fftplanning", "Rigor of fft planning (estimate, measure, patient or "
+    "exhaustive)",
+    "measure", false, fftPlanning_x, list<string>(begin(rigors),end(rigors)));
+
+  registerParameter(
+    "wisdomfile", "File used to store fftw wisdom across runs (empty for none)",
+    "", false, wisdomFile_x);
+}
+
+void FastFirComponent::registerPorts()
+{
+  registerInputPort("input1", TypeInfo< complex<float> >::identifier);
+  registerOutputPort("output1", TypeInfo< complex<float> >::identifier);
+}
+
+void FastFirComponent::calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes)
+{
+  outputTypes["output1"] = TypeInfo< complex<float> >::identifier;
+}
+
+void FastFirComponent::initialize()
+{
+  setup();
+}
+
+void FastFirComponent::process()
+{
+  DataSet< Cplx >* in = NULL;
+  DataSet< Cplx >* out = NULL;
+  getInputDataSet("input1", in);
+  getOutputDataSet("output1", out, in->data.size());
+  out->timeStamp = in->timeStamp;
+  out->sampleRate = in->sampleRate;
+
+  filter_.filter(in->data.begin(), in->data.end(), out->data.begin());
+
+  releaseInputDataSet("input1", in);
+  releaseOutputDataSet("output1", out);
+}
+
+void FastFirComponent::parameterHasChanged(std::string name)
+{
+  if(name == "coeffs" || name == "coeffsfile" || name == "method" ||
+     name == "blocklength")
+    setup();
+}
+
+FastFirComponent::FloatVec FastFirComponent::parseCoeffs(const string& text)
+{
+  string spaced(text);
+  replace(spaced.begin(), spaced.end(), ',', ' ');
+  istringstream ss(spaced);
+  FloatVec coeffs;
+  float c;
+  while(ss >> c)
+    coeffs.push_back(c);
+  if(!ss.eof())
+    throw IrisException("Failed to parse filter taps: " + text);
+  if(coeffs.empty())
+    throw IrisException("No filter taps given.");
+  return coeffs;
+}
+
+/// Read our taps and create the filter.
+void FastFirComponent::setup()
+{
+  FloatVec coeffs;
+  if(coeffsFile_x.empty())
+  {
+    coeffs = parseCoeffs(coeffs_x);
+  }
+  else
+  {
+    ifstream file(coeffsFile_x.c_str());
+    if(!file.is_open())
+      throw IrisException("Failed to open filter tap file: " + coeffsFile_x);
+    string text((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    coeffs = parseCoeffs(text);
+  }
+
+  FastFirFilter<float>::Method method = FastFirFilter<float>::AUTO;
+  if(method_x == "direct")
+    method = FastFirFilter<float>::DIRECT;
+  else if(method_x == "fft")
+    method = FastFirFilter<float>::FFT;
+
+  filter_.setCoeffs(coeffs.begin(), coeffs.end(), blockLength_x, method,
+                    fftPlanning_x, wisdomFile_x);
+  LOG(LINFO) << "Filtering with " << coeffs.size() << " taps, "
+             << (filter_.usesFft() ? "fft" : "direct") << " convolution";
+}
+
+} // namespace phy
+} // namespace iris
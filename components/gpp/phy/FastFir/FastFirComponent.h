@@ -0,0 +1,107 @@
+/**
+ * \file components/gpp/phy/FastFir/FastFirComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * An FIR filter component for long filters, using fft-based fast
+ * convolution where it needs fewer operations than direct filtering.
+ */
+
+#ifndef PHY_FASTFIRCOMPONENT_H_
+#define PHY_FASTFIRCOMPONENT_H_
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include "irisapi/PhyComponent.h"
+#include "utility/FastFirFilter.h"
+
+namespace iris
+{
+namespace phy
+{
+
+/** An FIR filter component for long filters, e.g. channel selection.
+ *
+ * Filters a stream of complex<float> samples with real taps given by
+ * the coeffs parameter, or read from the text file coeffsfile. Taps are
+ * separated by spaces, commas or new lines. Filtering is continuous
+ * across DataSets and each output DataSet has the size, time stamp and
+ * sample rate of its input.
+ *
+ * By default overlap-save fast convolution is used when it needs fewer
+ * operations than direct filtering, given the number of taps and the
+ * blocklength. See FastFirFilter for details.
+ */
+class FastFirComponent
+  : public PhyComponent
+{
+ public:
+  typedef std::complex<float>   Cplx;
+  typedef std::vector<Cplx>     CplxVec;
+  typedef std::vector<float>    FloatVec;
+
+  FastFirComponent(std::string name);
+  virtual void calculateOutputTypes(
+      std::map<std::string, int>& inputTypes,
+      std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+  virtual void parameterHasChanged(std::string name);
+
+  /** Parse a list of taps.
+   *
+   * @param text  Taps separated by spaces, commas or new lines.
+   * @return      The taps.
+   */
+  static FloatVec parseCoeffs(const std::string& text);
+
+ private:
+  void setup();
+
+  std::string coeffs_x;       ///< Filter taps (default = 1)
+  std::string coeffsFile_x;   ///< Text file of filter taps, used if set (default = none)
+  std::string method_x;       ///< auto, direct or fft (default = auto)
+  int blockLength_x;          ///< Typical samples per DataSet, 0 if unknown (default = 0)
+  std::string fftPlanning_x;  ///< Rigor of fft planning (default = measure)
+  std::string wisdomFile_x;   ///< File used to store fftw wisdom (default = none)
+
+  FastFirFilter<float> filter_; ///< Our filter.
+
+  template <typename T, size_t N>
+  static T* begin(T(&arr)[N]) { return &arr[0]; }
+  template <typename T, size_t N>
+  static T* end(T(&arr)[N]) { return &arr[0]+N; }
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_FASTFIRCOMPONENT_H_
@@ -0,0 +1,188 @@
+/**
+ * \file components/gpp/phy/FastFir/test/FastFirComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for FastFir component.
+ */
+
+#define BOOST_TEST_MODULE FastFirComponent_Test
+
+#include <boost/test/unit_test.hpp>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+#include "../FastFirComponent.h"
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+typedef complex<float> Cplx;
+
+/// Filter numSets DataSets of setSize samples and check the outputs
+/// against a direct form filter.
+static void checkFilter(FastFirComponent& mod, const vector<float>& coeffs,
+                        int numSets, int setSize)
+{
+  mod.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< Cplx > out;
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  vector<Cplx> input(numSets*setSize);
+  for(size_t i=0; i<input.size(); i++)
+    input[i] = Cplx(rand()/(float)RAND_MAX-0.5f, rand()/(float)RAND_MAX-0.5f);
+
+  vector<Cplx> output;
+  for(int s=0; s<numSets; s++)
+  {
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, setSize);
+    copy(input.begin()+s*setSize, input.begin()+(s+1)*setSize,
+         iSet->data.begin());
+    iSet->timeStamp = s;
+    iSet->sampleRate = 1e6;
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(mod.process());
+
+    DataSet< Cplx >* oSet = NULL;
+    out.getReadData(oSet);
+    BOOST_REQUIRE(oSet->data.size() == setSize);
+    BOOST_CHECK(oSet->timeStamp == s);
+    BOOST_CHECK(oSet->sampleRate == 1e6);
+    output.insert(output.end(), oSet->data.begin(), oSet->data.end());
+    out.releaseReadData(oSet);
+  }
+
+  for(size_t n=0; n<input.size(); n++)
+  {
+    Cplx ref(0,0);
+    for(size_t k=0; k<coeffs.size() && k<=n; k++)
+      ref += input[n-k]*coeffs[k];
+    BOOST_CHECK_SMALL(abs(output[n]-ref), 1e-4f);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE (FastFirComponent_Test)
+
+BOOST_AUTO_TEST_CASE(FastFirComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(FastFirComponent mod("test"));
+}
+
+BOOST_AUTO_TEST_CASE(FastFirComponent_Parm_Test)
+{
+  FastFirComponent mod("test");
+  BOOST_CHECK(mod.getParameterDefaultValue("coeffs") == "1");
+  BOOST_CHECK(mod.getParameterDefaultValue("coeffsfile") == "");
+  BOOST_CHECK(mod.getParameterDefaultValue("method") == "auto");
+  BOOST_CHECK(mod.getParameterDefaultValue("blocklength") == "0");
+}
+
+BOOST_AUTO_TEST_CASE(FastFirComponent_Ports_Test)
+{
+  FastFirComponent mod("test");
+  BOOST_REQUIRE_NO_THROW(mod.registerPorts());
+
+  vector<Port> iPorts = mod.getInputPorts();
+  BOOST_REQUIRE(iPorts.size() == 1);
+  BOOST_REQUIRE(iPorts.front().portName == "input1");
+  BOOST_REQUIRE(iPorts.front().supportedTypes.front() ==
+      TypeInfo< complex<float> >::identifier);
+
+  vector<Port> oPorts = mod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 1);
+  BOOST_REQUIRE(oPorts.front().portName == "output1");
+  BOOST_REQUIRE(oPorts.front().supportedTypes.front() ==
+      TypeInfo< complex<float> >::identifier);
+}
+
+BOOST_AUTO_TEST_CASE(FastFirComponent_ParseCoeffs_Test)
+{
+  vector<float> c = FastFirComponent::parseCoeffs("0.5, -1 2e-1\n3");
+  BOOST_REQUIRE(c.size() == 4);
+  BOOST_CHECK(c[0] == 0.5f);
+  BOOST_CHECK(c[1] == -1.0f);
+  BOOST_CHECK(c[2] == 0.2f);
+  BOOST_CHECK(c[3] == 3.0f);
+  BOOST_CHECK_THROW(FastFirComponent::parseCoeffs("1, x"), IrisException);
+  BOOST_CHECK_THROW(FastFirComponent::parseCoeffs(" "), IrisException);
+}
+
+BOOST_AUTO_TEST_CASE(FastFirComponent_Process_Test)
+{
+  // Short and long filters, with DataSets shorter and longer than a block
+  int lengths[] = {5, 200};
+  int setSizes[] = {100, 5000};
+  for(int i=0; i<2; i++)
+  {
+    for(int j=0; j<2; j++)
+    {
+      vector<float> coeffs(lengths[i]);
+      stringstream ss;
+      for(int k=0; k<lengths[i]; k++)
+      {
+        coeffs[k] = (k%7)/7.0f - 0.4f;
+        ss << coeffs[k] << ",";
+      }
+      FastFirComponent mod("test");
+      mod.setValue("coeffs", ss.str());
+      mod.setValue("fftplanning", string("estimate"));
+      checkFilter(mod, coeffs, 4, setSizes[j]);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FastFirComponent_CoeffsFile_Test)
+{
+  vector<float> coeffs(300);
+  {
+    ofstream file("FastFirComponent_test_coeffs.txt");
+    for(int k=0; k<300; k++)
+    {
+      coeffs[k] = ((k*13)%11)/11.0f - 0.5f;
+      file << coeffs[k] << "\n";
+    }
+  }
+  FastFirComponent mod("test");
+  mod.setValue("coeffsfile", string("FastFirComponent_test_coeffs.txt"));
+  mod.setValue("method", string("fft"));
+  mod.setValue("fftplanning", string("estimate"));
+  checkFilter(mod, coeffs, 3, 1000);
+  remove("FastFirComponent_test_coeffs.txt");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
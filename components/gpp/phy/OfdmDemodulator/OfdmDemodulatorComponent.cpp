@@ -41,20 +41,60 @@
 #include "irisapi/LibraryDefs.h"
 #include "irisapi/Version.h"
 #include "modulation/OfdmIndexGenerator.h"
-#include "modulation/Crc.h"
 #include "modulation/Whitener.h"
-#include "utility/RawFileUtility.h"
+#include "modulation/WhitenCrc.h"
+#include "utility/SharedTables.h"
 
 using namespace std;
-using namespace boost::lambda;
 
 namespace iris
 {
 namespace phy
 {
 
-// export library symbols
+// Declared here rather than with a using-directive so that they hide the
+// boost::bind placeholders pulled in by boost/thread.hpp.
+using boost::lambda::_1;
+using boost::lambda::_2;
+
+// export library symbols, unless built into another component
+// (see OfdmMultiDemodulator)
+#ifndef IRIS_OFDMDEMODULATOR_EMBEDDED
 IRIS_COMPONENT_EXPORTS(PhyComponent, OfdmDemodulatorComponent);
+#endif
+
+/// Names of the debug stages, as in the files written by earlier versions.
+static const char* debugStageNames[] = {
+  "RxKnownPreamble",
+  "RxKnownPreambleBins",
+  "RxPreamble",
+  "RxPreambleHalfBins",
+  "RxPreambleHalfBinsRotated",
+  "RxFreqCorrector",
+  "RxFreqOffsetCorrelations",
+  "RxShortEqualizer",
+  "RxEqualizer",
+  "RxLlrWeights",
+  "RxSymbolBins",
+  "RxSymbolBinsRotated",
+  "RxSymbolBinsEqualized",
+  "RxSymbolData"
+};
+
+/** Interpolate the equalizer halfway between two carriers.
+ *
+ * Magnitude and phase are interpolated separately - the fft window starts
+ * inside the cyclic prefix, so the equalizer phase rotates between
+ * carriers and a linear interpolation would shrink the result.
+ */
+static std::complex<float> interpolateEq(std::complex<float> a,
+                                         std::complex<float> b)
+{
+  float sumMag = abs(a+b);
+  if(sumMag == 0)
+    return std::complex<float>(0,0);
+  return (a+b)*((abs(a)+abs(b))/(2*sumMag));
+}
 
 OfdmDemodulatorComponent::OfdmDemodulatorComponent(std::string name)
   : PhyComponent(name,                            // component name
@@ -66,22 +106,39 @@ OfdmDemodulatorComponent::OfdmDemodulatorComponent(std::string name)
     ,frameDetected_(false)
     ,haveHeader_(false)
     ,symbolLength_(0)
-    ,rxNumBytes_(0)
-    ,rxNumSymbols_(0)
     ,headerIndex_(0)
     ,frameIndex_(0)
-    ,halfFft_(NULL)
     ,halfFftData_(NULL)
-    ,fullFft_(NULL)
-    ,fullFftData_(NULL)
+    ,binStride_(0)
     ,numRxFrames_(0)
     ,numRxFails_(0)
-    ,symbolCount_(0)
+    ,softOutput_(false)
+    ,frameCount_(0)
+    ,job_(NULL)
+    ,nextJob_(0)
+    ,outputJob_(0)
+    ,runJob_(0)
+    ,numPending_(0)
+    ,numQueued_(0)
+    ,stopWorkers_(false)
 {
   registerParameter(
-    "debug", "Whether to write debug data to file.",
+    "debug", "Whether to capture debug data to debugfile.",
     "false", true, debug_x);
 
+  registerParameter(
+    "debugfile", "File to which debug data is captured.",
+    "OutputData/OfdmDemodulator.cap", false, debugFile_x);
+
+  registerParameter(
+    "debugstages", "Bit mask of the debug stages to capture (-1 for all).",
+    "-1", true, debugStages_x);
+
+  registerParameter(
+    "debuginterval", "Capture debug data for one in every debuginterval "
+    "frames.",
+    "1", true, debugInterval_x, Interval<int>(1,1000000));
+
   registerParameter(
     "reportrate", "Report performance stats every reportrate frames.",
     "1000", true, reportRate_x);
@@ -106,6 +163,61 @@ OfdmDemodulatorComponent::OfdmDemodulatorComponent(std::string name)
     "threshold", "Frame detection threshold",
     "0.827", true, threshold_x, Interval<float>(0.0,1.0));
 
+  registerParameter(
+    "coarsedecimation", "Decimation of the coarse frame search (1 = search "
+    "every sample at full resolution)",
+    "1", true, coarseDecimation_x, Interval<int>(1,64));
+
+  registerParameter(
+    "coarsethreshold", "Threshold of the coarse frame search",
+    "0.5", true, coarseThreshold_x, Interval<float>(0.0,1.0));
+
+  registerParameter(
+    "maxsymbolsperframe", "Maximum number of data symbols per received frame",
+    "128", true, maxSymbolsPerFrame_x, Interval<int>(1,1024));
+
+  registerParameter(
+    "maxfftbatch", "Maximum number of symbols transformed per fft call",
+    "32", true, maxFftBatch_x, Interval<int>(1,65536));
+
+  registerParameter(
+    "numworkers", "Number of frame demodulation threads (0 = demodulate "
+    "on the calling thread)",
+    "0", true, numWorkers_x, Interval<int>(0,64));
+
+  string llrTypes[] = {"none", "float", "int8"};
+  registerParameter(
+    "llroutput", "Output LLRs of each frame on output2 (none, float or int8)",
+    "none", false, llrOutput_x, list<string>(begin(llrTypes),end(llrTypes)));
+
+  registerParameter(
+    "llrscale", "Scale applied to LLRs before saturating to int8",
+    "8", true, llrScale_x, Interval<float>(0.0,1000.0));
+
+  string metricsTypes[] = {"none", "port", "event"};
+  registerParameter(
+    "metricsoutput", "Output a metrics record for each frame on output3, "
+    "as metricsevent or not at all (port, event or none)",
+    "none", false, metricsOutput_x,
+    list<string>(begin(metricsTypes),end(metricsTypes)));
+
+  string rigors[] = {"estimate", "measure", "patient", "exhaustive"};
+  registerParameter(
+    "fftplanning", "Rigor of fft planning (estimate, measure, patient or "
+    "exhaustive)",
+    "measure", false, fftPlanning_x, list<string>(begin(rigors),end(rigors)));
+
+  registerParameter(
+    "wisdomfile", "File used to store fftw wisdom across runs (empty for none)",
+    "", false, wisdomFile_x);
+
+  registerEvent(
+    "metricsevent",
+    "Metrics of each received frame (see OfdmDemodulatorComponent.h)",
+    TypeInfo< double >::identifier);
+
+  workspace_.bins = NULL;
+
   // Create our pilot sequence
   typedef Cplx c;
   c seq[] = {c(1,0),c(1,0),c(-1,0),c(-1,0),c(-1,0),c(1,0),c(-1,0),c(1,0),};
@@ -121,6 +233,12 @@ void OfdmDemodulatorComponent::registerPorts()
 {
   registerInputPort("input1", TypeInfo< complex<float> >::identifier);
   registerOutputPort("output1", TypeInfo< uint8_t >::identifier);
+  if(llrOutput_x == "float")
+    registerOutputPort("output2", TypeInfo< float >::identifier);
+  if(llrOutput_x == "int8")
+    registerOutputPort("output2", TypeInfo< int8_t >::identifier);
+  if(metricsOutput_x == "port")
+    registerOutputPort("output3", TypeInfo< double >::identifier);
 }
 
 void OfdmDemodulatorComponent::calculateOutputTypes(
@@ -128,10 +246,17 @@ void OfdmDemodulatorComponent::calculateOutputTypes(
     std::map<std::string,int>& outputTypes)
 {
   outputTypes["output1"] = TypeInfo< uint8_t >::identifier;
+  if(llrOutput_x == "float")
+    outputTypes["output2"] = TypeInfo< float >::identifier;
+  if(llrOutput_x == "int8")
+    outputTypes["output2"] = TypeInfo< int8_t >::identifier;
+  if(metricsOutput_x == "port")
+    outputTypes["output3"] = TypeInfo< double >::identifier;
 }
 
 void OfdmDemodulatorComponent::initialize()
 {
+  destroy();
   setup();
 }
 
@@ -163,6 +288,9 @@ void OfdmDemodulatorComponent::process()
     numRxFails_++;
   }
 
+  // Frames which point into the input must be output before it is released
+  outputInPlaceFrames();
+
   releaseInputDataSet("input1", in_);
 
   if(numRxFrames_ >= reportRate_x)
@@ -177,33 +305,45 @@ void OfdmDemodulatorComponent::process()
 void OfdmDemodulatorComponent::parameterHasChanged(std::string name)
 {
   if(name == "numdatacarriers" || name == "numpilotcarriers" ||
-     name == "numguardcarriers" || name == "cyclicprefixlength")
+     name == "numguardcarriers" || name == "cyclicprefixlength" ||
+     name == "maxsymbolsperframe" || name == "maxfftbatch" ||
+     name == "numworkers" || name == "debug" ||
+     name == "debugstages" || name == "debuginterval")
   {
+    // Output frames still with the workers before the jobs are recreated
+    outputFrames(0);
     destroy();
     setup();
   }
 
-  if(name == "threshold")
+  if(name == "threshold" || name == "coarsedecimation" ||
+     name == "coarsethreshold")
+  {
     detector_.reset(numBins_,cyclicPrefixLength_x,threshold_x);
+    detector_.setCoarseSearch(coarseDecimation_x, coarseThreshold_x);
+  }
 }
 
 void OfdmDemodulatorComponent::setup()
 {
-  // Set up index vectors
-  pilotIndices_.clear();
-  pilotIndices_.resize(numPilotCarriers_x);
-  dataIndices_.clear();
-  dataIndices_.resize(numDataCarriers_x);
-  OfdmIndexGenerator::generateIndices(numDataCarriers_x,
-                                      numPilotCarriers_x,
-                                      numGuardCarriers_x,
-                                      pilotIndices_.begin(), pilotIndices_.end(),
-                                      dataIndices_.begin(), dataIndices_.end());
-
   numBins_ = numDataCarriers_x + numPilotCarriers_x + numGuardCarriers_x + 1;
   symbolLength_ = numBins_ + cyclicPrefixLength_x;
   numHeaderSymbols_ = (int)ceil(numHeaderBytes_/((float)numDataCarriers_x/8));
 
+  // Index vectors and fft plans are shared with other demodulators
+  LayoutKey key;
+  key.numData = numDataCarriers_x;
+  key.numPilot = numPilotCarriers_x;
+  key.numGuard = numGuardCarriers_x;
+  key.maxRows = max(maxSymbolsPerFrame_x, numHeaderSymbols_);
+  key.maxBatch = maxFftBatch_x;
+  key.planning = fftPlanning_x;
+  key.wisdomFile = wisdomFile_x;
+  layout_ = SharedTables::get<Layout>(key);
+  binStride_ = layout_->binStride;
+  symbolEqualizer_.reset(numBins_, layout_->pilotIndices,
+                         layout_->dataIndices, pilotSequence_);
+
   preamble_.clear();
   preamble_.resize(numBins_);
   preambleBins_.resize(numBins_/2);
@@ -215,355 +355,826 @@ void OfdmDemodulatorComponent::setup()
                                 preamble_.end());
 
   if(debug_x)
-    RawFileUtility::write(preamble_.begin(), preamble_.end(),
-                          "OutputData/RxKnownPreamble");
+  {
+    vector<string> stages(begin(debugStageNames), end(debugStageNames));
+    capture_.open(debugFile_x, stages, debugStages_x, debugInterval_x,
+                  1024, symbolLength_*sizeof(Cplx));
+  }
+  capture(KNOWN_PREAMBLE, 0, 0, preamble_.begin(), preamble_.end());
 
   halfFftData_ = reinterpret_cast<Cplx*>(
       fftwf_malloc(sizeof(fftwf_complex) * numBins_/2));
   fill(&halfFftData_[0], &halfFftData_[numBins_/2], Cplx(0,0));
-  fullFftData_ = reinterpret_cast<Cplx*>(
-      fftwf_malloc(sizeof(fftwf_complex) * numBins_));
-  fill(&fullFftData_[0], &fullFftData_[numBins_], Cplx(0,0));
-  halfFft_ = fftwf_plan_dft_1d(numBins_/2,
-                               (fftwf_complex*)halfFftData_,
-                               (fftwf_complex*)halfFftData_,
-                               FFTW_FORWARD,
-                               FFTW_MEASURE);
-  fullFft_ = fftwf_plan_dft_1d(numBins_,
-                               (fftwf_complex*)fullFftData_,
-                               (fftwf_complex*)fullFftData_,
-                               FFTW_FORWARD,
-                               FFTW_MEASURE);
-
-  copy(preamble_.begin(), preamble_.begin()+numBins_/2, halfFftData_);
-  fftwf_execute(halfFft_);
-  copy(halfFftData_, halfFftData_+numBins_/2, preambleBins_.begin());
-  transform(preambleBins_.begin(),
-            preambleBins_.end(),
-            preambleBins_.begin(),
-            2.0f*_1);
-  if(debug_x)
-    RawFileUtility::write(preambleBins_.begin(), preambleBins_.end(),
-                          "OutputData/RxKnownPreambleBins");
+  setupWorkspace(workspace_);
+
+  preambleGen_.generatePreambleHalfBins(numDataCarriers_x,
+                                        numPilotCarriers_x,
+                                        numGuardCarriers_x,
+                                        preambleBins_.begin(),
+                                        preambleBins_.end());
+
+  // Data symbols are scaled by 1/numActive at the transmitter but the
+  // preamble by 2/numActive, so scale the known bins to give an equalizer
+  // with unit gain on the data carriers.
+  float gain = (numDataCarriers_x + numPilotCarriers_x)/(float)numBins_;
+  transform(preambleBins_.begin(), preambleBins_.end(),
+            preambleBins_.begin(), _1*gain);
+  capture(KNOWN_PREAMBLE_BINS, 0, 0, preambleBins_.begin(), preambleBins_.end());
+
+  // Occupied carriers of the preamble, used for noise estimation
+  float maxNorm = 0;
+  for(int i=0; i<numBins_/2; i++)
+    maxNorm = max(maxNorm, norm(preambleBins_[i]));
+  preambleCarriers_.clear();
+  for(int i=0; i<numBins_/2; i++)
+    if(norm(preambleBins_[i]) > maxNorm*1e-3f)
+      preambleCarriers_.push_back(i);
 
   rxPreamble_.resize(symbolLength_);
-  corrector_.resize(symbolLength_);
   rxHeader_.resize(symbolLength_*numHeaderSymbols_);
-  equalizer_.resize(numBins_);
+
+  // Size our workspace for the largest possible frame
+  headerData_.resize(numHeaderSymbols_*(numDataCarriers_x/8));
+  halfBins_.resize(numBins_/2);
+  noiseBins_.resize(numBins_/2);
+  shortEqualizer_.resize(numBins_/2);
+  magRxBins_.resize(numBins_/2);
+  correlations_.resize(33);
+
+  // Magnitudes of the known preamble bins never change - calculate them once
+  magTxBins_.resize(numBins_);
+  transform(preambleBins_.begin(), preambleBins_.end(),
+            magTxBins_.begin(), opAbs());
+  FloatVecIt it = magTxBins_.begin();
+  copy(it, it+(numBins_/2), it+(numBins_/2));
+
+  // Two jobs per worker keep every worker busy while the input thread
+  // fills the next frame. Without workers a single job is reused.
+  jobs_.clear();
+  jobs_.resize(numWorkers_x > 0 ? 2*numWorkers_x : 1);
+  for(int i=0; i<jobs_.size(); i++)
+  {
+    jobs_[i].state = FrameJob::FREE;
+    jobs_[i].samples.reserve(maxSymbolsPerFrame_x*symbolLength_);
+    jobs_[i].equalizer.resize(numBins_);
+    jobs_[i].data.reserve(maxSymbolsPerFrame_x*((numDataCarriers_x*QAM256)/8));
+    jobs_[i].llrWeights.resize(numDataCarriers_x);
+    if(llrOutput_x == "float")
+      jobs_[i].llrs.resize(maxSymbolsPerFrame_x*numDataCarriers_x*QAM256);
+    if(llrOutput_x == "int8")
+      jobs_[i].llrBytes.resize(maxSymbolsPerFrame_x*numDataCarriers_x*QAM256);
+  }
+  job_ = &jobs_[0];
+  nextJob_ = outputJob_ = runJob_ = 0;
+  numPending_ = numQueued_ = 0;
+
+  stopWorkers_ = false;
+  workerSpaces_.resize(numWorkers_x);
+  if(numWorkers_x > 0)
+  {
+    workers_.reset(new boost::thread_group);
+    for(int i=0; i<numWorkers_x; i++)
+    {
+      setupWorkspace(workerSpaces_[i]);
+      workers_->add_thread(
+          new boost::thread(&OfdmDemodulatorComponent::workerThreadFunction,
+                            this, &workerSpaces_[i]));
+    }
+  }
+
+  softOutput_ = (llrOutput_x != "none");
+  metrics_.assign(NUM_METRICS, 0);
 
   detector_.reset(numBins_,cyclicPrefixLength_x,threshold_x, debug_x);
+  detector_.setCoarseSearch(coarseDecimation_x, coarseThreshold_x);
 }
 
 void OfdmDemodulatorComponent::destroy()
 {
-  if(halfFft_ != NULL)
-    fftwf_destroy_plan(halfFft_);
-  if(fullFft_ != NULL)
-    fftwf_destroy_plan(fullFft_);
+  if(workers_)
+  {
+    {
+      boost::lock_guard< boost::mutex > lock(jobMutex_);
+      stopWorkers_ = true;
+    }
+    jobQueued_.notify_all();
+    workers_->join_all();
+    workers_.reset();
+  }
+  for(int i=0; i<workerSpaces_.size(); i++)
+    destroyWorkspace(workerSpaces_[i]);
+  workerSpaces_.clear();
+
   if(halfFftData_ != NULL)
     fftwf_free(halfFftData_);
-  if(fullFftData_ != NULL)
-    fftwf_free(fullFftData_);
+  destroyWorkspace(workspace_);
+  capture_.close();
+  halfFftData_ = NULL;
+  layout_.reset();
+}
+
+OfdmDemodulatorComponent::Layout::Layout(const LayoutKey& key)
+  :pilotIndices(key.numPilot)
+  ,dataIndices(key.numData)
+  ,halfFft(NULL)
+{
+  OfdmIndexGenerator::generateIndices(key.numData,
+                                      key.numPilot,
+                                      key.numGuard,
+                                      pilotIndices.begin(), pilotIndices.end(),
+                                      dataIndices.begin(), dataIndices.end());
+
+  // Symbols of a frame are transformed in batches. Each row of the bins
+  // starts on a SIMD boundary so a batch plan can be executed on any row.
+  int numBins = key.numData + key.numPilot + key.numGuard + 1;
+  binStride = (numBins+3)/4*4;
+
+  // Plan on scratch arrays, as planning may overwrite them
+  Cplx* scratch = reinterpret_cast<Cplx*>(
+      fftwf_malloc(sizeof(fftwf_complex) * binStride * key.maxRows));
+  try
+  {
+    halfFft = FftwPlanner::planDft1d(numBins/2,
+                                     (fftwf_complex*)scratch,
+                                     (fftwf_complex*)scratch,
+                                     FFTW_FORWARD,
+                                     key.planning, key.wisdomFile);
+    for(int batch=1; batch<=min(key.maxRows, key.maxBatch); batch*=2)
+    {
+      frameFfts.push_back(
+          FftwPlanner::planManyDft(numBins, batch,
+                                   (fftwf_complex*)scratch, binStride,
+                                   (fftwf_complex*)scratch, binStride,
+                                   FFTW_FORWARD,
+                                   key.planning, key.wisdomFile));
+    }
+  }
+  catch(...)
+  {
+    fftwf_free(scratch);
+    destroyPlans();
+    throw;
+  }
+  fftwf_free(scratch);
+}
+
+OfdmDemodulatorComponent::Layout::~Layout()
+{
+  destroyPlans();
+}
+
+void OfdmDemodulatorComponent::Layout::destroyPlans()
+{
+  FftwPlanner::destroyPlan(halfFft);
+  for(int i=0; i<frameFfts.size(); i++)
+    FftwPlanner::destroyPlan(frameFfts[i]);
+  halfFft = NULL;
+  frameFfts.clear();
+}
+
+void OfdmDemodulatorComponent::setupWorkspace(Workspace& ws)
+{
+  int maxRows = max(maxSymbolsPerFrame_x, numHeaderSymbols_);
+  ws.bins = reinterpret_cast<Cplx*>(
+      fftwf_malloc(sizeof(fftwf_complex) * binStride_ * maxRows));
+  fill(&ws.bins[0], &ws.bins[binStride_*maxRows], Cplx(0,0));
+  ws.qamSymbols.resize(numDataCarriers_x);
+  ws.symbolCount = 0;
+}
+
+void OfdmDemodulatorComponent::destroyWorkspace(Workspace& ws)
+{
+  if(ws.bins != NULL)
+    fftwf_free(ws.bins);
+  ws.bins = NULL;
 }
 
 OfdmDemodulatorComponent::CplxVecIt
 OfdmDemodulatorComponent::searchInput(CplxVecIt begin, CplxVecIt end)
 {
-  float snr(0);
+  OfdmPreambleDetector::Result result;
   CplxVecIt it = detector_.search(begin, end,
                                   rxPreamble_.begin(), rxPreamble_.end(),
-                                  frameDetected_, fracFreqOffset_, snr);
+                                  result);
+  frameDetected_ = result.detected;
   if(frameDetected_)
   {
+    fracFreqOffset_ = result.freqOffset;
     int idx = (it-in_->data.begin()) - (numBins_+cyclicPrefixLength_x);
-    timeStamp_ = timeStamp_ + (idx/sampleRate_);
+    timeStamp_ = in_->timeStamp + (idx/sampleRate_);
+    acquireJob();
+    job_->snr = result.snr;
+    job_->fracFreqOffset = fracFreqOffset_;
     extractPreamble();
   }
   return it;
 }
 
+/** Consume the samples of the header and frame which follow a preamble.
+ *
+ * Samples are consumed in spans of up to the number still needed for the
+ * header or frame. A header or frame which lies entirely within the input
+ * DataSet is demodulated in place, otherwise its samples are gathered
+ * across blocks first. The input DataSet is not released until every
+ * frame demodulated in place has been output.
+ *
+ * @param begin   Iterator to first input sample.
+ * @param end     Iterator to one past the last input sample.
+ * @return        Iterator to the first sample which was not consumed.
+ */
 OfdmDemodulatorComponent::CplxVecIt
 OfdmDemodulatorComponent::processFrame(CplxVecIt begin, CplxVecIt end)
 {
-  for(; begin != end; begin++)
+  int available = end-begin;
+
+  if(!haveHeader_)
   {
-    if(!haveHeader_)
+    int headerLength = symbolLength_*numHeaderSymbols_;
+    int num = min(headerLength-headerIndex_, available);
+    if(num == headerLength)
     {
-      rxHeader_[headerIndex_++] = *begin;
-      if(headerIndex_ == symbolLength_*numHeaderSymbols_)
-        extractHeader();
+      extractHeader(begin);
     }
     else
     {
-      rxFrame_[frameIndex_++] = *begin;
-      if(frameIndex_ == symbolLength_*rxNumSymbols_)
+      copy(begin, begin+num, rxHeader_.begin()+headerIndex_);
+      headerIndex_ += num;
+      if(headerIndex_ == headerLength)
+        extractHeader(rxHeader_.begin());
+    }
+    return begin+num;
+  }
+
+  int frameLength = symbolLength_*job_->numSymbols;
+  int num = min(frameLength-frameIndex_, available);
+  job_->inPlace = (num == frameLength);
+  if(job_->inPlace)
+  {
+    job_->frame = begin;
+  }
+  else
+  {
+    job_->samples.resize(frameLength);
+    copy(begin, begin+num, job_->samples.begin()+frameIndex_);
+    job_->frame = job_->samples.begin();
+  }
+  frameIndex_ += num;
+  if(frameIndex_ == frameLength)
+    submitJob();
+  return begin+num;
+}
+
+/** Get a free job for a newly detected frame.
+ *
+ * If every job in the ring is still pending, wait for the oldest one to
+ * be demodulated and output it first.
+ */
+void OfdmDemodulatorComponent::acquireJob()
+{
+  outputFrames(jobs_.size()-1);
+  job_ = &jobs_[nextJob_];
+  job_->number = frameCount_++;
+  job_->timeStamp = timeStamp_;
+  job_->sampleRate = sampleRate_;
+}
+
+/** Demodulate the frame which has just been received.
+ *
+ * Without workers the frame is demodulated and output immediately.
+ * Otherwise it is queued for the worker pool and any frames which have
+ * already been demodulated are output in order.
+ */
+void OfdmDemodulatorComponent::submitJob()
+{
+  headerIndex_ = 0;
+  frameIndex_ = 0;
+  frameDetected_ = false;
+  haveHeader_ = false;
+
+  if(!workers_)
+  {
+    demodFrame(*job_, workspace_);
+    outputFrame(*job_);
+    return;
+  }
+
+  {
+    boost::lock_guard< boost::mutex > lock(jobMutex_);
+    job_->state = FrameJob::QUEUED;
+    numQueued_++;
+  }
+  jobQueued_.notify_one();
+  nextJob_ = (nextJob_+1)%jobs_.size();
+  numPending_++;
+
+  outputFrames(jobs_.size());
+}
+
+/** Output demodulated frames in the order in which they were received.
+ *
+ * A frame whose demodulation threw is not output. An IrisException counts
+ * as a failed frame, as in process(), and any other exception is rethrown
+ * to the caller.
+ *
+ * @param maxPending  Wait until no more than this many frames are pending.
+ */
+void OfdmDemodulatorComponent::outputFrames(int maxPending)
+{
+  while(numPending_ > 0)
+  {
+    FrameJob& job = jobs_[outputJob_];
+    {
+      boost::unique_lock< boost::mutex > lock(jobMutex_);
+      while(job.state != FrameJob::DONE && numPending_ > maxPending)
+        jobDone_.wait(lock);
+      if(job.state != FrameJob::DONE)
+        return;
+      job.state = FrameJob::FREE;
+    }
+
+    outputJob_ = (outputJob_+1)%jobs_.size();
+    numPending_--;
+
+    // Raise errors on this thread, as demodulating without workers would
+    if(job.error)
+    {
+      boost::exception_ptr error = job.error;
+      job.error = boost::exception_ptr();
+      try
+      {
+        boost::rethrow_exception(error);
+      }
+      catch(IrisException& e)
       {
-        demodFrame();
-        return ++begin;
+        LOG(LDEBUG) << e.what();
+        numRxFails_++;
+        continue;
       }
     }
+
+    outputFrame(job);
+  }
+}
+
+/** Output pending frames until none of them point into the input DataSet.
+ *
+ * Frames gathered across blocks own their samples, so they are left with
+ * the workers and the next block is searched while they are demodulated.
+ * They are output by a later call once they are done. Frames which are
+ * already done are output without waiting.
+ */
+void OfdmDemodulatorComponent::outputInPlaceFrames()
+{
+  // Jobs after the last in-place job in the ring may stay pending
+  int maxPending = 0;
+  for(int i=0; i<numPending_; i++)
+  {
+    const FrameJob& job = jobs_[(outputJob_+i)%jobs_.size()];
+    maxPending = job.inPlace ? 0 : maxPending+1;
+  }
+  outputFrames(maxPending);
+}
+
+/** Output a demodulated frame.
+ *
+ * LLRs are output for every frame with a valid header so that a decoder
+ * can attempt to correct it. Data is only output if its framecheck passed.
+ *
+ * @param job  The demodulated frame.
+ */
+void OfdmDemodulatorComponent::outputFrame(FrameJob& job)
+{
+  if(metricsOutput_x != "none")
+    outputMetrics(job);
+
+  int numBits = job.numBytes*8;
+  if(llrOutput_x == "float")
+  {
+    DataSet< float >* llrs;
+    getOutputDataSet("output2", llrs, numBits);
+    llrs->sampleRate = job.sampleRate;
+    llrs->timeStamp = job.timeStamp;
+    copy(job.llrs.begin(), job.llrs.begin()+numBits, llrs->data.begin());
+    releaseOutputDataSet("output2", llrs);
+  }
+  if(llrOutput_x == "int8")
+  {
+    DataSet< int8_t >* llrs;
+    getOutputDataSet("output2", llrs, numBits);
+    llrs->sampleRate = job.sampleRate;
+    llrs->timeStamp = job.timeStamp;
+    copy(job.llrBytes.begin(), job.llrBytes.begin()+numBits,
+         llrs->data.begin());
+    releaseOutputDataSet("output2", llrs);
+  }
+
+  if(!job.crcOk)
+  {
+    LOG(LDEBUG) << "CRC mismatch - dropping frame.";
+    numRxFails_++;
+    return;
+  }
+
+  DataSet< uint8_t>* out;
+  getOutputDataSet("output1", out, job.numBytes);
+  out->sampleRate = job.sampleRate;
+  out->timeStamp = job.timeStamp;
+  copy(job.data.begin(), job.data.begin()+job.numBytes, out->data.begin());
+  releaseOutputDataSet("output1", out);
+}
+
+/** Output the metrics record of a demodulated frame.
+ *
+ * All metrics were found while detecting and demodulating the frame, so
+ * this only gathers them into a record.
+ *
+ * @param job  The demodulated frame.
+ */
+void OfdmDemodulatorComponent::outputMetrics(const FrameJob& job)
+{
+  metrics_[METRICS_TIMESTAMP] = job.timeStamp;
+  metrics_[METRICS_SNR] = job.snr;
+  metrics_[METRICS_FRAC_CFO] = job.fracFreqOffset;
+  metrics_[METRICS_INT_CFO] = job.intFreqOffset*2;
+  metrics_[METRICS_PILOT_EVM] = job.pilotEvm;
+  metrics_[METRICS_MODULATION] = job.modulation;
+  metrics_[METRICS_NUM_BYTES] = job.numBytes;
+  metrics_[METRICS_CRC_OK] = job.crcOk ? 1 : 0;
+
+  if(metricsOutput_x == "event")
+  {
+    activateEvent("metricsevent", metrics_);
+    return;
+  }
+
+  DataSet< double >* out;
+  getOutputDataSet("output3", out, NUM_METRICS);
+  out->sampleRate = job.sampleRate;
+  out->timeStamp = job.timeStamp;
+  copy(metrics_.begin(), metrics_.end(), out->data.begin());
+  releaseOutputDataSet("output3", out);
+}
+
+/** Demodulate queued frames until told to stop.
+ *
+ * Jobs are taken in ring order. The input thread outputs them in the same
+ * order, so frames leave the component in the order they were received.
+ *
+ * @param ws  Workspace owned by this worker.
+ */
+void OfdmDemodulatorComponent::workerThreadFunction(Workspace* ws)
+{
+  while(true)
+  {
+    FrameJob* job;
+    {
+      boost::unique_lock< boost::mutex > lock(jobMutex_);
+      while(numQueued_ == 0 && !stopWorkers_)
+        jobQueued_.wait(lock);
+      if(stopWorkers_)
+        return;
+      job = &jobs_[runJob_];
+      runJob_ = (runJob_+1)%jobs_.size();
+      numQueued_--;
+    }
+
+    // Any exception escaping this thread would terminate the process, so
+    // it is handed to the input thread with the job
+    try
+    {
+      demodFrame(*job, *ws);
+    }
+    catch(...)
+    {
+      job->error = boost::current_exception();
+    }
+
+    {
+      boost::lock_guard< boost::mutex > lock(jobMutex_);
+      job->state = FrameJob::DONE;
+    }
+    jobDone_.notify_all();
   }
-  return begin;
 }
 
 void OfdmDemodulatorComponent::extractPreamble()
 {
-  generateFractionalOffsetCorrector(fracFreqOffset_);
   correctFractionalOffset(rxPreamble_.begin(), rxPreamble_.end());
 
   int off = cyclicPrefixLength_x-4;
   CplxVecIt begin = rxPreamble_.begin() + off;
   CplxVecIt end = rxPreamble_.begin() + off + (numBins_/2);
 
-  if(debug_x)
-    RawFileUtility::write(begin, end, "OutputData/RxPreamble");
+  capture(PREAMBLE, job_->number, 0, begin, end);
 
   int halfBins = numBins_/2;
-  CplxVec bins(halfBins);
   copy(begin, end, halfFftData_);
-  fftwf_execute(halfFft_);
-  copy(halfFftData_, halfFftData_+halfBins, bins.begin());
-  transform(bins.begin(), bins.end(), bins.begin(), _1*Cplx(2,0));
+  fftwf_execute_dft(layout_->halfFft, (fftwf_complex*)halfFftData_,
+                    (fftwf_complex*)halfFftData_);
+  transform(halfFftData_, halfFftData_+halfBins, halfBins_.begin(),
+            _1*Cplx(2,0));
 
-  if(debug_x)
-    RawFileUtility::write(bins.begin(), bins.end(),
-                          "OutputData/RxPreambleHalfBins");
+  capture(PREAMBLE_HALF_BINS, job_->number, 0,
+          halfBins_.begin(), halfBins_.end());
 
-  intFreqOffset_ = findIntegerOffset(bins.begin(), bins.end());
-  int shift = (halfBins-intFreqOffset_)%halfBins;
-  rotate(bins.begin(), bins.begin()+shift, bins.end());
+  if(softOutput_)
+  {
+    // The two halves of the preamble are identical, so any difference
+    // between their bins is noise
+    copy(end, end+halfBins, halfFftData_);
+    fftwf_execute_dft(layout_->halfFft, (fftwf_complex*)halfFftData_,
+                      (fftwf_complex*)halfFftData_);
+    transform(halfBins_.begin(), halfBins_.end(), halfFftData_,
+              noiseBins_.begin(), _1-_2*Cplx(2,0));
+  }
 
-  if(debug_x)
-    RawFileUtility::write(bins.begin(), bins.end(),
-                          "OutputData/RxPreambleHalfBinsRotated");
+  job_->intFreqOffset = findIntegerOffset(halfBins_.begin(), halfBins_.end());
+  int shift = (halfBins-job_->intFreqOffset)%halfBins;
+  rotate(halfBins_.begin(), halfBins_.begin()+shift, halfBins_.end());
 
-  generateEqualizer(bins.begin(), bins.end());
+  capture(PREAMBLE_HALF_BINS_ROTATED, job_->number, 0,
+          halfBins_.begin(), halfBins_.end());
+
+  generateEqualizer(halfBins_.begin(), halfBins_.end());
+
+  if(softOutput_)
+  {
+    rotate(noiseBins_.begin(), noiseBins_.begin()+shift, noiseBins_.end());
+    generateLlrWeights(noiseBins_.begin(), noiseBins_.end());
+  }
 }
 
-void OfdmDemodulatorComponent::extractHeader()
+void OfdmDemodulatorComponent::extractHeader(CplxVecIt begin)
 {
-  symbolCount_ = 0;
+  workspace_.symbolCount = 0;
   numRxFrames_++;
   int bytesPerHeader = numDataCarriers_x/8;
-  ByteVec data(numHeaderSymbols_*bytesPerHeader);
+  ByteVec& data = headerData_;
   ByteVecIt dataIt = data.begin();
-  CplxVecIt symIt = rxHeader_.begin();
+  transformSymbols(*job_, begin, numHeaderSymbols_, workspace_);
   for(int i=0; i<numHeaderSymbols_; i++)
   {
-    demodSymbol(symIt, symIt+symbolLength_,
+    demodSymbol(*job_, workspace_, i,
                 dataIt, dataIt+bytesPerHeader, BPSK);
-    symIt += symbolLength_;
     dataIt += numDataCarriers_x/8;
-    symbolCount_++;
+    workspace_.symbolCount++;
   }
 
   Whitener::whiten(data.begin(), data.end());
 
-  rxCrc_ = 0;
-  rxCrc_ = data[3];
-  rxCrc_ |= (data[2] << 8);
-  rxCrc_ |= (data[1] << 16);
-  rxCrc_ |= (data[0] << 24);
-
-  rxModulation_ = data[6] & 0xFF;
-  if(rxModulation_!=BPSK && rxModulation_!=QPSK && rxModulation_!=QAM16)
+  uint32_t crc = 0;
+  crc = data[3];
+  crc |= (data[2] << 8);
+  crc |= (data[1] << 16);
+  crc |= (data[0] << 24);
+  job_->crc = crc;
+
+  job_->modulation = data[6] & 0xFF;
+  int modulation = job_->modulation;
+  if(modulation!=BPSK && modulation!=QPSK && modulation!=QAM16 &&
+     modulation!=QAM64 && modulation!=QAM256)
     throw IrisException("Invalid modulation depth - dropping frame.");
-
-  rxNumBytes_ = ((data[4]<<8) | data[5]) & 0xFFFF;
-  int bytesPerSymbol = (numDataCarriers_x*rxModulation_)/8;
-  rxNumSymbols_ = ceil(rxNumBytes_/(float)bytesPerSymbol);
-  if(rxNumSymbols_>32 || rxNumSymbols_<1)
+  if((numDataCarriers_x*modulation)%8 != 0)
+    throw IrisException("Modulation depth does not fill whole bytes per "
+                        "symbol - dropping frame.");
+
+  job_->numBytes = ((data[4]<<8) | data[5]) & 0xFFFF;
+  int bytesPerSymbol = (numDataCarriers_x*modulation)/8;
+  job_->numSymbols = ceil(job_->numBytes/(float)bytesPerSymbol);
+  if(job_->numSymbols>maxSymbolsPerFrame_x || job_->numSymbols<1)
     throw IrisException("Invalid frame length - dropping frame.");
 
-  rxFrame_.resize(rxNumSymbols_*symbolLength_);
   haveHeader_ = true;
 }
 
-void OfdmDemodulatorComponent::demodFrame()
+/** Demodulate the data symbols of a frame and check its framecheck.
+ *
+ * Only reads the component's fixed configuration, so it may be called
+ * from several threads at once with different jobs and workspaces.
+ *
+ * @param job  The received frame.
+ * @param ws   Workspace of the calling thread.
+ */
+void OfdmDemodulatorComponent::demodFrame(FrameJob& job, Workspace& ws)
 {
-  int bytesPerSymbol = (numDataCarriers_x*rxModulation_)/8;
-  int frameDataLen = (rxNumSymbols_*bytesPerSymbol);
-  frameData_.resize(frameDataLen);
-
-  CplxVecIt inIt = rxFrame_.begin();
-  ByteVecIt outIt = frameData_.begin();
-  for(int i=0;i<rxNumSymbols_;i++)
+  int bytesPerSymbol = (numDataCarriers_x*job.modulation)/8;
+  int frameDataLen = (job.numSymbols*bytesPerSymbol);
+  job.data.resize(frameDataLen);
+
+  ByteVecIt outIt = job.data.begin();
+  int bitsPerSymbol = numDataCarriers_x*job.modulation;
+  ws.symbolCount = numHeaderSymbols_;
+  ws.pilotError = 0;
+  transformSymbols(job, job.frame, job.numSymbols, ws);
+  for(int i=0;i<job.numSymbols;i++)
   {
-    demodSymbol(inIt, inIt+symbolLength_,
+    demodSymbol(job, ws, i,
                 outIt, outIt+bytesPerSymbol,
-                rxModulation_);
-    inIt += symbolLength_;
+                job.modulation);
     outIt += bytesPerSymbol;
-    symbolCount_++;
+
+    // Soft decisions from the equalized data carriers left by demodSymbol
+    if(llrOutput_x == "float")
+      qDemod_.demodulateSoft(&ws.qamSymbols[0], &job.llrWeights[0],
+                             numDataCarriers_x, &job.llrs[i*bitsPerSymbol],
+                             job.modulation);
+    if(llrOutput_x == "int8")
+      qDemod_.demodulateSoft(&ws.qamSymbols[0], &job.llrWeights[0],
+                             numDataCarriers_x, &job.llrBytes[i*bitsPerSymbol],
+                             job.modulation, llrScale_x);
+    ws.symbolCount++;
   }
 
-  outIt = frameData_.begin();
-  Whitener::whiten(outIt, outIt+rxNumBytes_);
-  uint32_t crc = Crc::generate(outIt, outIt+rxNumBytes_);
-  if(crc != rxCrc_)
-    throw IrisException("CRC mismatch - dropping frame.");
+  int numBits = job.numBytes*8;
+  if(llrOutput_x == "float")
+    Whitener::whitenSoft(job.llrs.begin(), job.llrs.begin()+numBits);
+  if(llrOutput_x == "int8")
+    Whitener::whitenSoft(job.llrBytes.begin(), job.llrBytes.begin()+numBits);
 
-  DataSet< uint8_t>* out;
-  getOutputDataSet("output1", out, rxNumBytes_);
-  out->sampleRate = sampleRate_;
-  out->timeStamp = timeStamp_;
-  copy(outIt, outIt+rxNumBytes_, out->data.begin());
-  releaseOutputDataSet("output1", out);
-
-  headerIndex_ = 0;
-  frameIndex_ = 0;
-  frameDetected_ = false;
-  haveHeader_ = false;
+  uint8_t* data = job.data.empty() ? NULL : &job.data[0];
+  uint32_t crc = WhitenCrc::whitenThenCrc(data, data+job.numBytes, data);
+  job.crcOk = (crc == job.crc);
+  job.pilotEvm = sqrt(ws.pilotError/job.numSymbols);
 }
 
-void OfdmDemodulatorComponent::demodSymbol(CplxVecIt inBegin, CplxVecIt inEnd,
-                                           ByteVecIt outBegin, ByteVecIt outEnd,
-                                           int modulationDepth)
+/** Transform a number of consecutive received symbols.
+ *
+ * The fractional frequency offset of each symbol is corrected while its
+ * fft window is gathered into a row of the workspace bins. The rows are
+ * then transformed in place using as few batched fft calls as possible.
+ *
+ * @param job         The frame being demodulated.
+ * @param begin       Iterator to first sample of first received symbol.
+ * @param numSymbols  Number of symbols to transform.
+ * @param ws          Workspace of the calling thread.
+ */
+void OfdmDemodulatorComponent::transformSymbols(const FrameJob& job,
+                                                CplxVecIt begin,
+                                                int numSymbols,
+                                                Workspace& ws)
 {
-  correctFractionalOffset(inBegin, inEnd);
-
+  // Each symbol is corrected from the phase of its first sample
   int off = cyclicPrefixLength_x-4;
-  CplxVecIt begin = inBegin + off;
-  CplxVecIt end = inBegin + off + numBins_;
-
-  CplxVec bins(numBins_);
-  copy(begin, end, fullFftData_);
-  fftwf_execute(fullFft_);
-  copy(fullFftData_, fullFftData_+numBins_, bins.begin());
-
-  if(debug_x)
+  float relFreq = -job.fracFreqOffset/numBins_;
+  ws.corrector.setFrequency(relFreq);
+  for(int i=0; i<numSymbols; i++, begin+=symbolLength_)
   {
-    stringstream fileName;
-    fileName << "OutputData//RxSymbolBins" << symbolCount_;
-    RawFileUtility::write(bins.begin(), bins.end(),
-                          fileName.str());
+    ws.corrector.setPhase(relFreq*off);
+    ws.corrector.mix(begin+off, begin+off+numBins_, ws.bins+i*binStride_);
   }
 
-  int shift = (numBins_-intFreqOffset_*2)%numBins_;
-  rotate(bins.begin(), bins.begin()+shift, bins.end());
-
-  if(debug_x)
+  int row = 0;
+  const vector<fftwf_plan>& ffts = layout_->frameFfts;
+  for(int i=(int)ffts.size()-1; i>=0; i--)
   {
-    stringstream fileName;
-    fileName << "OutputData//RxSymbolBinsRotated" << symbolCount_;
-    RawFileUtility::write(bins.begin(), bins.end(),
-                          fileName.str());
+    int batch = 1<<i;
+    for(; numSymbols-row >= batch; row += batch)
+    {
+      fftwf_complex* rowData = (fftwf_complex*)(ws.bins+row*binStride_);
+      fftwf_execute_dft(ffts[i], rowData, rowData);
+    }
   }
+}
+
+void OfdmDemodulatorComponent::demodSymbol(const FrameJob& job,
+                                           Workspace& ws, int row,
+                                           ByteVecIt outBegin, ByteVecIt outEnd,
+                                           int modulationDepth)
+{
+  Cplx* bins = ws.bins + row*binStride_;
+  int index = ws.symbolCount;
+  capture(SYMBOL_BINS, job.number, index, bins, bins+numBins_);
 
-  equalizeSymbol(bins.begin(), bins.end());
+  int shift = (numBins_-job.intFreqOffset*2)%numBins_;
 
-  if(debug_x)
+  if(!capture_.wants(SYMBOL_BINS_ROTATED, job.number) &&
+     !capture_.wants(SYMBOL_BINS_EQUALIZED, job.number))
   {
-    stringstream fileName;
-    fileName << "OutputData//RxSymbolBinsEqualized" << symbolCount_;
-    RawFileUtility::write(bins.begin(), bins.end(),
-                          fileName.str());
+    ws.pilotError += symbolEqualizer_.equalize(bins, shift, &job.equalizer[0],
+                                               &ws.qamSymbols[0]);
   }
+  else
+  {
+    // Step through the equalization so each stage can be captured
+    rotate(bins, bins+shift, bins+numBins_);
+    capture(SYMBOL_BINS_ROTATED, job.number, index, bins, bins+numBins_);
 
-  CplxVec qamSymbols;
-  for(int i=0; i<numDataCarriers_x; i++)
-    qamSymbols.push_back(bins[dataIndices_[i]]);
-
+    equalizeSymbol(job, bins, bins+numBins_);
+    capture(SYMBOL_BINS_EQUALIZED, job.number, index, bins, bins+numBins_);
+    ws.pilotError += symbolEqualizer_.pilotError(bins);
 
-  if(debug_x)
-  {
-    stringstream fileName;
-    fileName << "OutputData//RxSymbolData" << symbolCount_;
-    RawFileUtility::write(qamSymbols.begin(), qamSymbols.end(),
-                          fileName.str());
+    for(int i=0; i<numDataCarriers_x; i++)
+      ws.qamSymbols[i] = bins[layout_->dataIndices[i]];
   }
+  capture(SYMBOL_DATA, job.number, index,
+          ws.qamSymbols.begin(), ws.qamSymbols.end());
 
-  qDemod_.demodulate(qamSymbols.begin(), qamSymbols.end(),
+  qDemod_.demodulate(ws.qamSymbols.begin(), ws.qamSymbols.end(),
                      outBegin, outEnd, modulationDepth);
 }
 
-void OfdmDemodulatorComponent::generateFractionalOffsetCorrector(float offset)
-{
-  float relFreq = -offset/numBins_;
-  toneGenerator_.generate(corrector_.begin(), corrector_.end(), relFreq);
-  if(debug_x)
-    RawFileUtility::write(corrector_.begin(), corrector_.end(),
-                          "OutputData/RxFreqCorrector");
-}
-
+/** Correct the fractional frequency offset of the received preamble.
+ *
+ * The samples are mixed in place with a tone at the negated offset. The
+ * tone itself is only generated if it is being captured.
+ *
+ * @param begin   Iterator to first sample of the received preamble.
+ * @param end     Iterator to one past last sample.
+ */
 void OfdmDemodulatorComponent::correctFractionalOffset(CplxVecIt begin,
                                                        CplxVecIt end)
 {
-  transform(begin, end, corrector_.begin(), begin, _1*_2);
+  corrector_.setFrequency(-fracFreqOffset_/numBins_);
+  corrector_.setPhase(0);
+  if(capture_.wants(FREQ_CORRECTOR, job_->number))
+  {
+    CplxVec tone(end-begin);
+    corrector_.generate(tone.begin(), tone.end());
+    capture(FREQ_CORRECTOR, job_->number, 0, tone.begin(), tone.end());
+    corrector_.setPhase(0);
+  }
+  corrector_.mix(begin, end);
 }
 
 int OfdmDemodulatorComponent::findIntegerOffset(CplxVecIt begin, CplxVecIt end)
 {
-  FloatVec magRxBins(numBins_/2);
-  transform(begin, end, magRxBins.begin(), opAbs());
-
-  FloatVec magTxBins(numBins_);
-  transform(preambleBins_.begin(), preambleBins_.end(),
-            magTxBins.begin(), opAbs());
-  FloatVecIt it = magTxBins.begin();
-  copy(it, it+(numBins_/2), it+(numBins_/2));
+  transform(begin, end, magRxBins_.begin(), opAbs());
 
-  FloatVec correlations;
+  FloatVecIt corrIt = correlations_.begin();
   //Calculate negative offset correlations
-  FloatVecIt txIt = magTxBins.begin()+(numBins_/2);
+  FloatVecIt txIt = magTxBins_.begin()+(numBins_/2);
   for(int i=-16; i<0; i++)
-  {
-    float res = inner_product(txIt+i, txIt+i+(numBins_/2),
-                              magRxBins.begin(), 0.0f);
-    correlations.push_back(res);
-  }
+    *corrIt++ = inner_product(txIt+i, txIt+i+(numBins_/2),
+                              magRxBins_.begin(), 0.0f);
   //Calculate positive offset correlations
-  txIt = magTxBins.begin();
+  txIt = magTxBins_.begin();
   for(int i=0; i<17; i++)
-  {
-    float res = inner_product(txIt+i, txIt+i+(numBins_/2),
-                              magRxBins.begin(), 0.0f);
-    correlations.push_back(res);
-  }
+    *corrIt++ = inner_product(txIt+i, txIt+i+(numBins_/2),
+                              magRxBins_.begin(), 0.0f);
 
-  if(debug_x)
-    RawFileUtility::write(correlations.begin(), correlations.end(),
-                          "OutputData/RxFreqOffsetCorrelations");
+  capture(FREQ_OFFSET_CORRELATIONS, job_->number, 0,
+          correlations_.begin(), correlations_.end());
 
-  FloatVecIt result = max_element(correlations.begin(), correlations.end());
-  int off =  (int)distance(correlations.begin(), result) - 16;
+  FloatVecIt result = max_element(correlations_.begin(), correlations_.end());
+  int off =  (int)distance(correlations_.begin(), result) - 16;
   return off;
 }
 
 void OfdmDemodulatorComponent::generateEqualizer(CplxVecIt begin, CplxVecIt end)
 {
-  CplxVec shortEq(numBins_/2);
+  CplxVec& shortEq = shortEqualizer_;
+  CplxVec& equalizer = job_->equalizer;
   transform(begin, end, preambleBins_.begin(), shortEq.begin(), _2/_1);
 
-  if(debug_x)
-    RawFileUtility::write(shortEq.begin(), shortEq.end(),
-                          "OutputData/RxShortEqualizer");
+  capture(SHORT_EQUALIZER, job_->number, 0, shortEq.begin(), shortEq.end());
 
-  shortEq[0] = (shortEq[(numBins_/2)-1] + shortEq[1])/Cplx(2,0);
+  shortEq[0] = interpolateEq(shortEq[(numBins_/2)-1], shortEq[1]);
   for(int i=0; i<numBins_/2; i++)
-    equalizer_[i*2] = shortEq[i];
+    equalizer[i*2] = shortEq[i];
   for(int i=1; i<numBins_; i+=2)
-    equalizer_[i] = (equalizer_[i-1] + equalizer_[(i+1)%numBins_])/Cplx(2,0);
-  equalizer_[0] = Cplx(0,0);
+    equalizer[i] = interpolateEq(equalizer[i-1], equalizer[(i+1)%numBins_]);
+  equalizer[0] = Cplx(0,0);
 
-  if(debug_x)
-    RawFileUtility::write(equalizer_.begin(), equalizer_.end(),
-                          "OutputData/RxEqualizer");
+  capture(EQUALIZER, job_->number, 0, equalizer.begin(), equalizer.end());
 }
 
-void OfdmDemodulatorComponent::equalizeSymbol(CplxVecIt begin, CplxVecIt end)
+/** Generate the LLR weight of each data carrier of the current frame.
+ *
+ * Noise on the full-length bins has a quarter of the variance of the
+ * difference between the (scaled) half-length preamble bins. The variance
+ * is averaged over the occupied preamble carriers and scaled by the
+ * equalizer gain of each data carrier.
+ *
+ * @param begin   Iterator to first rotated preamble difference bin.
+ * @param end     Iterator to one past the last difference bin.
+ */
+void OfdmDemodulatorComponent::generateLlrWeights(CplxVecIt begin,
+                                                  CplxVecIt end)
 {
-  transform(begin, end, equalizer_.begin(), begin, _1*_2);
+  float sum = 0;
+  for(int i=0; i<preambleCarriers_.size(); i++)
+    sum += norm(*(begin+preambleCarriers_[i]));
+  float noiseVar = sum/(4*preambleCarriers_.size());
 
-  CplxVec pilots;
-  for(int i=0; i<numPilotCarriers_x; i++)
-    pilots.push_back(*(begin+pilotIndices_[i]));
+  CplxVec& equalizer = job_->equalizer;
+  FloatVec& weights = job_->llrWeights;
+  for(int i=0; i<numDataCarriers_x; i++)
+  {
+    float var = noiseVar*norm(equalizer[layout_->dataIndices[i]]);
+    weights[i] = 1.0f/max(var, 1e-12f);
+  }
 
-  CplxVec diffs;
-  for(int i=0; i<numPilotCarriers_x; i++)
-    diffs.push_back(pilotSequence_[i%numPilotCarriers_x]/pilots[i]);
+  capture(LLR_WEIGHTS, job_->number, 0, weights.begin(), weights.end());
+}
+
+void OfdmDemodulatorComponent::equalizeSymbol(const FrameJob& job,
+                                              Cplx* begin, Cplx* end)
+{
+  transform(begin, end, job.equalizer.begin(), begin, _1*_2);
 
-  Cplx sum = accumulate(diffs.begin(), diffs.end(), Cplx(0,0));
+  Cplx sum(0,0);
+  for(int i=0; i<numPilotCarriers_x; i++)
+    sum += pilotSequence_[i%pilotSequence_.size()]/(*(begin+layout_->pilotIndices[i]));
   float ave = arg(sum/(float)numPilotCarriers_x);
 
   Cplx corrector = Cplx(cos(ave), sin(ave));
@@ -49,13 +49,21 @@
 #ifndef PHY_OFDMDEMODULATORCOMPONENT_H_
 #define PHY_OFDMDEMODULATORCOMPONENT_H_
 
+#include <string>
+#include <boost/noncopyable.hpp>
 #include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include <boost/exception_ptr.hpp>
 #include "fftw3.h"
+#include "math/FftwPlanner.h"
+#include "utility/DebugCapture.h"
 
 #include "irisapi/PhyComponent.h"
 #include "modulation/OfdmPreambleDetector.h"
-#include "modulation/ToneGenerator.h"
+#include "modulation/Nco.h"
 #include "modulation/QamDemodulator.h"
+#include "modulation/OfdmEqualizer.h"
 #include "modulation/OfdmPreambleGenerator.h"
 #include "math/MathDefines.h"
 
@@ -66,7 +74,10 @@ namespace phy
 
 /** An OFDM demodulation component. Takes a block of samples in
  * complex<float> format and outputs a block of uint8_t bytes each
- * time an OFDM frame is demodulated. The demodulator expects frames
+ * time an OFDM frame is demodulated. Optionally, per-bit log-likelihood
+ * ratios (LLRs) of each frame are output on a second port for use by a
+ * downstream decoder, and a metrics record of each frame can be output
+ * on a third port or as an event. The demodulator expects frames
  * with the following structure:                                           <br>
  *             -----------------------------------                         <br>
  *             | Preamble | Header | Data ...... |                         <br>
@@ -78,6 +89,7 @@ class OfdmDemodulatorComponent
 public:
   typedef std::vector<uint8_t>  ByteVec;
   typedef ByteVec::iterator     ByteVecIt;
+  typedef std::vector<int8_t>   Int8Vec;
   typedef std::vector<int>      IntVec;
   typedef IntVec::iterator      IntVecIt;
   typedef std::vector<float>    FloatVec;
@@ -86,6 +98,20 @@ public:
   typedef std::vector<Cplx>     CplxVec;
   typedef CplxVec::iterator     CplxVecIt;
 
+  /// Fields of each frame metrics record (a vector of doubles).
+  enum MetricsField
+  {
+    METRICS_TIMESTAMP,    ///< Timestamp of the start of the frame.
+    METRICS_SNR,          ///< SNR estimated by the preamble detector (dB).
+    METRICS_FRAC_CFO,     ///< Fractional frequency offset (subcarriers).
+    METRICS_INT_CFO,      ///< Integer frequency offset (subcarriers).
+    METRICS_PILOT_EVM,    ///< Rms EVM of the equalized data symbol pilots.
+    METRICS_MODULATION,   ///< Modulation depth (bits per symbol).
+    METRICS_NUM_BYTES,    ///< Number of data bytes in the frame.
+    METRICS_CRC_OK,       ///< 1 if the frame passed its framecheck, else 0.
+    NUM_METRICS
+  };
+
   OfdmDemodulatorComponent(std::string name);
   ~OfdmDemodulatorComponent();
   virtual void calculateOutputTypes(
@@ -97,31 +123,171 @@ public:
   virtual void parameterHasChanged(std::string name);
 
 private:
+  /// A received frame and everything needed to demodulate its data symbols.
+  struct FrameJob
+  {
+    enum State {FREE, QUEUED, DONE};
+    State state;              ///< Progress of this job through the worker pool.
+    CplxVec samples;          ///< Data symbols gathered across input blocks.
+    CplxVecIt frame;          ///< First data sample, in samples or the input.
+    bool inPlace;             ///< Does frame point into the input DataSet?
+    CplxVec equalizer;        ///< The equalizer derived from the preamble.
+    int intFreqOffset;        ///< Integer frequency offset of the frame.
+    uint32_t crc;             ///< Received framecheck.
+    uint16_t numBytes;        ///< Number of bytes of data in the frame.
+    uint8_t modulation;       ///< Modulation depth of the frame.
+    int numSymbols;           ///< Number of OFDM symbols in the frame.
+    uint64_t number;          ///< Number of the frame, for debug capture.
+    float snr;                ///< SNR estimated by the preamble detector.
+    float fracFreqOffset;     ///< Fractional frequency offset of the frame.
+    float pilotEvm;           ///< Rms EVM of the data symbol pilots.
+    double timeStamp;         ///< Timestamp of the frame.
+    double sampleRate;        ///< Sample rate of the frame.
+    ByteVec data;             ///< Demodulated frame data.
+    FloatVec llrWeights;      ///< Reciprocal noise variance of data carriers.
+    FloatVec llrs;            ///< Float LLRs of the frame data.
+    Int8Vec llrBytes;         ///< Saturated int8 LLRs of the frame data.
+    bool crcOk;               ///< Did the frame pass its framecheck?
+    boost::exception_ptr error; ///< Exception thrown while demodulating.
+  };
+
+  /// Scratch memory used by a single thread to demodulate symbols.
+  struct Workspace
+  {
+    Cplx* bins;               ///< Bins of all symbols in a frame (SIMD aligned).
+    CplxVec qamSymbols;       ///< Data carrier symbols of the current symbol.
+    int symbolCount;          ///< Index of symbol in current frame.
+    float pilotError;         ///< Summed pilot error power of the frame.
+    Nco corrector;            ///< Fractional frequency offset corrector.
+  };
+
+  /// Parameters which determine the carrier layout and fft plans.
+  struct LayoutKey
+  {
+    int numData;              ///< Number of data carriers.
+    int numPilot;             ///< Number of pilot carriers.
+    int numGuard;             ///< Number of guard carriers.
+    int maxRows;              ///< Most symbols transformed in one frame.
+    int maxBatch;             ///< Most symbols transformed per fft call.
+    std::string planning;     ///< Rigor of fft planning.
+    std::string wisdomFile;   ///< File used to store fftw wisdom.
+
+    bool operator<(const LayoutKey& other) const
+    {
+      if(numData != other.numData)
+        return numData < other.numData;
+      if(numPilot != other.numPilot)
+        return numPilot < other.numPilot;
+      if(numGuard != other.numGuard)
+        return numGuard < other.numGuard;
+      if(maxRows != other.maxRows)
+        return maxRows < other.maxRows;
+      if(maxBatch != other.maxBatch)
+        return maxBatch < other.maxBatch;
+      if(planning != other.planning)
+        return planning < other.planning;
+      return wisdomFile < other.wisdomFile;
+    }
+  };
+
+  /** Carrier indices and fft plans, shared by all demodulators with the
+   * same parameters (e.g. the channels of an OfdmMultiDemodulator).
+   *
+   * The plans are made on scratch arrays with the alignment and row
+   * stride of a demodulator's own buffers and are only run through
+   * fftwf_execute_dft, which is safe to call from any thread.
+   */
+  struct Layout : boost::noncopyable
+  {
+    IntVec pilotIndices;      ///< Indices of the pilot carriers.
+    IntVec dataIndices;       ///< Indices of the data carriers.
+    int binStride;            ///< Distance between symbols in Workspace::bins.
+    fftwf_plan halfFft;       ///< In-place half-length fft.
+    std::vector<fftwf_plan> frameFfts; ///< In-place ffts of 1,2,4... rows.
+
+    explicit Layout(const LayoutKey& key);
+    ~Layout();
+
+   private:
+    void destroyPlans();
+  };
+
   void setup();
   void destroy();
+  void setupWorkspace(Workspace& ws);
+  void destroyWorkspace(Workspace& ws);
   CplxVecIt searchInput(CplxVecIt begin, CplxVecIt end);
   CplxVecIt processFrame(CplxVecIt begin, CplxVecIt end);
+  void acquireJob();
+  void submitJob();
+  void outputFrames(int maxPending);
+  void outputInPlaceFrames();
+  void outputFrame(FrameJob& job);
+  void outputMetrics(const FrameJob& job);
+  void workerThreadFunction(Workspace* ws);
   void extractPreamble();
-  void extractHeader();
-  void demodFrame();
-  void demodSymbol(CplxVecIt inBegin, CplxVecIt inEnd,
+  void extractHeader(CplxVecIt begin);
+  void demodFrame(FrameJob& job, Workspace& ws);
+  void transformSymbols(const FrameJob& job, CplxVecIt begin,
+                        int numSymbols, Workspace& ws);
+  void demodSymbol(const FrameJob& job, Workspace& ws, int row,
                    ByteVecIt outBegin, ByteVecIt outEnd,
                    int modulationDepth);
-  void generateFractionalOffsetCorrector(float offset);
   void correctFractionalOffset(CplxVecIt begin, CplxVecIt end);
   int findIntegerOffset(CplxVecIt begin, CplxVecIt end);
   void generateEqualizer(CplxVecIt begin, CplxVecIt end);
-  void equalizeSymbol(CplxVecIt begin, CplxVecIt end);
+  void generateLlrWeights(CplxVecIt begin, CplxVecIt end);
+  void equalizeSymbol(const FrameJob& job, Cplx* begin, Cplx* end);
 
   struct opAbs{float operator()(Cplx i) const{return abs(i);};};
 
+  /// Stages which can be captured in debug mode (bit i of debugstages).
+  enum DebugStage
+  {
+    KNOWN_PREAMBLE,
+    KNOWN_PREAMBLE_BINS,
+    PREAMBLE,
+    PREAMBLE_HALF_BINS,
+    PREAMBLE_HALF_BINS_ROTATED,
+    FREQ_CORRECTOR,
+    FREQ_OFFSET_CORRELATIONS,
+    SHORT_EQUALIZER,
+    EQUALIZER,
+    LLR_WEIGHTS,
+    SYMBOL_BINS,
+    SYMBOL_BINS_ROTATED,
+    SYMBOL_BINS_EQUALIZED,
+    SYMBOL_DATA
+  };
+
+  /// Capture a range of debug data, if this stage and frame are wanted.
+  template <class It>
+  void capture(DebugStage stage, uint64_t frame, int index, It begin, It end)
+  {
+    if(capture_.wants(stage, frame))
+      capture_.capture(stage, frame, index, &*begin, &*begin+(end-begin));
+  }
+
   bool debug_x;               ///< Debug flag
+  std::string debugFile_x;    ///< File to capture debug data to
+  int debugStages_x;          ///< Mask of captured debug stages (default = all)
+  int debugInterval_x;        ///< Capture one in debugInterval_x frames (default = 1)
   int reportRate_x;           ///< Report performance every reportRate_x frames
   int numDataCarriers_x;      ///< Data subcarriers (default = 192)
   int numPilotCarriers_x;     ///< Pilot subcarriers (default = 8)
   int numGuardCarriers_x;     ///< Guard subcarriers (default = 55)
   int cyclicPrefixLength_x;   ///< Length of cyclic prefix (default = 16)
   float threshold_x;          ///< Frame detection threshold (default = 0.827)
+  int coarseDecimation_x;     ///< Coarse frame search decimation (default = 1)
+  float coarseThreshold_x;    ///< Coarse frame search threshold (default = 0.5)
+  int maxSymbolsPerFrame_x;   ///< Max OFDM data symbols per frame (default = 128)
+  int maxFftBatch_x;          ///< Max symbols transformed per fft call (default = 32)
+  int numWorkers_x;           ///< Demodulation worker threads (default = 0)
+  std::string llrOutput_x;    ///< Type of LLR output: none, float or int8 (default = none)
+  float llrScale_x;           ///< Scale of int8 LLRs (default = 8)
+  std::string metricsOutput_x; ///< Frame metrics output: none, port or event (default = none)
+  std::string fftPlanning_x;  ///< Rigor of fft planning (default = measure)
+  std::string wisdomFile_x;   ///< File used to store fftw wisdom (default = none)
 
   int symbolLength_;          ///< Length of each OFDM symbol including prefix.
   int numBins_;               ///< Number of bins for our FFT.
@@ -134,36 +300,55 @@ private:
   int headerIndex_;           ///< Index into container for header symbols.
   int frameIndex_;            ///< Index into container for frame symbols.
   float fracFreqOffset_;      ///< Fractional frequency offset of current frame.
-  int intFreqOffset_;         ///< Integer frequency offset of current frame.
-  uint32_t rxCrc_;            ///< Received framecheck.
-  uint16_t rxNumBytes_;       ///< Number of bytes of data in received frame.
-  uint8_t rxModulation_;      ///< Modulation depth of received frame.
-  int rxNumSymbols_;          ///< Number of OFDM symbols in received frame.
   int numRxFrames_;           ///< Count of total detected frames.
   int numRxFails_;            ///< Count of frames we failed to demod.
-  int symbolCount_;           ///< Index of symbol in current frame.
+  bool softOutput_;           ///< Are we outputting LLRs?
+  uint64_t frameCount_;       ///< Count of detected frames, for debug capture.
+  std::vector<double> metrics_; ///< Metrics record of the current frame.
 
   DataSet< Cplx >* in_;       ///< Pointer to an input DataSet.
-  IntVec pilotIndices_;       ///< Indices for our pilot carriers.
-  IntVec dataIndices_;        ///< Indices for our data carriers.
+  boost::shared_ptr<const Layout> layout_; ///< Our carrier indices and fft plans.
   CplxVec preamble_;          ///< Contains our known frame preamble.
   CplxVec preambleBins_;      ///< Contains bins of our known preamble.
+  IntVec preambleCarriers_;   ///< Occupied bins of our known preamble.
   CplxVec pilotSequence_;     ///< Contains our known pilot symbols.
   CplxVec rxPreamble_;        ///< Container for received preamble.
   CplxVec rxHeader_;          ///< Container for received header.
-  CplxVec rxFrame_;           ///< Container for received frame.
-  CplxVec equalizer_;         ///< The equalizer for the current frame.
-  CplxVec corrector_;         ///< Fractional frequency offset corrector.
-  ByteVec frameData_;         ///< Container for received frame data.
+  ByteVec headerData_;        ///< Container for received header data.
+
+  // Workspace sized in setup() so that the receive path does not allocate.
+  CplxVec halfBins_;          ///< Half-length bins of the current preamble.
+  CplxVec noiseBins_;         ///< Difference between the preamble halves.
+  CplxVec shortEqualizer_;    ///< Half-length equalizer of the current frame.
+  FloatVec magRxBins_;        ///< Magnitudes of received preamble bins.
+  FloatVec magTxBins_;        ///< Magnitudes of known preamble bins (repeated).
+  FloatVec correlations_;     ///< Integer frequency offset correlations.
+  Workspace workspace_;       ///< Workspace of the input thread.
 
   Cplx* halfFftData_;         ///< Input/output array for half-length fft
-  fftwf_plan halfFft_;        ///< Half-length fft plan
-  Cplx* fullFftData_;         ///< Input/output array for full-length fft
-  fftwf_plan fullFft_;        ///< Full-length fft plan
+  int binStride_;             ///< Distance between symbols in Workspace::bins.
+
+  // Frames are handed from the input thread to the workers through a ring
+  // of jobs. Jobs are queued, demodulated and output in ring order.
+  std::vector<FrameJob> jobs_;          ///< Ring of frame jobs.
+  FrameJob* job_;                       ///< The frame currently being received.
+  int nextJob_;                         ///< Index of the next job to fill.
+  int outputJob_;                       ///< Index of the oldest pending job.
+  int runJob_;                          ///< Index of the next job to demodulate.
+  int numPending_;                      ///< Jobs queued but not yet output.
+  int numQueued_;                       ///< Jobs waiting for a worker.
+  bool stopWorkers_;                    ///< Tell the workers to exit.
+  std::vector<Workspace> workerSpaces_; ///< Workspaces of the workers.
+  boost::scoped_ptr< boost::thread_group > workers_; ///< Worker threads.
+  boost::mutex jobMutex_;               ///< Protects job states and queue.
+  boost::condition_variable jobQueued_; ///< Signalled when a job is queued.
+  boost::condition_variable jobDone_;   ///< Signalled when a job is done.
+  DebugCapture capture_;                ///< Captures debug data to file.
 
   OfdmPreambleDetector detector_;       ///< Our preamble detector.
-  ToneGenerator toneGenerator_;         ///< Our tone generator.
+  Nco corrector_;                       ///< Corrects preamble frequency offsets.
   QamDemodulator qDemod_;               ///< Our QAM demodulator.
+  OfdmEqualizer symbolEqualizer_;       ///< Our fused symbol equalizer.
   OfdmPreambleGenerator preambleGen_;   ///< Our preamble generator.
 
   template <typename T, size_t N>
@@ -32,8 +32,10 @@
  */
 
 #include "../OfdmDemodulatorComponent.h"
+#include <cstdio>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include "OfdmDemodulatorBenchmarkData.h"
+#include "../test/OfdmFrameGenerator.h"
 #include "utility/DataBufferTrivial.h"
 
 using namespace std;
@@ -41,17 +43,26 @@ using namespace iris;
 using namespace iris::phy;
 namespace bp = boost::posix_time;
 
-int main(int argc, char* argv[])
-{
-  typedef complex<float>    Cplx;
-  typedef vector<Cplx>      CplxVec;
-  typedef CplxVec::iterator CplxVecIt;
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+typedef CplxVec::iterator CplxVecIt;
 
+/** Demodulate numFrames test frames and return the rate in MS/sec.
+ *
+ * Frames are passed to the demodulator in blocks of blockSize samples, or
+ * all in one block if blockSize is 0. Frames still with the workers when
+ * the last block returns are not waited for.
+ */
+float runBenchmark(int maxFftBatch, int numWorkers, int numFrames,
+                   int blockSize)
+{
   OfdmDemodulatorComponent mod("test");
   mod.setValue("numdatacarriers", 40);
   mod.setValue("numpilotcarriers", 8);
   mod.setValue("numguardcarriers", 15);
   mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("maxfftbatch", maxFftBatch);
+  mod.setValue("numworkers", numWorkers);
   mod.registerPorts();
 
   map<string, int> iTypes,oTypes;
@@ -62,17 +73,79 @@ int main(int argc, char* argv[])
   DataBufferTrivial< uint8_t > out;
 
   // Create enough data for "numFrames" full frames
-  int numFrames = 10000;
   int frameSize = OfdmDemodulatorBenchmarkData::testFrame1.size();
-  DataSet< Cplx >* iSet = NULL;
-  in.getWriteData(iSet, frameSize*numFrames);
-  CplxVecIt it = iSet->data.begin();
+  CplxVec samples(frameSize*numFrames);
+  CplxVecIt it = samples.begin();
   for(int i=0;i<numFrames;i++,it+=frameSize)
   {
     copy(OfdmDemodulatorBenchmarkData::testFrame1.begin(),
          OfdmDemodulatorBenchmarkData::testFrame1.end(),
          it);
   }
+  if(blockSize == 0)
+    blockSize = samples.size();
+
+  // Fill the input buffer first so only the demodulator is timed
+  DataSet< Cplx >* iSet = NULL;
+  int numBlocks = 0;
+  for(int i=0; i<samples.size(); i+=blockSize, numBlocks++)
+  {
+    int len = min(blockSize, (int)samples.size()-i);
+    in.getWriteData(iSet, len);
+    copy(samples.begin()+i, samples.begin()+i+len, iSet->data.begin());
+    in.releaseWriteData(iSet);
+  }
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(int i=0; i<numBlocks; i++)
+    mod.process();
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  bp::time_duration time = t2-t1;
+  float megSampsPerSec = (numFrames*frameSize/1.0e6)*(1.0e9/time.total_nanoseconds());
+  cout << "maxfftbatch = " << maxFftBatch
+       << ", numworkers = " << numWorkers
+       << ", blocksize = " << blockSize << ": "
+       << megSampsPerSec << " MS/sec, "
+       << megSampsPerSec*1.0e6/frameSize << " frames/sec" << endl;
+  return megSampsPerSec;
+}
+
+/** Demodulate frames of numSymbols QAM16 symbols and return the goodput
+ * in Mbit/sec. Also reports the share of transmitted samples which carry
+ * data, after preamble, header and frame guard overhead.
+ */
+float runGoodputBenchmark(int numSymbols, int numFrames)
+{
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("numdatacarriers", 40);
+  mod.setValue("numpilotcarriers", 8);
+  mod.setValue("numguardcarriers", 15);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("maxsymbolsperframe", 1024);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out;
+
+  vector<uint8_t> data(numSymbols*20);
+  for(int i=0; i<data.size(); i++)
+    data[i] = i%251;
+  CplxVec frame = OfdmFrameGenerator::createFrame(data, 4, 40, 8, 15, 8);
+  int frameSize = frame.size();
+
+  DataSet< Cplx >* iSet = NULL;
+  in.getWriteData(iSet, frameSize*numFrames);
+  CplxVecIt it = iSet->data.begin();
+  for(int i=0;i<numFrames;i++,it+=frameSize)
+    copy(frame.begin(), frame.end(), it);
   in.releaseWriteData(iSet);
 
   mod.setBuffers(&in,&out);
@@ -83,6 +156,81 @@ int main(int argc, char* argv[])
   bp::ptime t2(bp::microsec_clock::local_time());
 
   bp::time_duration time = t2-t1;
-  float megSampsPerSec = (numFrames*frameSize/1.0e6)*(1.0e9/time.total_nanoseconds());
-  cout << "Rate = " << megSampsPerSec << " MS/sec" << endl;
+  float megBitsPerSec = (numFrames*data.size()*8/1.0e6)*
+                        (1.0e9/time.total_nanoseconds());
+  float efficiency = numSymbols*(40+8+15+1+8)/(float)frameSize;
+  cout << "symbols per frame = " << numSymbols << ": "
+       << megBitsPerSec << " Mbit/sec goodput, "
+       << efficiency*100 << "% of samples carry data" << endl;
+  return megBitsPerSec;
+}
+
+/// Time the startup of a demodulator with default carriers, in ms.
+float timeStartup(string planning, string wisdomFile)
+{
+  bp::ptime t1(bp::microsec_clock::local_time());
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("fftplanning", planning);
+  mod.setValue("wisdomfile", wisdomFile);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+  mod.initialize();
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  float ms = (t2-t1).total_microseconds()/1000.0;
+  cout << "fftplanning = " << planning
+       << ", wisdomfile = \"" << wisdomFile << "\": "
+       << ms << " ms startup" << endl;
+  return ms;
+}
+
+int main(int argc, char* argv[])
+{
+  // Each startup begins without wisdom in memory, as a new process would
+  string wisdomFile = "OfdmDemodulatorBenchmark.wisdom";
+  remove(wisdomFile.c_str());
+  string rigors[] = {"estimate", "measure", "patient"};
+  for(int i=0; i<3; i++)
+  {
+    FftwPlanner::forgetWisdom();
+    float cold = timeStartup(rigors[i], wisdomFile);
+    FftwPlanner::forgetWisdom();
+    float warm = timeStartup(rigors[i], wisdomFile);
+    cout << "Wisdom startup gain = " << cold/warm << "x" << endl;
+  }
+  remove(wisdomFile.c_str());
+
+  int numFrames = 10000;
+  float single = runBenchmark(1, 0, numFrames, 0);
+  float batched = runBenchmark(32, 0, numFrames, 0);
+  cout << "Batched fft gain = " << batched/single << "x" << endl;
+
+  int numCores = max(1u, boost::thread::hardware_concurrency());
+  for(int workers=1; workers<=numCores; workers*=2)
+  {
+    float rate = runBenchmark(32, workers, numFrames, 0);
+    cout << "Worker pool gain = " << rate/batched << "x" << endl;
+  }
+
+  // Blocks of about one and a half frames, as from the engine. Most frames
+  // span two blocks and are demodulated while the next block is searched.
+  int blockSize = OfdmDemodulatorBenchmarkData::testFrame1.size()*3/2;
+  float serialBlocks = runBenchmark(32, 0, numFrames, blockSize);
+  for(int workers=1; workers<=numCores; workers*=2)
+  {
+    float rate = runBenchmark(32, workers, numFrames, blockSize);
+    cout << "Small block worker pool gain = " << rate/serialBlocks << "x"
+         << endl;
+  }
+
+  // Longer frames amortize the preamble and header
+  float shortest = runGoodputBenchmark(4, 2000);
+  for(int numSymbols=8; numSymbols<=1024; numSymbols*=2)
+  {
+    float rate = runGoodputBenchmark(numSymbols, 8000/numSymbols);
+    cout << "Frame length goodput gain = " << rate/shortest << "x" << endl;
+  }
 }
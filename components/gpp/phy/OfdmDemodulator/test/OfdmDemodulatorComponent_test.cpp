@@ -34,8 +34,13 @@
 #define BOOST_TEST_MODULE OfdmDemodulatorComponent_Test
 
 #include <boost/test/unit_test.hpp>
+#include <boost/random.hpp>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
 
 #include "../OfdmDemodulatorComponent.h"
+#include "OfdmFrameGenerator.h"
 #include "OfdmDemodulatorTestData.h"
 #include "utility/DataBufferTrivial.h"
 
@@ -43,6 +48,74 @@ using namespace std;
 using namespace iris;
 using namespace iris::phy;
 
+/// Count heap allocations made while countAllocs is set.
+static bool countAllocs = false;
+static int numAllocs = 0;
+
+void* operator new(std::size_t size)
+{
+  if(countAllocs)
+    numAllocs++;
+  void* p = std::malloc(size);
+  if(p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void* p) throw()
+{
+  std::free(p);
+}
+
+/** A buffer which reuses a single DataSet, as the engine's DataBuffer does
+ * once it has warmed up. Unlike DataBufferTrivial, getting and releasing
+ * DataSets of a previously seen size does not allocate.
+ */
+template <typename T>
+class RecyclingBuffer
+  : public DataBufferTrivial<T>
+{
+public:
+  RecyclingBuffer() : hasData_(false) {}
+  virtual bool hasData() const { return hasData_; }
+  virtual void getReadData(DataSet<T>*& setPtr) { setPtr = &set_; }
+  virtual void releaseReadData(DataSet<T>*& setPtr)
+  {
+    hasData_ = false;
+    setPtr = NULL;
+  }
+  virtual void getWriteData(DataSet<T>*& setPtr, std::size_t size)
+  {
+    set_.data.resize(size);
+    setPtr = &set_;
+  }
+  virtual void releaseWriteData(DataSet<T>*& setPtr)
+  {
+    hasData_ = true;
+    setPtr = NULL;
+  }
+
+private:
+  DataSet<T> set_;
+  bool hasData_;
+};
+
+/// A DataBufferTrivial which counts the DataSets written to it.
+template <typename T>
+class CountingBuffer
+  : public DataBufferTrivial<T>
+{
+public:
+  CountingBuffer() : numWritten(0) {}
+  virtual void releaseWriteData(DataSet<T>*& setPtr)
+  {
+    DataBufferTrivial<T>::releaseWriteData(setPtr);
+    numWritten++;
+  }
+
+  int numWritten;
+};
+
 BOOST_AUTO_TEST_SUITE (OfdmDemodulatorComponent_Test)
 
 BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Basic_Test)
@@ -58,6 +131,9 @@ BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Parm_Test)
   BOOST_CHECK(mod.getParameterDefaultValue("numguardcarriers") == "55");
   BOOST_CHECK(mod.getParameterDefaultValue("cyclicprefixlength") == "16");
   BOOST_CHECK(mod.getParameterDefaultValue("threshold") == "0.827");
+  BOOST_CHECK(mod.getParameterDefaultValue("coarsedecimation") == "1");
+  BOOST_CHECK(mod.getParameterDefaultValue("coarsethreshold") == "0.5");
+  BOOST_CHECK(mod.getParameterDefaultValue("maxsymbolsperframe") == "128");
 }
 
 BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Ports_Test)
@@ -183,4 +259,557 @@ BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Demod_Test2)
   out.releaseReadData(oSet);
 }
 
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_NoAlloc_Test)
+{
+  typedef complex<float>    Cplx;
+
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("numdatacarriers", 40);
+  mod.setValue("numpilotcarriers", 8);
+  mod.setValue("numguardcarriers", 15);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("reportrate", 1000000);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  RecyclingBuffer< Cplx > in;
+  RecyclingBuffer< uint8_t > out;
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  // The first frame warms up the buffers, the rest must not allocate
+  for(int n=0; n<4; n++)
+  {
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, OfdmDemodulatorTestData::testFrame1.size());
+    copy(OfdmDemodulatorTestData::testFrame1.begin(),
+         OfdmDemodulatorTestData::testFrame1.end(),
+         iSet->data.begin());
+    in.releaseWriteData(iSet);
+
+    numAllocs = 0;
+    countAllocs = true;
+    mod.process();
+    countAllocs = false;
+    if(n > 0)
+      BOOST_CHECK(numAllocs == 0);
+
+    BOOST_REQUIRE(out.hasData());
+    DataSet< uint8_t >* oSet = NULL;
+    out.getReadData(oSet);
+    for(int i=0; i<oSet->data.size(); i++)
+      BOOST_CHECK(oSet->data[i]==i);
+    out.releaseReadData(oSet);
+  }
+}
+
+/// Demodulate numFrames copies of testFrame1 in blocks of blockSize samples.
+static void demodFrames(int numWorkers, int numFrames, int blockSize,
+                        CountingBuffer< uint8_t >& out)
+{
+  typedef complex<float>    Cplx;
+  typedef vector<Cplx>      CplxVec;
+
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("numdatacarriers", 40);
+  mod.setValue("numpilotcarriers", 8);
+  mod.setValue("numguardcarriers", 15);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("numworkers", numWorkers);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  int frameSize = OfdmDemodulatorTestData::testFrame1.size();
+  CplxVec samples(frameSize*numFrames);
+  for(int i=0; i<numFrames; i++)
+    copy(OfdmDemodulatorTestData::testFrame1.begin(),
+         OfdmDemodulatorTestData::testFrame1.end(),
+         samples.begin()+i*frameSize);
+
+  DataSet< Cplx >* iSet = NULL;
+  for(int i=0; i<samples.size(); i+=blockSize)
+  {
+    int len = min(blockSize, (int)samples.size()-i);
+    in.getWriteData(iSet, len);
+    copy(samples.begin()+i, samples.begin()+i+len, iSet->data.begin());
+    iSet->sampleRate = 1e6;
+    iSet->timeStamp = i/1e6;
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(mod.process());
+  }
+
+  // Frames gathered across blocks may still be with the workers. They are
+  // output by later calls, so keep the input flowing until they arrive.
+  for(int i=0; i<10000 && out.numWritten<numFrames; i++)
+  {
+    in.getWriteData(iSet, 100);
+    fill(iSet->data.begin(), iSet->data.end(), Cplx(0,0));
+    iSet->sampleRate = 1e6;
+    iSet->timeStamp = (samples.size()+i*100)/1e6;
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(mod.process());
+    boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Workers_Test)
+{
+  int numFrames = 20;
+  int frameSize = OfdmDemodulatorTestData::testFrame1.size();
+  int blockSizes[] = {frameSize*numFrames, 1000, 4};
+
+  for(int b=0; b<3; b++)
+  {
+    CountingBuffer< uint8_t > serialOut;
+    CountingBuffer< uint8_t > workerOut;
+    demodFrames(0, numFrames, blockSizes[b], serialOut);
+    demodFrames(4, numFrames, blockSizes[b], workerOut);
+
+    // Frames must come out complete, in order and with the same timestamps
+    for(int n=0; n<numFrames; n++)
+    {
+      BOOST_REQUIRE(serialOut.hasData());
+      BOOST_REQUIRE(workerOut.hasData());
+      DataSet< uint8_t >* sSet = NULL;
+      DataSet< uint8_t >* wSet = NULL;
+      serialOut.getReadData(sSet);
+      workerOut.getReadData(wSet);
+      BOOST_REQUIRE(sSet->data.size() == wSet->data.size());
+      BOOST_CHECK(sSet->data == wSet->data);
+      BOOST_CHECK_CLOSE(sSet->timeStamp, wSet->timeStamp, 1e-6);
+      BOOST_CHECK(wSet->timeStamp >= n*frameSize/1e6);
+      BOOST_CHECK(wSet->timeStamp < (n+1)*frameSize/1e6);
+      serialOut.releaseReadData(sSet);
+      workerOut.releaseReadData(wSet);
+    }
+    BOOST_CHECK(!workerOut.hasData());
+  }
+}
+
+/// Demodulate testFrame1 with LLR output and compare LLRs with the data.
+template <typename T>
+static void checkLlrs(string llrType)
+{
+  typedef complex<float>    Cplx;
+
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("numdatacarriers", 40);
+  mod.setValue("numpilotcarriers", 8);
+  mod.setValue("numguardcarriers", 15);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("llroutput", llrType);
+  mod.registerPorts();
+
+  vector<Port> oPorts = mod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 2);
+  BOOST_REQUIRE(oPorts.back().portName == "output2");
+  BOOST_REQUIRE(oPorts.back().supportedTypes.front() ==
+      TypeInfo< T >::identifier);
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+  BOOST_REQUIRE(oTypes["output2"] == TypeInfo< T >::identifier);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out;
+  DataBufferTrivial< T > llrOut;
+  vector<ReadBufferBase*> ins(1, &in);
+  vector<WriteBufferBase*> outs;
+  outs.push_back(&out);
+  outs.push_back(&llrOut);
+  mod.setBuffers(ins,outs);
+  mod.initialize();
+
+  DataSet< Cplx >* iSet = NULL;
+  in.getWriteData(iSet, OfdmDemodulatorTestData::testFrame1.size());
+  copy(OfdmDemodulatorTestData::testFrame1.begin(),
+       OfdmDemodulatorTestData::testFrame1.end(),
+       iSet->data.begin());
+  in.releaseWriteData(iSet);
+  BOOST_REQUIRE_NO_THROW(mod.process());
+
+  BOOST_REQUIRE(out.hasData());
+  BOOST_REQUIRE(llrOut.hasData());
+  DataSet< uint8_t >* oSet = NULL;
+  DataSet< T >* lSet = NULL;
+  out.getReadData(oSet);
+  llrOut.getReadData(lSet);
+
+  // Positive LLRs are zero bits, most significant bit first
+  BOOST_REQUIRE(lSet->data.size() == oSet->data.size()*8);
+  for(int i=0; i<lSet->data.size(); i++)
+  {
+    int bit = (oSet->data[i/8] >> (7-i%8)) & 1;
+    BOOST_CHECK(bit ? lSet->data[i] < 0 : lSet->data[i] > 0);
+  }
+  out.releaseReadData(oSet);
+  llrOut.releaseReadData(lSet);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Llr_Test)
+{
+  checkLlrs< float >("float");
+  checkLlrs< int8_t >("int8");
+}
+
+/** Check that the equalizer has unit gain on the data carriers.
+ *
+ * Noise is added to testFrame1 (whose data symbols are BPSK) such that
+ * each equalized data carrier sees a noise variance of var. The mean LLR
+ * of a correctly scaled equalizer and noise estimate is then 4/var in the
+ * direction of the transmitted bit. An equalizer with gain g on the data
+ * carriers would give a mean of 4/(g*var).
+ */
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_LlrScale_Test)
+{
+  typedef complex<float>    Cplx;
+  typedef vector<Cplx>      CplxVec;
+
+  int numData = 40;
+  int numActive = 48;
+  int numBins = 64;
+  float var = 0.1;
+
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("numdatacarriers", numData);
+  mod.setValue("numpilotcarriers", numActive-numData);
+  mod.setValue("numguardcarriers", numBins-numActive-1);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("llroutput", "float");
+  mod.registerPorts();
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out;
+  DataBufferTrivial< float > llrOut;
+  vector<ReadBufferBase*> ins(1, &in);
+  vector<WriteBufferBase*> outs;
+  outs.push_back(&out);
+  outs.push_back(&llrOut);
+  mod.setBuffers(ins,outs);
+  mod.initialize();
+
+  // Received data carriers have an amplitude of numBins/numActive and
+  // noise of numBins times the time-domain noise variance
+  float noiseVar = var*numBins/(numActive*numActive);
+  boost::mt19937 rng(5);
+  boost::normal_distribution<float> dist(0, sqrt(noiseVar/2));
+  boost::variate_generator< boost::mt19937&, boost::normal_distribution<float> >
+      noise(rng, dist);
+
+  const CplxVec& frame = OfdmDemodulatorTestData::testFrame1;
+  int numFrames = 20;
+  int gap = 200;
+  for(int n=0; n<numFrames; n++)
+  {
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, frame.size()+gap);
+    for(int i=0; i<iSet->data.size(); i++)
+    {
+      Cplx x = i < frame.size() ? frame[i] : Cplx(0,0);
+      iSet->data[i] = x + Cplx(noise(), noise());
+    }
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(mod.process());
+  }
+
+  // Positive LLRs are zero bits and the data bytes count up from zero
+  double sum = 0;
+  int numBits = 0;
+  int numLlrFrames = 0;
+  while(llrOut.hasData())
+  {
+    DataSet< float >* lSet = NULL;
+    llrOut.getReadData(lSet);
+    for(int i=0; i<lSet->data.size(); i++)
+    {
+      int bit = ((i/8) >> (7-i%8)) & 1;
+      sum += bit ? -lSet->data[i] : lSet->data[i];
+      numBits++;
+    }
+    llrOut.releaseReadData(lSet);
+    numLlrFrames++;
+  }
+
+  BOOST_REQUIRE(numLlrFrames == numFrames);
+  BOOST_CHECK_CLOSE(sum/numBits, 4/var, 10);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Debug_Test)
+{
+  typedef complex<float>    Cplx;
+
+  // Capture only the equalized data carriers of every other frame
+  OfdmDemodulatorComponent mod("test");
+  mod.setValue("numdatacarriers", 40);
+  mod.setValue("numpilotcarriers", 8);
+  mod.setValue("numguardcarriers", 15);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("debugfile", "OfdmDemodulatorComponent_test.cap");
+  mod.setValue("debugstages", 1<<13);
+  mod.setValue("debuginterval", 2);
+  mod.setValue("debug", true);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out;
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  int numFrames = 4;
+  DataSet< Cplx >* iSet = NULL;
+  for(int i=0; i<numFrames; i++)
+  {
+    in.getWriteData(iSet, OfdmDemodulatorTestData::testFrame1.size());
+    copy(OfdmDemodulatorTestData::testFrame1.begin(),
+         OfdmDemodulatorTestData::testFrame1.end(),
+         iSet->data.begin());
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(mod.process());
+  }
+
+  // Debug capture must not change the demodulated data
+  for(int i=0; i<numFrames; i++)
+  {
+    BOOST_REQUIRE(out.hasData());
+    DataSet< uint8_t >* oSet = NULL;
+    out.getReadData(oSet);
+    for(int j=0; j<oSet->data.size(); j++)
+      BOOST_CHECK(oSet->data[j]==j);
+    out.releaseReadData(oSet);
+  }
+
+  // Turning debug off closes the capture file
+  mod.setValue("debug", false);
+
+  vector<string> stages;
+  vector<DebugCapture::Record> records;
+  DebugCapture::read("OfdmDemodulatorComponent_test.cap", stages, records);
+  BOOST_REQUIRE(stages.size() == 14);
+  BOOST_CHECK(stages[13] == "RxSymbolData");
+  BOOST_REQUIRE(!records.empty());
+  BOOST_CHECK(records.size()%2 == 0);
+  for(int i=0; i<records.size(); i++)
+  {
+    BOOST_CHECK(records[i].stage == 13);
+    BOOST_CHECK(records[i].frame%2 == 0);
+    BOOST_CHECK(records[i].data.size() == 40*sizeof(Cplx));
+  }
+  remove("OfdmDemodulatorComponent_test.cap");
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Metrics_Test)
+{
+  typedef complex<float>    Cplx;
+  typedef OfdmDemodulatorComponent Demod;
+
+  Demod mod("test");
+  mod.setValue("numdatacarriers", 40);
+  mod.setValue("numpilotcarriers", 8);
+  mod.setValue("numguardcarriers", 15);
+  mod.setValue("cyclicprefixlength", 8);
+  mod.setValue("metricsoutput", "port");
+  mod.registerPorts();
+
+  vector<Port> oPorts = mod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 2);
+  BOOST_REQUIRE(oPorts.back().portName == "output3");
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+  BOOST_REQUIRE(oTypes["output3"] == TypeInfo< double >::identifier);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out;
+  DataBufferTrivial< double > metricsOut;
+  vector<ReadBufferBase*> ins(1, &in);
+  vector<WriteBufferBase*> outs;
+  outs.push_back(&out);
+  outs.push_back(&metricsOut);
+  mod.setBuffers(ins,outs);
+  mod.initialize();
+
+  DataSet< Cplx >* iSet = NULL;
+  in.getWriteData(iSet, OfdmDemodulatorTestData::testFrame1.size());
+  copy(OfdmDemodulatorTestData::testFrame1.begin(),
+       OfdmDemodulatorTestData::testFrame1.end(),
+       iSet->data.begin());
+  iSet->sampleRate = 1e6;
+  iSet->timeStamp = 10;
+  in.releaseWriteData(iSet);
+  BOOST_REQUIRE_NO_THROW(mod.process());
+
+  BOOST_REQUIRE(out.hasData());
+  BOOST_REQUIRE(metricsOut.hasData());
+  DataSet< uint8_t >* oSet = NULL;
+  DataSet< double >* mSet = NULL;
+  out.getReadData(oSet);
+  metricsOut.getReadData(mSet);
+
+  // The test frame is clean and has no frequency offset
+  vector<double>& m = mSet->data;
+  BOOST_REQUIRE(m.size() == Demod::NUM_METRICS);
+  BOOST_CHECK(m[Demod::METRICS_TIMESTAMP] == oSet->timeStamp);
+  BOOST_CHECK(m[Demod::METRICS_TIMESTAMP] >= 10);
+  BOOST_CHECK(m[Demod::METRICS_SNR] > 10);
+  BOOST_CHECK_SMALL(m[Demod::METRICS_FRAC_CFO], 0.05);
+  BOOST_CHECK(m[Demod::METRICS_INT_CFO] == 0);
+  BOOST_CHECK(m[Demod::METRICS_PILOT_EVM] < 0.1);
+  BOOST_CHECK(m[Demod::METRICS_NUM_BYTES] == oSet->data.size());
+  BOOST_CHECK(m[Demod::METRICS_CRC_OK] == 1);
+  int modulation = m[Demod::METRICS_MODULATION];
+  BOOST_CHECK(modulation == 1 || modulation == 2 || modulation == 4);
+
+  out.releaseReadData(oSet);
+  metricsOut.releaseReadData(mSet);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Jumbo_Test)
+{
+  typedef complex<float>    Cplx;
+
+  // A BPSK frame of 100 data symbols
+  vector<uint8_t> data(100*5);
+  for(int i=0; i<data.size(); i++)
+    data[i] = i%251;
+  vector<Cplx> frame = OfdmFrameGenerator::createFrame(data, 1, 40, 8, 15, 8);
+
+  int maxSymbols[] = {128, 32};
+  for(int m=0; m<2; m++)
+  {
+    OfdmDemodulatorComponent demod("test");
+    demod.setValue("numdatacarriers", 40);
+    demod.setValue("numpilotcarriers", 8);
+    demod.setValue("numguardcarriers", 15);
+    demod.setValue("cyclicprefixlength", 8);
+    demod.setValue("maxsymbolsperframe", maxSymbols[m]);
+    demod.registerPorts();
+
+    DataBufferTrivial< Cplx > in;
+    DataBufferTrivial< uint8_t > out;
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, frame.size());
+    copy(frame.begin(), frame.end(), iSet->data.begin());
+    in.releaseWriteData(iSet);
+
+    demod.setBuffers(&in,&out);
+    demod.initialize();
+    BOOST_REQUIRE_NO_THROW(demod.process());
+
+    // Frames longer than maxsymbolsperframe are dropped
+    if(maxSymbols[m] < 100)
+    {
+      BOOST_CHECK(!out.hasData());
+      continue;
+    }
+
+    BOOST_REQUIRE(out.hasData());
+    DataSet< uint8_t >* oSet = NULL;
+    out.getReadData(oSet);
+    BOOST_REQUIRE(oSet->data.size() == data.size());
+    BOOST_CHECK(equal(data.begin(), data.end(), oSet->data.begin()));
+    out.releaseReadData(oSet);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Qam_Test)
+{
+  typedef complex<float>    Cplx;
+
+  // Frames of 10 data symbols signalled as QAM64 and QAM256
+  int mods[] = {QAM64, QAM256};
+  for(int m=0; m<2; m++)
+  {
+    vector<uint8_t> data(10*40*mods[m]/8);
+    for(int i=0; i<data.size(); i++)
+      data[i] = (i*7)%251;
+    vector<Cplx> frame = OfdmFrameGenerator::createFrame(data, mods[m],
+                                                         40, 8, 15, 8);
+
+    OfdmDemodulatorComponent demod("test");
+    demod.setValue("numdatacarriers", 40);
+    demod.setValue("numpilotcarriers", 8);
+    demod.setValue("numguardcarriers", 15);
+    demod.setValue("cyclicprefixlength", 8);
+    demod.registerPorts();
+
+    DataBufferTrivial< Cplx > in;
+    DataBufferTrivial< uint8_t > out;
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, frame.size());
+    copy(frame.begin(), frame.end(), iSet->data.begin());
+    in.releaseWriteData(iSet);
+
+    demod.setBuffers(&in,&out);
+    demod.initialize();
+    BOOST_REQUIRE_NO_THROW(demod.process());
+
+    BOOST_REQUIRE(out.hasData());
+    DataSet< uint8_t >* oSet = NULL;
+    out.getReadData(oSet);
+    BOOST_REQUIRE(oSet->data.size() == data.size());
+    BOOST_CHECK(equal(data.begin(), data.end(), oSet->data.begin()));
+    out.releaseReadData(oSet);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OfdmDemodulatorComponent_Coarse_Test)
+{
+  typedef complex<float>    Cplx;
+
+  // A QAM16 frame after a stretch of noise, found by the coarse search
+  vector<uint8_t> data(10*20);
+  for(int i=0; i<data.size(); i++)
+    data[i] = (i*3)%251;
+  vector<Cplx> frame = OfdmFrameGenerator::createFrame(data, QAM16,
+                                                       40, 8, 15, 8);
+
+  OfdmDemodulatorComponent demod("test");
+  demod.setValue("numdatacarriers", 40);
+  demod.setValue("numpilotcarriers", 8);
+  demod.setValue("numguardcarriers", 15);
+  demod.setValue("cyclicprefixlength", 8);
+  demod.setValue("coarsedecimation", 4);
+  demod.registerPorts();
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out;
+  DataSet< Cplx >* iSet = NULL;
+  int numNoise = 10000;
+  in.getWriteData(iSet, numNoise+frame.size());
+  srand(3);
+  for(int i=0; i<numNoise; i++)
+    iSet->data[i] = Cplx(rand()/(float)RAND_MAX-0.5f,
+                         rand()/(float)RAND_MAX-0.5f)*0.01f;
+  copy(frame.begin(), frame.end(), iSet->data.begin()+numNoise);
+  in.releaseWriteData(iSet);
+
+  demod.setBuffers(&in,&out);
+  demod.initialize();
+  BOOST_REQUIRE_NO_THROW(demod.process());
+
+  BOOST_REQUIRE(out.hasData());
+  DataSet< uint8_t >* oSet = NULL;
+  out.getReadData(oSet);
+  BOOST_REQUIRE(oSet->data.size() == data.size());
+  BOOST_CHECK(equal(data.begin(), data.end(), oSet->data.begin()));
+  out.releaseReadData(oSet);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,164 @@
+/**
+ * \file components/gpp/phy/OfdmDemodulator/test/OfdmFrameGenerator.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Generate OFDM frames of any length for OfdmDemodulatorComponent tests
+ * and benchmarks.
+ */
+
+#ifndef PHY_OFDMFRAMEGENERATOR_H_
+#define PHY_OFDMFRAMEGENERATOR_H_
+
+#include <vector>
+#include <complex>
+#include <cmath>
+#include <boost/cstdint.hpp>
+
+#include "fftw3.h"
+#include "math/FftwPlanner.h"
+#include "modulation/OfdmIndexGenerator.h"
+#include "modulation/OfdmPreambleGenerator.h"
+#include "modulation/QamModulator.h"
+#include "modulation/Whitener.h"
+#include "modulation/Crc.h"
+
+namespace iris
+{
+
+/** Generates OFDM frames in the format of OfdmModulatorComponent.
+ *
+ * The modulator component cannot be linked into the demodulator tests as
+ * both export the component entry points, so this builds the same frames
+ * from the modulation library. Frames are not limited in length by a
+ * maxsymbolsperframe parameter.
+ */
+class OfdmFrameGenerator
+{
+public:
+  typedef std::complex<float>   Cplx;
+  typedef std::vector<Cplx>     CplxVec;
+  typedef std::vector<int>      IntVec;
+  typedef std::vector<uint8_t>  ByteVec;
+
+  /** Create a frame of data.
+   *
+   * @param data        Data bytes of the frame (at most 65535).
+   * @param modulation  Modulation depth of the data symbols.
+   * @param numData     Number of data carriers.
+   * @param numPilot    Number of pilot carriers.
+   * @param numGuard    Number of guard carriers.
+   * @param cpLength    Length of the cyclic prefix.
+   * @return            The frame, including preamble and frame guard.
+   */
+  static CplxVec createFrame(ByteVec data, int modulation,
+                             int numData, int numPilot, int numGuard,
+                             int cpLength)
+  {
+    int numBins = numData + numPilot + numGuard + 1;
+    int symbolLength = numBins + cpLength;
+    int headerBytesPerSymbol = numData/8;
+    int numHeaderSymbols = (int)ceil(7/(float)headerBytesPerSymbol);
+    int bytesPerSymbol = (numData*modulation)/8;
+    int numSymbols = (int)ceil(data.size()/(float)bytesPerSymbol);
+
+    IntVec pilotIdx(numPilot), dataIdx(numData);
+    OfdmIndexGenerator::generateIndices(numData, numPilot, numGuard,
+                                        pilotIdx.begin(), pilotIdx.end(),
+                                        dataIdx.begin(), dataIdx.end());
+
+    // Header: crc, frame size, modulation depth and padding
+    ByteVec header(numHeaderSymbols*headerBytesPerSymbol);
+    uint32_t crc = Crc::generate(data.begin(), data.end());
+    header[0] = (crc>>24) & 0xFF;
+    header[1] = (crc>>16) & 0xFF;
+    header[2] = (crc>>8) & 0xFF;
+    header[3] = crc & 0xFF;
+    header[4] = (data.size()>>8) & 0xFF;
+    header[5] = data.size() & 0xFF;
+    header[6] = modulation & 0xFF;
+    for(int i=7; i<header.size(); i++)
+      header[i] = i;
+    Whitener::whiten(header.begin(), header.end());
+    Whitener::whiten(data.begin(), data.end());
+
+    QamModulator qMod;
+    CplxVec modHeader(numHeaderSymbols*numData);
+    qMod.modulate(header.begin(), header.end(),
+                  modHeader.begin(), modHeader.end(), 1);
+    CplxVec modData(numSymbols*numData, Cplx(0,0));
+    qMod.modulate(data.begin(), data.end(),
+                  modData.begin(), modData.end(), modulation);
+
+    CplxVec frame((1+numHeaderSymbols+numSymbols+1)*symbolLength);
+    CplxVec symbol(numBins);
+    OfdmPreambleGenerator preambleGen;
+    preambleGen.generatePreamble(numData, numPilot, numGuard,
+                                 symbol.begin(), symbol.end());
+    addSymbol(symbol, cpLength, &frame[0]);
+
+    Cplx* bins = reinterpret_cast<Cplx*>(
+        fftwf_malloc(sizeof(fftwf_complex) * numBins));
+    fftwf_plan fft = FftwPlanner::planDft1d(numBins,
+                                            (fftwf_complex*)bins,
+                                            (fftwf_complex*)bins,
+                                            FFTW_BACKWARD,
+                                            "estimate");
+    Cplx pilots[] = {Cplx(1,0),Cplx(1,0),Cplx(-1,0),Cplx(-1,0),
+                     Cplx(-1,0),Cplx(1,0),Cplx(-1,0),Cplx(1,0)};
+    for(int s=0; s<numHeaderSymbols+numSymbols; s++)
+    {
+      const Cplx* in = (s < numHeaderSymbols) ?
+          &modHeader[s*numData] : &modData[(s-numHeaderSymbols)*numData];
+      std::fill(bins, bins+numBins, Cplx(0,0));
+      for(int i=0; i<numPilot; i++)
+        bins[pilotIdx[i]] = pilots[i%8];
+      for(int i=0; i<numData; i++)
+        bins[dataIdx[i]] = in[i];
+      fftwf_execute(fft);
+      for(int i=0; i<numBins; i++)
+        symbol[i] = bins[i]/(float)(numPilot+numData);
+      addSymbol(symbol, cpLength, &frame[(s+1)*symbolLength]);
+    }
+    FftwPlanner::destroyPlan(fft);
+    fftwf_free(bins);
+    return frame;
+  }
+
+private:
+  /// Write a symbol preceded by its cyclic prefix.
+  static void addSymbol(const CplxVec& symbol, int cpLength, Cplx* out)
+  {
+    out = std::copy(symbol.end()-cpLength, symbol.end(), out);
+    std::copy(symbol.begin(), symbol.end(), out);
+  }
+};
+
+} // namespace iris
+
+#endif // PHY_OFDMFRAMEGENERATOR_H_
@@ -35,17 +35,14 @@
 
 #include <cmath>
 #include <algorithm>
-#include <boost/lambda/lambda.hpp>
 
 #include "irisapi/LibraryDefs.h"
 #include "irisapi/Version.h"
 #include "modulation/OfdmIndexGenerator.h"
-#include "modulation/Crc.h"
 #include "modulation/Whitener.h"
-#include "utility/RawFileUtility.h"
+#include "modulation/WhitenCrc.h"
 
 using namespace std;
-using namespace boost::lambda;
 
 namespace iris
 {
@@ -55,6 +52,14 @@ namespace phy
 // export library symbols
 IRIS_COMPONENT_EXPORTS(PhyComponent, OfdmModulatorComponent);
 
+/// Names of the debug stages, as in the files written by earlier versions.
+static const char* debugStageNames[] = {
+  "TxPreamble",
+  "TxFrame",
+  "TxSymbolBins",
+  "TxSymbol"
+};
+
 OfdmModulatorComponent::OfdmModulatorComponent(std::string name)
   : PhyComponent(name,                          // component name
                 "ofdmmodulator",                // component type
@@ -65,13 +70,28 @@ OfdmModulatorComponent::OfdmModulatorComponent(std::string name)
     ,numHeaderSymbols_(0)
     ,sampleRate_(0)
     ,timeStamp_(0)
-    ,fft_(NULL)
+    ,frameCount_(0)
+    ,binStride_(0)
+    ,scaleFactor_(1)
     ,fftBins_(NULL)
 {
   registerParameter(
-    "debug", "Whether to output debug data.",
+    "debug", "Whether to capture debug data to debugfile.",
     "false", true, debug_x);
 
+  registerParameter(
+    "debugfile", "File to which debug data is captured.",
+    "OutputData/OfdmModulator.cap", false, debugFile_x);
+
+  registerParameter(
+    "debugstages", "Bit mask of the debug stages to capture (-1 for all).",
+    "-1", true, debugStages_x);
+
+  registerParameter(
+    "debuginterval", "Capture debug data for one in every debuginterval "
+    "frames.",
+    "1", true, debugInterval_x, Interval<int>(1,1000000));
+
   registerParameter(
     "numdatacarriers", "Number of data carriers (excluding pilots)",
     "192", true, numDataCarriers_x, Interval<int>(1,65536));
@@ -84,9 +104,10 @@ OfdmModulatorComponent::OfdmModulatorComponent(std::string name)
     "numguardcarriers", "Number of guard carriers",
     "311", true, numGuardCarriers_x, Interval<int>(1,65536));
 
-  int vals[] = {1,2,4};
+  int vals[] = {1,2,4,6,8};
   registerParameter(
-    "modulationdepth", "Modulation depth (1=BPSK, 2=QPSK, 4=QAM16)",
+    "modulationdepth", "Modulation depth (1=BPSK, 2=QPSK, 4=QAM16, "
+    "6=QAM64, 8=QAM256)",
     "1", true, modulationDepth_x, list<int>(begin(vals),end(vals)));
 
   registerParameter(
@@ -95,7 +116,21 @@ OfdmModulatorComponent::OfdmModulatorComponent(std::string name)
 
   registerParameter(
     "maxsymbolsperframe", "Maximum number of data symbols per frame",
-    "32", true, maxSymbolsPerFrame_x, Interval<int>(1,128));
+    "32", true, maxSymbolsPerFrame_x, Interval<int>(1,1024));
+
+  registerParameter(
+    "maxfftbatch", "Maximum number of symbols transformed per fft call",
+    "32", true, maxFftBatch_x, Interval<int>(1,65536));
+
+  string rigors[] = {"estimate", "measure", "patient", "exhaustive"};
+  registerParameter(
+    "fftplanning", "Rigor of fft planning (estimate, measure, patient or "
+    "exhaustive)",
+    "measure", false, fftPlanning_x, list<string>(begin(rigors),end(rigors)));
+
+  registerParameter(
+    "wisdomfile", "File used to store fftw wisdom across runs (empty for none)",
+    "", false, wisdomFile_x);
 
   // Create our pilot sequence
   typedef Cplx c;
@@ -123,6 +158,7 @@ void OfdmModulatorComponent::calculateOutputTypes(
 
 void OfdmModulatorComponent::initialize()
 {
+  destroy();
   setup();
 }
 
@@ -135,20 +171,23 @@ void OfdmModulatorComponent::process()
   int size = (int)in->data.size();
   int numSymbols = ceil(size/(float)bytesPerSymbol_);
 
-  ByteVecIt it = in->data.begin();
+  // Whiten each frame into frameData_, leaving the input untouched
+  const uint8_t* it = size > 0 ? &in->data[0] : NULL;
   do
   {
     int sizeThisFrame;
-    if(numSymbols >= maxSymbolsPerFrame_x)
-      sizeThisFrame = maxSymbolsPerFrame_x * bytesPerSymbol_;
+    if(numSymbols >= frameSymbols_)
+      sizeThisFrame = frameSymbols_ * bytesPerSymbol_;
     else
       sizeThisFrame = size;
 
-    createHeader(it, it+sizeThisFrame);
-    createFrame(it, it+sizeThisFrame);
+    uint32_t crc = WhitenCrc::crcThenWhiten(it, it+sizeThisFrame,
+                                            &frameData_[0]);
+    createHeader(crc, sizeThisFrame);
+    createFrame(frameData_.begin(), frameData_.begin()+sizeThisFrame);
 
-    numSymbols -= maxSymbolsPerFrame_x;
-    size -= (maxSymbolsPerFrame_x*bytesPerSymbol_);
+    numSymbols -= frameSymbols_;
+    size -= (frameSymbols_*bytesPerSymbol_);
     it += sizeThisFrame;
 
   }while(numSymbols > 0);
@@ -160,7 +199,9 @@ void OfdmModulatorComponent::parameterHasChanged(std::string name)
 {
   if(name == "numdatacarriers" || name == "numpilotcarriers" ||
      name == "numguardcarriers" || name == "cyclicprefixlength" ||
-     name == "modulationdepth")
+     name == "modulationdepth" || name == "maxsymbolsperframe" ||
+     name == "maxfftbatch" ||
+     name == "debug" || name == "debugstages" || name == "debuginterval")
   {
     destroy();
     setup();
@@ -190,28 +231,38 @@ void OfdmModulatorComponent::setup()
                                 numGuardCarriers_x,
                                 preamble_.begin(), preamble_.end());
 
-  if(debug_x)
-    RawFileUtility::write(preamble_.begin(), preamble_.end(),
-                          "OutputData/TxPreamble");
-
   // Set up containers
-  fftBins_ = reinterpret_cast<Cplx*>(
-      fftwf_malloc(sizeof(fftwf_complex) * numBins_));
-  fill(&fftBins_[0], &fftBins_[numBins_], Cplx(0,0));
-  fft_ = fftwf_plan_dft_1d(numBins_,
-                           (fftwf_complex*)fftBins_,
-                           (fftwf_complex*)fftBins_,
-                           FFTW_BACKWARD,
-                           FFTW_MEASURE);
-  symbol_.clear();
-  symbol_.resize(numBins_);
   int bytesPerSymbol = numDataCarriers_x/8;
   numHeaderSymbols_ = (int)ceil(numHeaderBytes_/(float)bytesPerSymbol);
   header_.resize(numHeaderSymbols_*bytesPerSymbol);
   modHeader_.resize(numHeaderSymbols_*numDataCarriers_x);
+  modData_.resize(numDataCarriers_x);
 
   // Set up padding
+  if((numDataCarriers_x * modulationDepth_x)%8 != 0)
+    throw IrisException("Data carriers must carry whole bytes per symbol "
+                        "at the chosen modulation depth.");
   bytesPerSymbol_ = (numDataCarriers_x * modulationDepth_x)/8;
+
+  // The frame length must fit in the 16-bit size field of the header
+  frameSymbols_ = min(maxSymbolsPerFrame_x, 0xFFFF/bytesPerSymbol_);
+  if(frameSymbols_ < maxSymbolsPerFrame_x)
+    LOG(LWARNING) << "Frames limited to " << frameSymbols_
+                  << " data symbols by the header frame size field.";
+  frameData_.resize(frameSymbols_*bytesPerSymbol_);
+
+  // A slot must hold the largest frame: preamble, header, data symbols
+  // and the trailing guard symbol
+  if(debug_x)
+  {
+    int maxFrameLength = (1+numHeaderSymbols_+frameSymbols_+1)*
+                         (numBins_+cyclicPrefixLength_x);
+    vector<string> stages(begin(debugStageNames), end(debugStageNames));
+    capture_.open(debugFile_x, stages, debugStages_x, debugInterval_x,
+                  256, maxFrameLength*sizeof(Cplx));
+  }
+  capture(TX_PREAMBLE, 0, preamble_.begin(), preamble_.end());
+
   pad_.resize(bytesPerSymbol_);
   Whitener::whiten(pad_.begin(), pad_.end());
   modPad_.resize(numDataCarriers_x);
@@ -219,14 +270,37 @@ void OfdmModulatorComponent::setup()
                  modPad_.begin(), modPad_.end(),
                  modulationDepth_x);
 
+  // The header and data symbols of a frame are mapped onto the rows of
+  // fftBins_ and transformed in batches. Each row starts on a SIMD
+  // boundary so a batch plan can be executed on any row.
+  int maxRows = numHeaderSymbols_+frameSymbols_;
+  binStride_ = (numBins_+3)/4*4;
+  fftBins_ = reinterpret_cast<Cplx*>(
+      fftwf_malloc(sizeof(fftwf_complex) * binStride_ * maxRows));
+  fill(&fftBins_[0], &fftBins_[binStride_*maxRows], Cplx(0,0));
+  frameFfts_.clear();
+  for(int batch=1; batch<=min(maxRows, maxFftBatch_x); batch*=2)
+  {
+    frameFfts_.push_back(
+        FftwPlanner::planManyDft(numBins_, batch,
+                                 (fftwf_complex*)fftBins_, binStride_,
+                                 (fftwf_complex*)fftBins_, binStride_,
+                                 FFTW_BACKWARD,
+                                 fftPlanning_x, wisdomFile_x));
+  }
+  scaleFactor_ = numPilotCarriers_x + numDataCarriers_x;
+
 }
 
 void OfdmModulatorComponent::destroy()
 {
   if(fftBins_ != NULL)
     fftwf_free(fftBins_);
-  if(fft_ != NULL)
-    fftwf_destroy_plan(fft_);
+  fftBins_ = NULL;
+  for(int i=0; i<frameFfts_.size(); i++)
+    FftwPlanner::destroyPlan(frameFfts_[i]);
+  frameFfts_.clear();
+  capture_.close();
 }
 
 /** Create a header for the current frame.
@@ -238,20 +312,19 @@ void OfdmModulatorComponent::destroy()
  * data  |   CRC| Frame size(bytes)| QAM encoding|        padding|         <br>
  *       ---------------------------------------------------------         <br>
  *
- * @param begin Iterator to first byte of tx data.
- * @param end   Iterator to one past last byte of tx data.
+ * @param crc       CRC of the tx data.
+ * @param numBytes  Number of bytes of tx data.
  */
-void OfdmModulatorComponent::createHeader(ByteVecIt begin, ByteVecIt end)
+void OfdmModulatorComponent::createHeader(uint32_t crc, int numBytes)
 {
   //Add the CRC
-  uint32_t crc = Crc::generate(begin,end);
   header_[0] = (crc>>24) & 0xFF;
   header_[1] = (crc>>16) & 0xFF;
   header_[2] = (crc>>8) & 0xFF;
   header_[3] = crc & 0xFF;
 
   //Add frame size
-  uint16_t size = end-begin;
+  uint16_t size = numBytes;
   header_[4] = (size>>8) & 0xFF;
   header_[5] = size & 0xFF;
 
@@ -271,28 +344,43 @@ void OfdmModulatorComponent::createHeader(ByteVecIt begin, ByteVecIt end)
  * data     | Preamble |  Header |       Data Symbols | Frame Guard |     <br>
  *          --------------------------------------------------------      <br>
  *
- * @param begin   Iterator to first input data byte.
- * @param end     Iterator to one past last input data byte.
+ * @param begin   Iterator to first whitened data byte.
+ * @param end     Iterator to one past last whitened data byte.
  */
 void OfdmModulatorComponent::createFrame(ByteVecIt begin, ByteVecIt end)
 {
   int numOfdmSymbols = ceil((end-begin)/(float)bytesPerSymbol_);
   int ofdmSymLength = numBins_+cyclicPrefixLength_x;
 
-  // Whiten
+  // Whiten the header (the data is already whitened)
   Whitener::whiten(header_.begin(), header_.end());
-  Whitener::whiten(begin, end);
-
-  // Modulate and pad
-  qMod_.modulate(header_.begin(), header_.end(),
-                 modHeader_.begin(), modHeader_.end(), BPSK);
-  modData_.resize(numOfdmSymbols*numDataCarriers_x);
-  CplxVecIt modIt = qMod_.modulate(begin, end,
-                                   modData_.begin(), modData_.end(),
-                                   modulationDepth_x);
-  CplxVecIt padIt = modPad_.begin();
-  for(; modIt!=modData_.end(); modIt++,padIt++)
-    *modIt = *padIt;
+
+  // Modulate the header
+  qMod_.modulate<BPSK>(header_.begin(), header_.end(),
+                       modHeader_.begin(), modHeader_.end());
+
+  // Map the header and data symbols onto the rows of the fft input
+  int row = 0;
+  CplxVecIt headIt = modHeader_.begin();
+  for(; headIt != modHeader_.end(); headIt += numDataCarriers_x)
+    mapSymbol(headIt, headIt+numDataCarriers_x, row++);
+
+  // Modulate full data symbols straight into the fft input
+  ByteVecIt byteIt = begin;
+  for(; end-byteIt >= bytesPerSymbol_; byteIt += bytesPerSymbol_)
+    mapSymbol(byteIt, byteIt+bytesPerSymbol_, row++);
+
+  // Pad out the last symbol
+  if(byteIt != end)
+  {
+    CplxVecIt modIt = qMod_.modulate(byteIt, end,
+                                     modData_.begin(), modData_.end(),
+                                     modulationDepth_x);
+    copy(modPad_.begin(), modPad_.begin()+(modData_.end()-modIt), modIt);
+    mapSymbol(modData_.begin(), modData_.end(), row++);
+  }
+
+  transformSymbols(row);
 
   // Get a DataSet
   int frameLength = (1+numHeaderSymbols_+numOfdmSymbols+1) * (ofdmSymLength);
@@ -302,69 +390,120 @@ void OfdmModulatorComponent::createFrame(ByteVecIt begin, ByteVecIt end)
   out->timeStamp = timeStamp_;
   CplxVecIt it = out->data.begin();
 
-  // Copy preamble
+  // Copy preamble, then each symbol with its cyclic prefix
   it = copyWithCp(preamble_.begin(), preamble_.end(), it, it+ofdmSymLength);
+  for(int i=0; i<row; i++)
+    it = scaleWithCp(i, it, it+ofdmSymLength);
 
-  // Create and copy header symbol(s)
-  CplxVecIt headIt = modHeader_.begin();
-  for(; headIt != modHeader_.end(); headIt += numDataCarriers_x)
-  {
-    createSymbol(headIt, headIt+numDataCarriers_x, symbol_.begin(),symbol_.end());
-    it = copyWithCp(symbol_.begin(), symbol_.end(), it, it+ofdmSymLength);
-  }
-
-  // Create and copy data symbols
-  CplxVecIt inIt = modData_.begin();
-  for(int i=0; i<numOfdmSymbols; i++, inIt += numDataCarriers_x)
-  {
-    createSymbol(inIt, inIt+numDataCarriers_x, symbol_.begin(), symbol_.end());
-    it = copyWithCp(symbol_.begin(), symbol_.end(), it, it+ofdmSymLength);
-  }
-
-  if(debug_x)
-    RawFileUtility::write(out->data.begin(), out->data.end(),
-                          "OutputData/TxFrame");
+  capture(TX_FRAME, 0, out->data.begin(), out->data.end());
+  frameCount_++;
 
   releaseOutputDataSet("output1", out);
 }
 
-/** Create a single OFDM symbol.
+/** Map the QAM symbols of an OFDM symbol onto a row of the fft input.
  *
- * Our pilot and data index vectors are used to map QAM symbols onto carriers
- * and an FFT is used to create the time-domain OFDM symbol.
+ * Our pilot and data index vectors are used to map QAM symbols onto
+ * carriers.
  *
  * @param inBegin   Iterator to first input QAM symbol.
  * @param inEnd     Iterator to one past last input QAM symbol.
- * @param outBegin  Iterator to first sample of the output OFDM symbol.
- * @param outEnd    Iterator to one past last sample of the output symbol.
+ * @param row       Row of fftBins_ for this symbol.
  */
-void OfdmModulatorComponent::createSymbol(CplxVecIt inBegin, CplxVecIt inEnd,
-                                          CplxVecIt outBegin, CplxVecIt outEnd)
+void OfdmModulatorComponent::mapSymbol(CplxVecIt inBegin, CplxVecIt inEnd,
+                                       int row)
 {
-  if(outEnd-outBegin < numBins_)
-    throw IrisException("Insufficient storage provided for createSymbol output.");
+  Cplx* bins = fftBins_ + row*binStride_;
+  mapPilots(bins);
+  IntVecIt it = dataIndices_.begin();
+  for(; it!= dataIndices_.end(); it++)
+    bins[*it] = *inBegin++;
 
-  fill(&fftBins_[0], &fftBins_[numBins_], Cplx(0,0));
+  capture(TX_SYMBOL_BINS, row, bins, bins+numBins_);
+}
+
+/** Map the bytes carried by an OFDM symbol onto a row of the fft input.
+ *
+ * The bytes are modulated straight onto the data carriers.
+ *
+ * @param inBegin   Iterator to first input byte.
+ * @param inEnd     Iterator to one past last input byte.
+ * @param row       Row of fftBins_ for this symbol.
+ */
+void OfdmModulatorComponent::mapSymbol(ByteVecIt inBegin, ByteVecIt inEnd,
+                                       int row)
+{
+  Cplx* bins = fftBins_ + row*binStride_;
+  mapPilots(bins);
+  qMod_.modulateMapped(inBegin, inEnd, bins,
+                       dataIndices_.begin(), dataIndices_.end(),
+                       modulationDepth_x);
+
+  capture(TX_SYMBOL_BINS, row, bins, bins+numBins_);
+}
+
+/// Clear a row of the fft input and map our pilot sequence onto the
+/// pilot carriers.
+void OfdmModulatorComponent::mapPilots(Cplx* bins)
+{
+  fill(&bins[0], &bins[numBins_], Cplx(0,0));
 
   int i = 0;
   IntVecIt it = pilotIndices_.begin();
   for(; it!=pilotIndices_.end(); it++, i++)
-    fftBins_[*it] = pilotSequence_[i%pilotSequence_.size()];
-  for(it=dataIndices_.begin(); it!= dataIndices_.end(); it++)
-    fftBins_[*it] = *inBegin++;
-
-  if(debug_x)
-    RawFileUtility::write(&fftBins_[0], &fftBins_[numBins_],
-                          "OutputData/TxSymbolBins");
+    bins[*it] = pilotSequence_[i%pilotSequence_.size()];
+}
 
-  fftwf_execute(fft_);
-  copy(&fftBins_[0], &fftBins_[numBins_], outBegin);
-  float scaleFactor = numPilotCarriers_x + numDataCarriers_x;
-  transform(outBegin, outEnd, outBegin, _1/scaleFactor);
+/** Transform the first rows of the fft input to time-domain symbols.
+ *
+ * The rows are transformed in place using as few batched fft calls as
+ * possible.
+ *
+ * @param numSymbols  Number of rows to transform.
+ */
+void OfdmModulatorComponent::transformSymbols(int numSymbols)
+{
+  int row = 0;
+  for(int i=(int)frameFfts_.size()-1; i>=0; i--)
+  {
+    int batch = 1<<i;
+    for(; numSymbols-row >= batch; row += batch)
+    {
+      fftwf_complex* rowData = (fftwf_complex*)(fftBins_+row*binStride_);
+      fftwf_execute_dft(frameFfts_[i], rowData, rowData);
+    }
+  }
+}
 
-  if(debug_x)
-    RawFileUtility::write(outBegin, outEnd,
-                          "OutputData/TxSymbol");
+/** Write a transformed symbol and its cyclic prefix to the output.
+ *
+ * The normalization of the inverse fft is applied as the samples are
+ * copied.
+ *
+ * @param row       Row of fftBins_ holding the transformed symbol.
+ * @param outBegin  Iterator to first sample of the output.
+ * @param outEnd    Iterator to one past last sample of the output.
+ * @return          Iterator to one past the symbol in the output.
+ */
+OfdmModulatorComponent::CplxVecIt
+OfdmModulatorComponent::scaleWithCp(int row,
+                                    CplxVecIt outBegin, CplxVecIt outEnd)
+{
+  if(outEnd-outBegin < numBins_+cyclicPrefixLength_x)
+    throw IrisException("Insufficient storage provided for scaleWithCp output.");
+
+  const Cplx* bins = fftBins_ + row*binStride_;
+  float scale = 1.0f/scaleFactor_;
+  Cplx* out = &*outBegin;
+  const Cplx* cp = bins + numBins_ - cyclicPrefixLength_x;
+  for(int i=0; i<cyclicPrefixLength_x; i++)
+    out[i] = cp[i]*scale;
+  out += cyclicPrefixLength_x;
+  for(int i=0; i<numBins_; i++)
+    out[i] = bins[i]*scale;
+
+  capture(TX_SYMBOL, row, out, out+numBins_);
+  return outBegin+numBins_+cyclicPrefixLength_x;
 }
 
 OfdmModulatorComponent::CplxVecIt
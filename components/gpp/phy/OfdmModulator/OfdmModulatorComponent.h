@@ -52,6 +52,8 @@
 
 #include <boost/scoped_ptr.hpp>
 #include "fftw3.h"
+#include "math/FftwPlanner.h"
+#include "utility/DebugCapture.h"
 #include "modulation/QamModulator.h"
 #include "modulation/OfdmPreambleGenerator.h"
 #include "irisapi/PhyComponent.h"
@@ -94,43 +96,74 @@ class OfdmModulatorComponent
 
   void setup();
   void destroy();
-  void createHeader(ByteVecIt begin, ByteVecIt end);
+  void createHeader(uint32_t crc, int numBytes);
   void createFrame(ByteVecIt begin, ByteVecIt end);
-  void createSymbol(CplxVecIt inBegin, CplxVecIt inEnd,
-                    CplxVecIt outBegin, CplxVecIt outEnd);
+  void mapSymbol(CplxVecIt inBegin, CplxVecIt inEnd, int row);
+  void mapSymbol(ByteVecIt inBegin, ByteVecIt inEnd, int row);
+  void mapPilots(Cplx* bins);
+  void transformSymbols(int numSymbols);
+  CplxVecIt scaleWithCp(int row, CplxVecIt outBegin, CplxVecIt outEnd);
   CplxVecIt copyWithCp(CplxVecIt inBegin, CplxVecIt inEnd,
                        CplxVecIt outBegin, CplxVecIt outEnd);
 
+  /// Stages which can be captured in debug mode (bit i of debugstages).
+  enum DebugStage
+  {
+    TX_PREAMBLE,
+    TX_FRAME,
+    TX_SYMBOL_BINS,
+    TX_SYMBOL
+  };
+
+  /// Capture a range of debug data, if this stage and frame are wanted.
+  template <class It>
+  void capture(DebugStage stage, int index, It begin, It end)
+  {
+    if(capture_.wants(stage, frameCount_))
+      capture_.capture(stage, frameCount_, index, &*begin, &*begin+(end-begin));
+  }
+
   bool debug_x;               ///< Debug flag
+  std::string debugFile_x;    ///< File to capture debug data to
+  int debugStages_x;          ///< Mask of captured debug stages (default = all)
+  int debugInterval_x;        ///< Capture one in debugInterval_x frames (default = 1)
   int numDataCarriers_x;      ///< Data subcarriers (default = 192)
   int numPilotCarriers_x;     ///< Pilot subcarriers (default = 8)
   int numGuardCarriers_x;     ///< Guard subcarriers (default = 55+256)
-  int modulationDepth_x;      ///< 1=BPSK, 2=QPSK, 4=QAM16 (default = 1)
+  int modulationDepth_x;      ///< 1=BPSK, 2=QPSK, 4=QAM16, 6=QAM64, 8=QAM256 (default = 1)
   int cyclicPrefixLength_x;   ///< Length of cyclic prefix (default = 32)
   int maxSymbolsPerFrame_x;   ///< Max OFDM data symbols per frame (default = 32)
+  int maxFftBatch_x;          ///< Max symbols transformed per fft call (default = 32)
+  std::string fftPlanning_x;  ///< Rigor of fft planning (default = measure)
+  std::string wisdomFile_x;   ///< File used to store fftw wisdom (default = none)
 
   int numBins_;               ///< Number of bins for our FFT.
   int bytesPerSymbol_;        ///< Bytes per OFDM symbol.
+  int frameSymbols_;          ///< Data symbols in a full frame.
   const int numHeaderBytes_;  ///< Number of bytes in our frame header (7).
   int numHeaderSymbols_;
   double timeStamp_;          ///< Timestamp of current frame
   double sampleRate_;         ///< Sample rate of current frame
+  uint64_t frameCount_;       ///< Count of created frames, for debug capture.
+  int binStride_;             ///< Distance between symbols in fftBins_.
+  float scaleFactor_;         ///< Normalization of the inverse fft.
 
   IntVec pilotIndices_;       ///< Indices for our pilot carriers.
   IntVec dataIndices_;        ///< Indices for our data carriers.
   ByteVec header_;            ///< Contains the header data for each frame.
-  Cplx* fftBins_;             ///< Allocated using fftwf_malloc (SIMD aligned)
+  ByteVec frameData_;         ///< Whitened data of the current frame.
+  Cplx* fftBins_;             ///< One row per symbol, allocated using fftwf_malloc (SIMD aligned)
   CplxVec preamble_;          ///< Contains our frame preamble.
   CplxVec pilotSequence_;     ///< Contains our pilot symbols.
   CplxVec modHeader_;         ///< Contains our modulated header data.
-  CplxVec modData_;           ///< Contains our modulated data.
+  CplxVec modData_;           ///< Contains the modulated last data symbol.
   ByteVec pad_;               ///< Padding data.
   CplxVec modPad_;            ///< Used to pad out the last symbol, if required.
-  CplxVec symbol_;            ///< Contains a single OFDM symbol.
 
-  fftwf_plan fft_;                      ///< Our FFT object pointer.
+  std::vector<fftwf_plan> frameFfts_;   ///< Inverse ffts of 1,2,4... symbols
   QamModulator qMod_;                   ///< Our QAM modulator.
   OfdmPreambleGenerator preambleGen_;   ///< Our preamble generator.
+  DebugCapture capture_;                ///< Captures debug data to file.
 
   template <typename T, size_t N>
   static T* begin(T(&arr)[N]) { return &arr[0]; }
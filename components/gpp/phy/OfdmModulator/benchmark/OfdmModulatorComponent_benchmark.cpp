@@ -41,35 +41,82 @@ using namespace iris;
 using namespace iris::phy;
 namespace bp = boost::posix_time;
 
-int main(int argc, char* argv[])
+/// A buffer holding a single DataSet which is reused for every write,
+/// like the DataSets of a ring buffer in a running radio.
+template <typename T>
+class ReusedBuffer
+  : public DataBufferTrivial<T>
+{
+ public:
+  ReusedBuffer() : full_(false) {}
+  virtual bool hasData() const { return full_; }
+  virtual void getReadData(DataSet<T>*& setPtr) { setPtr = &set_; }
+  virtual void releaseReadData(DataSet<T>*& setPtr) { full_ = false; }
+  virtual void getWriteData(DataSet<T>*& setPtr, std::size_t size)
+  {
+    set_.data.resize(size);
+    setPtr = &set_;
+  }
+  virtual void releaseWriteData(DataSet<T>*& setPtr) { full_ = true; }
+
+ private:
+  DataSet<T> set_;
+  bool full_;
+};
+
+/** Modulate numFrames full frames at modulation depth M and return MB/sec.
+ *
+ * Frames are modulated one per call to process(), reusing the input and
+ * output DataSets, so only the modulator itself is timed.
+ */
+float runBenchmark(int M, int maxFftBatch, int numFrames)
 {
   OfdmModulatorComponent mod("test");
+  mod.setValue("modulationdepth", M);
+  mod.setValue("maxfftbatch", maxFftBatch);
   mod.registerPorts();
 
   map<string, int> iTypes,oTypes;
   iTypes["input1"] = TypeInfo< uint8_t >::identifier;
   mod.calculateOutputTypes(iTypes,oTypes);
 
-  DataBufferTrivial<uint8_t> in;
-  DataBufferTrivial< complex<float> > out;
-
-  // Create enough data for "numFrames" full frames
-  int numFrames = 100;
-  int numBytes = numFrames*32*24; // #dataSymbols * #bytesPerSymbol
-  DataSet<uint8_t>* iSet = NULL;
-  in.getWriteData(iSet, numBytes);
-  for(int i=0;i<numBytes;i++)
-    iSet->data[i] = i%255;
-  in.releaseWriteData(iSet);
+  ReusedBuffer<uint8_t> in;
+  ReusedBuffer< complex<float> > out;
 
   mod.setBuffers(&in,&out);
   mod.initialize();
 
-  bp::ptime t1(bp::microsec_clock::local_time());
-  mod.process();
-  bp::ptime t2(bp::microsec_clock::local_time());
+  int numBytes = 32*24*M; // #dataSymbols * #bytesPerSymbol
+  bp::time_duration time;
+  for(int f=0; f<numFrames; f++)
+  {
+    DataSet<uint8_t>* iSet = NULL;
+    in.getWriteData(iSet, numBytes);
+    for(int i=0;i<numBytes;i++)
+      iSet->data[i] = (i+f)%255;
+    in.releaseWriteData(iSet);
 
-  bp::time_duration time = t2-t1;
-  float megBytesPerSec = (numBytes/1.0e6)*(1.0e9/time.total_nanoseconds());
-  cout << "Rate = " << megBytesPerSec << " MB/sec" << endl;
+    bp::ptime t1(bp::microsec_clock::local_time());
+    mod.process();
+    bp::ptime t2(bp::microsec_clock::local_time());
+    time += t2-t1;
+
+    DataSet< complex<float> >* oSet = NULL;
+    out.getReadData(oSet);
+    out.releaseReadData(oSet);
+  }
+
+  return (numFrames*numBytes/1.0e6)*(1.0e9/time.total_nanoseconds());
+}
+
+int main(int argc, char* argv[])
+{
+  // One fft per symbol against the default batch of up to 32 symbols
+  int depths[] = {1, 2, 4, 6, 8};
+  for(int i=0; i<5; i++)
+  {
+    cout << "modulationdepth = " << depths[i] << ": "
+         << runBenchmark(depths[i], 1, 1000) << " MB/sec per symbol, "
+         << runBenchmark(depths[i], 32, 1000) << " MB/sec batched" << endl;
+  }
 }
@@ -34,6 +34,7 @@
 #define BOOST_TEST_MODULE OfdmModulatorComponent_Test
 
 #include <boost/test/unit_test.hpp>
+#include <cstdio>
 
 #include "../OfdmModulatorComponent.h"
 #include "utility/DataBufferTrivial.h"
@@ -59,6 +60,7 @@ BOOST_AUTO_TEST_CASE(OfdmModulatorComponent_Parm_Test)
   BOOST_CHECK(mod.getParameterDefaultValue("modulationdepth") == "1");
   BOOST_CHECK(mod.getParameterDefaultValue("cyclicprefixlength") == "32");
   BOOST_CHECK(mod.getParameterDefaultValue("maxsymbolsperframe") == "32");
+  BOOST_CHECK(mod.getParameterDefaultValue("maxfftbatch") == "32");
 }
 
 BOOST_AUTO_TEST_CASE(OfdmModulatorComponent_Ports_Test)
@@ -124,7 +126,114 @@ BOOST_AUTO_TEST_CASE(OfdmModulatorComponent_Process_Test)
   out.getReadData(oSet);
   BOOST_CHECK(oSet->data.size() == 35*544); // #symbols * #samplesPerSymbol
   out.releaseReadData(oSet);
+
+  // The input data is whitened into a separate buffer, not in place
+  vector< DataSet<uint8_t> > inSets = in.getBuffer();
+  for(int i=0;i<32*24;i++)
+    BOOST_CHECK(inSets[0].data[i] == i%255);
+}
+
+/// Modulate a full frame and a padded part frame, returning the samples.
+static vector< complex<float> > modulateFrames(int maxFftBatch)
+{
+  OfdmModulatorComponent mod("test");
+  mod.setValue("maxfftbatch", maxFftBatch);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< uint8_t >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial<uint8_t> in;
+  DataBufferTrivial< complex<float> > out;
+
+  DataSet<uint8_t>* iSet = NULL;
+  in.getWriteData(iSet, 37*24-10);
+  for(int i=0;i<37*24-10;i++)
+    iSet->data[i] = i%251;
+  in.releaseWriteData(iSet);
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+  mod.process();
+
+  vector< complex<float> > samples;
+  while(out.hasData())
+  {
+    DataSet< complex<float> >* oSet = NULL;
+    out.getReadData(oSet);
+    samples.insert(samples.end(), oSet->data.begin(), oSet->data.end());
+    out.releaseReadData(oSet);
+  }
+  return samples;
+}
+
+BOOST_AUTO_TEST_CASE(OfdmModulatorComponent_Batch_Test)
+{
+  // Batched ffts give the same frames as one fft per symbol
+  vector< complex<float> > single = modulateFrames(1);
+  vector< complex<float> > batched = modulateFrames(32);
+  BOOST_REQUIRE(single.size() == (35+8)*544);
+  BOOST_REQUIRE(batched.size() == single.size());
+  for(size_t i=0; i<single.size(); i++)
+    BOOST_CHECK_SMALL(abs(single[i]-batched[i]), 1e-6f);
+
+  // Each cyclic prefix repeats the end of its symbol, apart from the
+  // frame guard symbols
+  for(size_t s=0; s<batched.size()/544; s++)
+  {
+    if(s == 34 || s == 42)
+      continue;
+    for(int i=0; i<32; i++)
+      BOOST_CHECK(batched[s*544+i] == batched[s*544+512+i]);
+  }
 }
+
+BOOST_AUTO_TEST_CASE(OfdmModulatorComponent_Debug_Test)
+{
+  // Debug enabled before initialization captures full length frames
+  OfdmModulatorComponent mod("test");
+  mod.setValue("debugfile", "OfdmModulatorComponent_test.cap");
+  mod.setValue("debug", true);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< uint8_t >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial<uint8_t> in;
+  DataBufferTrivial< complex<float> > out;
+
+  DataSet<uint8_t>* iSet = NULL;
+  in.getWriteData(iSet, 32*24); // #dataSymbols * #bytesPerSymbol
+  for(int i=0;i<32*24;i++)
+    iSet->data[i] = i%255;
+  in.releaseWriteData(iSet);
+
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+  BOOST_REQUIRE_NO_THROW(mod.process());
+
+  // Turning debug off closes the capture file
+  mod.setValue("debug", false);
+
+  vector<string> stages;
+  vector<DebugCapture::Record> records;
+  DebugCapture::read("OfdmModulatorComponent_test.cap", stages, records);
+  BOOST_REQUIRE(stages.size() == 4);
+  BOOST_CHECK(stages[1] == "TxFrame");
+  int numFrames = 0;
+  for(int i=0; i<records.size(); i++)
+  {
+    if(records[i].stage != 1)
+      continue;
+    numFrames++;
+    BOOST_CHECK(records[i].data.size() == 35*544*sizeof(complex<float>));
+  }
+  BOOST_CHECK(numFrames == 1);
+  remove("OfdmModulatorComponent_test.cap");
+}
+
 /*
 BOOST_AUTO_TEST_CASE(OfdmModulatorComponent_Generate_Data)
 {
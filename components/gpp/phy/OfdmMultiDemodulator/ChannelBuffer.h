@@ -0,0 +1,126 @@
+/**
+ * \file components/gpp/phy/OfdmMultiDemodulator/ChannelBuffer.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A buffer between the channelizer and the demodulator of one channel.
+ */
+
+#ifndef PHY_CHANNELBUFFER_H_
+#define PHY_CHANNELBUFFER_H_
+
+#include <vector>
+#include "irisapi/DataBufferInterfaces.h"
+#include "irisapi/Exceptions.h"
+#include "irisapi/TypeInfo.h"
+
+namespace iris
+{
+namespace phy
+{
+
+/** A buffer between the channelizer and the demodulator of one channel.
+ *
+ * All DataSets written are read back before the next write, so the buffer
+ * simply holds a list of DataSets which is emptied once all have been
+ * read. DataSets keep their storage when they are reused, so a channel
+ * does not allocate once it has seen its largest blocks. Like
+ * DataBufferTrivial, it is not thread-safe and does not block.
+ */
+template <typename T>
+class ChannelBuffer
+  : public ReadBuffer<T>, public WriteBuffer<T>
+{
+public:
+  ChannelBuffer()
+    :numWritten_(0)
+    ,numRead_(0)
+    ,isReadLocked_(false)
+    ,isWriteLocked_(false)
+  {}
+
+  virtual ~ChannelBuffer(){}
+
+  /// Get the identifier for the data type of this buffer
+  virtual int getTypeIdentifier() const { return TypeInfo<T>::identifier; }
+
+  /// Is there any data in this buffer?
+  virtual bool hasData() const { return numRead_ < numWritten_; }
+
+  // empty implementation - links are internal to a component
+  virtual void setLinkDescription(LinkDescription) {}
+  virtual LinkDescription getLinkDescription() const { return LinkDescription(); }
+
+  virtual void getReadData(DataSet<T>*& setPtr)
+  {
+    if(isReadLocked_)
+      throw DataBufferReleaseException("getReadData() called before previous DataSet was released");
+    if(!hasData())
+      throw DataBufferReleaseException("getReadData() called on an empty ChannelBuffer");
+    isReadLocked_ = true;
+    setPtr = &sets_[numRead_];
+  }
+
+  virtual void getWriteData(DataSet<T>*& setPtr, std::size_t size)
+  {
+    if(isWriteLocked_)
+      throw DataBufferReleaseException("getWriteData() called before previous DataSet was released");
+    isWriteLocked_ = true;
+    if(numWritten_ == sets_.size())
+      sets_.resize(numWritten_+1);
+    sets_[numWritten_].data.resize(size);
+    setPtr = &sets_[numWritten_];
+  }
+
+  virtual void releaseReadData(DataSet<T>*& setPtr)
+  {
+    isReadLocked_ = false;
+    setPtr = NULL;
+    if(++numRead_ == numWritten_)
+      numRead_ = numWritten_ = 0;
+  }
+
+  virtual void releaseWriteData(DataSet<T>*& setPtr)
+  {
+    isWriteLocked_ = false;
+    setPtr = NULL;
+    numWritten_++;
+  }
+
+private:
+  std::vector< DataSet<T> > sets_;  ///< DataSets, reused once all are read.
+  std::size_t numWritten_;          ///< Number of DataSets written.
+  std::size_t numRead_;             ///< Number of DataSets read.
+  bool isReadLocked_;
+  bool isWriteLocked_;
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_CHANNELBUFFER_H_
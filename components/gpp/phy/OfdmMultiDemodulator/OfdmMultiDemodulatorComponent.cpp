@@ -0,0 +1,384 @@
+/**
+ * \file components/gpp/phy/OfdmMultiDemodulator/OfdmMultiDemodulatorComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the OfdmMultiDemodulator component.
+ */
+
+#include "OfdmMultiDemodulatorComponent.h"
+
+#include <sstream>
+#include "irisapi/LibraryDefs.h"
+#include "irisapi/Version.h"
+
+using namespace std;
+
+namespace iris
+{
+namespace phy
+{
+
+// export library symbols
+IRIS_COMPONENT_EXPORTS(PhyComponent, OfdmMultiDemodulatorComponent);
+
+OfdmMultiDemodulatorComponent::OfdmMultiDemodulatorComponent(std::string name)
+  : PhyComponent(name,                                  // component name
+                "ofdmmultidemodulator",                 // component type
+                "A multi-channel OFDM demodulation component", // description
+                "Paul Sutton",                          // author
+                "1.0")                                  // version
+    ,channelizer_(NULL)
+    ,chanInIndex_(0)
+    ,nextChannel_(0)
+    ,numDone_(0)
+    ,generation_(0)
+    ,stopWorkers_(false)
+{
+  registerParameter(
+    "numchannels", "Number of channels in the input stream",
+    "8", false, numChannels_x, Interval<int>(1,1024));
+
+  registerParameter(
+    "numworkers", "Number of channel demodulation threads (0 = demodulate "
+    "on the calling thread)",
+    "0", false, numWorkers_x, Interval<int>(0,64));
+
+  registerParameter(
+    "numdatacarriers", "Number of data carriers (excluding pilots)",
+    "192", false, numDataCarriers_x, Interval<int>(1,65536));
+
+  registerParameter(
+    "numpilotcarriers", "Number of pilot carriers",
+    "8", false, numPilotCarriers_x, Interval<int>(1,65536));
+
+  registerParameter(
+    "numguardcarriers", "Number of guard carriers",
+    "55", false, numGuardCarriers_x, Interval<int>(1,65536));
+
+  registerParameter(
+    "cyclicprefixlength", "Length of cyclic prefix",
+    "16", false, cyclicPrefixLength_x, Interval<int>(1,65536));
+
+  registerParameter(
+    "threshold", "Frame detection threshold",
+    "0.827", false, threshold_x, Interval<float>(0.0,1.0));
+
+  registerParameter(
+    "coarsedecimation", "Decimation of the coarse frame search (1 = search "
+    "every sample at full resolution)",
+    "1", false, coarseDecimation_x, Interval<int>(1,64));
+
+  registerParameter(
+    "coarsethreshold", "Threshold of the coarse frame search",
+    "0.5", false, coarseThreshold_x, Interval<float>(0.0,1.0));
+
+  registerParameter(
+    "maxsymbolsperframe", "Maximum number of data symbols per received frame",
+    "128", false, maxSymbolsPerFrame_x, Interval<int>(1,1024));
+
+  string rigors[] = {"estimate", "measure", "patient", "exhaustive"};
+  registerParameter(
+    "fftplanning", "Rigor of fft planning (estimate, measure, patient or "
+    "exhaustive)",
+    "measure", false, fftPlanning_x, list<string>(rigors, rigors+4));
+
+  registerParameter(
+    "wisdomfile", "File used to store fftw wisdom across runs (empty for none)",
+    "", false, wisdomFile_x);
+}
+
+OfdmMultiDemodulatorComponent::~OfdmMultiDemodulatorComponent()
+{
+  destroy();
+}
+
+void OfdmMultiDemodulatorComponent::registerPorts()
+{
+  registerInputPort("input1", TypeInfo< Cplx >::identifier);
+  registerOutputPort("output1", TypeInfo< uint8_t >::identifier);
+  registerOutputPort("output2", TypeInfo< uint32_t >::identifier);
+}
+
+void OfdmMultiDemodulatorComponent::calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes)
+{
+  outputTypes["output1"] = TypeInfo< uint8_t >::identifier;
+  outputTypes["output2"] = TypeInfo< uint32_t >::identifier;
+}
+
+void OfdmMultiDemodulatorComponent::initialize()
+{
+  destroy();
+  setup();
+}
+
+void OfdmMultiDemodulatorComponent::process()
+{
+  DataSet< Cplx >* in = NULL;
+  getInputDataSet("input1", in);
+
+  int numRuns = (chanInIndex_ + in->data.size())/numChannels_x;
+  for(int i=0; i<numChannels_x; i++)
+  {
+    Channel& c = *channels_[i];
+    c.in.getWriteData(c.inSet, numRuns);
+    c.inSet->sampleRate = in->sampleRate/(double)numChannels_x;
+    c.inSet->timeStamp = in->timeStamp;
+  }
+
+  channelize(in->data.begin(), in->data.end());
+  releaseInputDataSet("input1", in);
+
+  for(int i=0; i<numChannels_x; i++)
+    channels_[i]->in.releaseWriteData(channels_[i]->inSet);
+
+  demodChannels();
+  outputFrames();
+}
+
+/// Create the channelizer, the channels and the worker threads.
+void OfdmMultiDemodulatorComponent::setup()
+{
+  // Prototype filter delay of 7 and 60dB stop-band attenuation, as used
+  // by the PfbChannelizer component
+  channelizer_ = firpfbch_crcf_create_kaiser(LIQUID_ANALYZER, numChannels_x,
+                                             7, 60.0f);
+
+  // Centre the spectrum on the filterbank
+  nco_.setFrequency(0.5*(numChannels_x-1)/(double)numChannels_x);
+  nco_.setPhase(0);
+
+  chanIn_.assign(numChannels_x, Cplx(0,0));
+  chanInIndex_ = 0;
+  chanOut_.assign(numChannels_x, Cplx(0,0));
+
+  // The channels have the same parameters, so their demodulators share
+  // one set of carrier indices and fft plans
+  channels_.clear();
+  for(int i=0; i<numChannels_x; i++)
+  {
+    stringstream ss;
+    ss << getName() << "_channel" << i;
+    boost::shared_ptr< Channel > c(new Channel);
+    c->demod.reset(new OfdmDemodulatorComponent(ss.str()));
+    OfdmDemodulatorComponent& d = *c->demod;
+    d.setValue("numdatacarriers", numDataCarriers_x);
+    d.setValue("numpilotcarriers", numPilotCarriers_x);
+    d.setValue("numguardcarriers", numGuardCarriers_x);
+    d.setValue("cyclicprefixlength", cyclicPrefixLength_x);
+    d.setValue("threshold", threshold_x);
+    d.setValue("coarsedecimation", coarseDecimation_x);
+    d.setValue("coarsethreshold", coarseThreshold_x);
+    d.setValue("maxsymbolsperframe", maxSymbolsPerFrame_x);
+    d.setValue("fftplanning", fftPlanning_x);
+    d.setValue("wisdomfile", wisdomFile_x);
+    d.registerPorts();
+
+    vector<ReadBufferBase*> ins(1, &c->in);
+    vector<WriteBufferBase*> outs(1, &c->out);
+    d.setBuffers(ins, outs);
+    d.initialize();
+    c->inSet = NULL;
+    channels_.push_back(c);
+  }
+
+  stopWorkers_ = false;
+  generation_ = 0;
+  if(numWorkers_x > 0)
+  {
+    workers_.reset(new boost::thread_group);
+    for(int i=0; i<numWorkers_x; i++)
+      workers_->add_thread(new boost::thread(
+          &OfdmMultiDemodulatorComponent::workerThreadFunction, this));
+  }
+}
+
+void OfdmMultiDemodulatorComponent::destroy()
+{
+  if(workers_)
+  {
+    {
+      boost::lock_guard< boost::mutex > lock(channelMutex_);
+      stopWorkers_ = true;
+    }
+    blockReady_.notify_all();
+    workers_->join_all();
+    workers_.reset();
+  }
+  channels_.clear();
+
+  if(channelizer_ != NULL)
+    firpfbch_crcf_destroy(channelizer_);
+  channelizer_ = NULL;
+}
+
+/** Split a block of wideband samples into the channel input DataSets.
+ *
+ * Samples left over from the previous block are kept in chanIn_, so the
+ * DataSets must hold (leftover + block length)/numchannels samples.
+ *
+ * @param begin   Iterator to first input sample.
+ * @param end     Iterator to one past the last input sample.
+ */
+void OfdmMultiDemodulatorComponent::channelize(CplxVecIt begin, CplxVecIt end)
+{
+  int run = 0;
+  while(begin != end)
+  {
+    // Mix the samples down a whole channelizer input at a time
+    int n = min<int>(end-begin, numChannels_x-chanInIndex_);
+    nco_.mix(begin, begin+n, chanIn_.begin()+chanInIndex_);
+    begin += n;
+    chanInIndex_ += n;
+    if(chanInIndex_ < numChannels_x)
+      continue;
+
+    firpfbch_crcf_analyzer_execute(channelizer_, &chanIn_[0], &chanOut_[0]);
+    for(int i=0; i<numChannels_x; i++)
+      channels_[i]->inSet->data[run] = chanOut_[i];
+    chanInIndex_ = 0;
+    run++;
+  }
+}
+
+/** Demodulate the current block of every channel.
+ *
+ * Without workers the channels are demodulated in turn. Otherwise a new
+ * generation is started and the calling thread works alongside the
+ * workers until every channel is done.
+ */
+void OfdmMultiDemodulatorComponent::demodChannels()
+{
+  if(!workers_)
+  {
+    for(int i=0; i<numChannels_x; i++)
+      channels_[i]->demod->process();
+    return;
+  }
+
+  {
+    boost::lock_guard< boost::mutex > lock(channelMutex_);
+    nextChannel_ = 0;
+    numDone_ = 0;
+    generation_++;
+  }
+  blockReady_.notify_all();
+
+  while(demodNextChannel())
+    ;
+
+  boost::unique_lock< boost::mutex > lock(channelMutex_);
+  while(numDone_ < numChannels_x)
+    blockDone_.wait(lock);
+}
+
+/** Demodulate the next channel of the current block, if there is one.
+ *
+ * @return  False if every channel of the block has been taken.
+ */
+bool OfdmMultiDemodulatorComponent::demodNextChannel()
+{
+  int i;
+  {
+    boost::lock_guard< boost::mutex > lock(channelMutex_);
+    if(nextChannel_ == numChannels_x)
+      return false;
+    i = nextChannel_++;
+  }
+
+  try
+  {
+    channels_[i]->demod->process();
+  }
+  catch(IrisException& e)
+  {
+    LOG(LERROR) << "Channel " << i << ": " << e.what();
+  }
+
+  {
+    boost::lock_guard< boost::mutex > lock(channelMutex_);
+    numDone_++;
+  }
+  blockDone_.notify_all();
+  return true;
+}
+
+/// Demodulate channels of each new block until told to stop.
+void OfdmMultiDemodulatorComponent::workerThreadFunction()
+{
+  uint64_t seen = 0;
+  while(true)
+  {
+    {
+      boost::unique_lock< boost::mutex > lock(channelMutex_);
+      while(generation_ == seen && !stopWorkers_)
+        blockReady_.wait(lock);
+      if(stopWorkers_)
+        return;
+      seen = generation_;
+    }
+
+    while(demodNextChannel())
+      ;
+  }
+}
+
+/// Output the frames of every channel, with their channel index.
+void OfdmMultiDemodulatorComponent::outputFrames()
+{
+  for(int i=0; i<numChannels_x; i++)
+  {
+    ChannelBuffer< uint8_t >& frames = channels_[i]->out;
+    while(frames.hasData())
+    {
+      DataSet< uint8_t >* frame = NULL;
+      frames.getReadData(frame);
+
+      DataSet< uint8_t >* out = NULL;
+      getOutputDataSet("output1", out, frame->data.size());
+      out->sampleRate = frame->sampleRate;
+      out->timeStamp = frame->timeStamp;
+      copy(frame->data.begin(), frame->data.end(), out->data.begin());
+      releaseOutputDataSet("output1", out);
+
+      DataSet< uint32_t >* index = NULL;
+      getOutputDataSet("output2", index, 1);
+      index->sampleRate = frame->sampleRate;
+      index->timeStamp = frame->timeStamp;
+      index->data[0] = i;
+      releaseOutputDataSet("output2", index);
+
+      frames.releaseReadData(frame);
+    }
+  }
+}
+
+} // namespace phy
+} // namespace iris
@@ -0,0 +1,138 @@
+/**
+ * \file components/gpp/phy/OfdmMultiDemodulator/OfdmMultiDemodulatorComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A multi-channel OFDM demodulation component. Takes a wideband stream of
+ * complex<float> samples, splits it into channels with a polyphase
+ * filterbank and demodulates OFDM frames on every channel. Frames are
+ * output as blocks of uint8_t bytes on output1, with the index of the
+ * channel of each frame output as a single uint32_t on output2.
+ *
+ * Channel i is centred on (i-(numchannels-1)/2)*fs/numchannels, as with
+ * the PfbChannelizer component. Each channel is demodulated as by the
+ * OfdmDemodulator component, and all channels share the same OFDM
+ * parameters. See OfdmDemodulatorComponent.h for more information.
+ */
+
+#ifndef PHY_OFDMMULTIDEMODULATORCOMPONENT_H_
+#define PHY_OFDMMULTIDEMODULATORCOMPONENT_H_
+
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread.hpp>
+#include "liquid/liquid.h"
+#include "modulation/Nco.h"
+
+#include "irisapi/PhyComponent.h"
+#include "../OfdmDemodulator/OfdmDemodulatorComponent.h"
+#include "ChannelBuffer.h"
+
+namespace iris
+{
+namespace phy
+{
+
+/** A multi-channel OFDM demodulation component.
+ *
+ * Each channel has its own OfdmDemodulatorComponent, fed through in-process
+ * buffers rather than engine links. The channels of each input block are
+ * demodulated by a pool of worker threads and the calling thread, and
+ * their frames are output in channel order.
+ */
+class OfdmMultiDemodulatorComponent
+  : public PhyComponent
+{
+ public:
+  typedef std::complex<float>   Cplx;
+  typedef std::vector<Cplx>     CplxVec;
+  typedef CplxVec::iterator     CplxVecIt;
+
+  OfdmMultiDemodulatorComponent(std::string name);
+  ~OfdmMultiDemodulatorComponent();
+  virtual void calculateOutputTypes(
+      std::map<std::string, int>& inputTypes,
+      std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+
+ private:
+  /// The demodulator of a single channel and its buffers.
+  struct Channel
+  {
+    boost::shared_ptr< OfdmDemodulatorComponent > demod;
+    ChannelBuffer< Cplx > in;       ///< Channelized samples.
+    ChannelBuffer< uint8_t > out;   ///< Demodulated frames.
+    DataSet< Cplx >* inSet;         ///< Input DataSet being filled.
+  };
+
+  void setup();
+  void destroy();
+  void channelize(CplxVecIt begin, CplxVecIt end);
+  void demodChannels();
+  bool demodNextChannel();
+  void workerThreadFunction();
+  void outputFrames();
+
+  int numChannels_x;          ///< Number of channels (default = 8)
+  int numWorkers_x;           ///< Demodulation worker threads (default = 0)
+  int numDataCarriers_x;      ///< Data subcarriers (default = 192)
+  int numPilotCarriers_x;     ///< Pilot subcarriers (default = 8)
+  int numGuardCarriers_x;     ///< Guard subcarriers (default = 55)
+  int cyclicPrefixLength_x;   ///< Length of cyclic prefix (default = 16)
+  float threshold_x;          ///< Frame detection threshold (default = 0.827)
+  int coarseDecimation_x;     ///< Coarse frame search decimation (default = 1)
+  float coarseThreshold_x;    ///< Coarse frame search threshold (default = 0.5)
+  int maxSymbolsPerFrame_x;   ///< Max OFDM data symbols per frame (default = 128)
+  std::string fftPlanning_x;  ///< Rigor of fft planning (default = measure)
+  std::string wisdomFile_x;   ///< File used to store fftw wisdom (default = none)
+
+  std::vector< boost::shared_ptr< Channel > > channels_; ///< Our channels.
+  firpfbch_crcf channelizer_; ///< Polyphase filterbank analyzer.
+  Nco nco_;                   ///< Centres the channels on the filterbank.
+  CplxVec chanIn_;            ///< One input sample per channel.
+  int chanInIndex_;           ///< Number of samples in chanIn_.
+  CplxVec chanOut_;           ///< One output sample per channel.
+
+  // Each input block is handed to the workers as a new generation. The
+  // workers and the calling thread take channels until none are left.
+  int nextChannel_;                     ///< Next channel to demodulate.
+  int numDone_;                         ///< Channels demodulated.
+  uint64_t generation_;                 ///< Count of demodulated blocks.
+  bool stopWorkers_;                    ///< Tell the workers to exit.
+  boost::scoped_ptr< boost::thread_group > workers_; ///< Worker threads.
+  boost::mutex channelMutex_;           ///< Protects the channel counters.
+  boost::condition_variable blockReady_; ///< Signalled for a new block.
+  boost::condition_variable blockDone_;  ///< Signalled when a block is done.
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_OFDMMULTIDEMODULATORCOMPONENT_H_
@@ -0,0 +1,106 @@
+/**
+ * \file components/gpp/phy/OfdmMultiDemodulator/benchmark/OfdmMultiDemodulatorComponent_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for OfdmMultiDemodulator component.
+ */
+
+#include "../OfdmMultiDemodulatorComponent.h"
+#include <cstdlib>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+namespace bp = boost::posix_time;
+
+typedef complex<float> Cplx;
+
+/// Channelize and search numSamples of noise and return the rate in MS/sec.
+float runBenchmark(int numChannels, int numWorkers, int numSamples)
+{
+  OfdmMultiDemodulatorComponent demod("test");
+  demod.setValue("numchannels", numChannels);
+  demod.setValue("numworkers", numWorkers);
+  demod.setValue("numdatacarriers", 40);
+  demod.setValue("numpilotcarriers", 8);
+  demod.setValue("numguardcarriers", 15);
+  demod.setValue("cyclicprefixlength", 8);
+  demod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  demod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out1;
+  DataBufferTrivial< uint32_t > out2;
+
+  DataSet< Cplx >* iSet = NULL;
+  in.getWriteData(iSet, numSamples);
+  for(int i=0; i<numSamples; i++)
+    iSet->data[i] = Cplx(rand()/(float)RAND_MAX-0.5f,
+                         rand()/(float)RAND_MAX-0.5f);
+  in.releaseWriteData(iSet);
+
+  vector<ReadBufferBase*> ins;
+  vector<WriteBufferBase*> outs;
+  ins.push_back(&in);
+  outs.push_back(&out1);
+  outs.push_back(&out2);
+  demod.setBuffers(ins,outs);
+  demod.initialize();
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  demod.process();
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  bp::time_duration time = t2-t1;
+  float megSampsPerSec = (numSamples/1.0e6)*(1.0e9/time.total_nanoseconds());
+  cout << "numchannels = " << numChannels
+       << ", numworkers = " << numWorkers << ": "
+       << megSampsPerSec << " MS/sec" << endl;
+  return megSampsPerSec;
+}
+
+int main(int argc, char* argv[])
+{
+  int numSamples = 8000000;
+  int numCores = max(1u, boost::thread::hardware_concurrency());
+  for(int channels=4; channels<=16; channels*=2)
+  {
+    float single = runBenchmark(channels, 0, numSamples);
+    for(int workers=1; workers<numCores; workers*=2)
+    {
+      float rate = runBenchmark(channels, workers, numSamples);
+      cout << "Worker pool gain = " << rate/single << "x" << endl;
+    }
+  }
+}
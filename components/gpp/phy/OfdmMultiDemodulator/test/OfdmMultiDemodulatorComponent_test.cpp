@@ -0,0 +1,295 @@
+/**
+ * \file components/gpp/phy/OfdmMultiDemodulator/test/OfdmMultiDemodulatorComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for OfdmMultiDemodulator component.
+ */
+
+#define BOOST_TEST_MODULE OfdmMultiDemodulatorComponent_Test
+
+#include <boost/test/unit_test.hpp>
+
+#include "../OfdmMultiDemodulatorComponent.h"
+#include "../../OfdmDemodulator/test/OfdmDemodulatorTestData.h"
+#include <cstdlib>
+#include "math/Dsp.h"
+#include "modulation/Nco.h"
+#include "utility/DataBufferTrivial.h"
+#include "utility/FirFilter.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+typedef complex<float> Cplx;
+
+/// Run a block of low-level noise through a demodulator.
+void processNoise(OfdmMultiDemodulatorComponent& demod, int numSamples)
+{
+  demod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  demod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out1;
+  DataBufferTrivial< uint32_t > out2;
+
+  DataSet< Cplx >* iSet = NULL;
+  in.getWriteData(iSet, numSamples);
+  srand(1);
+  for(int i=0; i<numSamples; i++)
+    iSet->data[i] = Cplx(rand()/(float)RAND_MAX-0.5f,
+                         rand()/(float)RAND_MAX-0.5f)*0.01f;
+  in.releaseWriteData(iSet);
+
+  vector<ReadBufferBase*> ins;
+  vector<WriteBufferBase*> outs;
+  ins.push_back(&in);
+  outs.push_back(&out1);
+  outs.push_back(&out2);
+  demod.setBuffers(ins,outs);
+  demod.initialize();
+
+  BOOST_REQUIRE_NO_THROW(demod.process());
+  BOOST_CHECK(!out1.hasData());
+  BOOST_CHECK(!out2.hasData());
+}
+
+/** Place a frame in one channel of a wideband signal.
+ *
+ * The frame is upsampled by numChannels and mixed up to the centre of the
+ * channel, (channel-(numChannels-1)/2)/numChannels cycles per sample.
+ */
+vector<Cplx> createChannelSignal(const vector<Cplx>& frame, int channel,
+                                 int numChannels)
+{
+  // Silence either side of the frame flushes the filters
+  vector<Cplx> padded(frame.size()+400, Cplx(0,0));
+  copy(frame.begin(), frame.end(), padded.begin()+200);
+
+  double transition = 0.1/numChannels;
+  int numTaps = kaiserLength(60.0, transition)/2*2+1;
+  vector<float> taps = kaiserLowpass<float>(numTaps, 0.45/numChannels,
+                                            kaiserBeta(60.0), numChannels);
+  FirFilterUpsamp<Cplx, float, Cplx> interp(numChannels,
+                                            taps.begin(), taps.end());
+  vector<Cplx> signal(padded.size()*numChannels);
+  interp.filter(padded.begin(), padded.end(), signal.begin());
+
+  Nco nco((channel-(numChannels-1)/2.0)/numChannels);
+  nco.mix(signal.begin(), signal.end());
+  return signal;
+}
+
+/** Demodulate a wideband signal, passing it in blocks of blockLength.
+ *
+ * @param frames    Output for the data of each frame.
+ * @param channels  Output for the channel of each frame.
+ */
+void processSignal(OfdmMultiDemodulatorComponent& demod,
+                   const vector<Cplx>& signal, int blockLength,
+                   vector< vector<uint8_t> >& frames,
+                   vector<uint32_t>& channels)
+{
+  demod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  demod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< uint8_t > out1;
+  DataBufferTrivial< uint32_t > out2;
+  vector<ReadBufferBase*> ins;
+  vector<WriteBufferBase*> outs;
+  ins.push_back(&in);
+  outs.push_back(&out1);
+  outs.push_back(&out2);
+  demod.setBuffers(ins,outs);
+  demod.initialize();
+
+  for(size_t i=0; i<signal.size(); i+=blockLength)
+  {
+    int len = min<size_t>(blockLength, signal.size()-i);
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, len);
+    copy(signal.begin()+i, signal.begin()+i+len, iSet->data.begin());
+    iSet->sampleRate = 4e6;
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(demod.process());
+
+    while(out1.hasData())
+    {
+      BOOST_REQUIRE(out2.hasData());
+      DataSet< uint8_t >* frame = NULL;
+      out1.getReadData(frame);
+      frames.push_back(frame->data);
+      out1.releaseReadData(frame);
+
+      DataSet< uint32_t >* index = NULL;
+      out2.getReadData(index);
+      BOOST_REQUIRE(index->data.size() == 1);
+      channels.push_back(index->data[0]);
+      out2.releaseReadData(index);
+    }
+    BOOST_CHECK(!out2.hasData());
+  }
+}
+
+/// Check a frame in each channel is decoded and tagged with its channel.
+void testChannels(int numWorkers, int blockLength)
+{
+  int numChannels = 4;
+  for(int c=0; c<numChannels; c++)
+  {
+    OfdmMultiDemodulatorComponent demod("test");
+    demod.setValue("numchannels", numChannels);
+    demod.setValue("numworkers", numWorkers);
+    demod.setValue("numdatacarriers", 40);
+    demod.setValue("numpilotcarriers", 8);
+    demod.setValue("numguardcarriers", 15);
+    demod.setValue("cyclicprefixlength", 8);
+
+    vector<Cplx> signal = createChannelSignal(
+        OfdmDemodulatorTestData::testFrame1, c, numChannels);
+    vector< vector<uint8_t> > frames;
+    vector<uint32_t> channels;
+    processSignal(demod, signal, blockLength, frames, channels);
+
+    BOOST_REQUIRE(frames.size() == 1);
+    BOOST_CHECK(channels[0] == c);
+    BOOST_REQUIRE(frames[0].size() == 20);
+    for(int j=0; j<frames[0].size(); j++)
+      BOOST_CHECK(frames[0][j] == j);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE (OfdmMultiDemodulatorComponent_Test)
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(OfdmMultiDemodulatorComponent demod("test"));
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Parm_Test)
+{
+  OfdmMultiDemodulatorComponent demod("test");
+  BOOST_CHECK(demod.getParameterDefaultValue("numchannels") == "8");
+  BOOST_CHECK(demod.getParameterDefaultValue("numworkers") == "0");
+  BOOST_CHECK(demod.getParameterDefaultValue("numdatacarriers") == "192");
+  BOOST_CHECK(demod.getParameterDefaultValue("numpilotcarriers") == "8");
+  BOOST_CHECK(demod.getParameterDefaultValue("numguardcarriers") == "55");
+  BOOST_CHECK(demod.getParameterDefaultValue("cyclicprefixlength") == "16");
+  BOOST_CHECK(demod.getParameterDefaultValue("maxsymbolsperframe") == "128");
+
+  BOOST_CHECK(demod.getValue("numchannels") == "8");
+  BOOST_CHECK(demod.getValue("numworkers") == "0");
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Ports_Test)
+{
+  OfdmMultiDemodulatorComponent demod("test");
+  BOOST_REQUIRE_NO_THROW(demod.registerPorts());
+
+  vector<Port> iPorts = demod.getInputPorts();
+  BOOST_REQUIRE(iPorts.size() == 1);
+  BOOST_REQUIRE(iPorts.front().portName == "input1");
+  BOOST_REQUIRE(iPorts.front().supportedTypes.front() ==
+      TypeInfo< Cplx >::identifier);
+
+  vector<Port> oPorts = demod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 2);
+  BOOST_REQUIRE(oPorts[0].portName == "output1");
+  BOOST_REQUIRE(oPorts[0].supportedTypes.front() ==
+      TypeInfo< uint8_t >::identifier);
+  BOOST_REQUIRE(oPorts[1].portName == "output2");
+  BOOST_REQUIRE(oPorts[1].supportedTypes.front() ==
+      TypeInfo< uint32_t >::identifier);
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  demod.calculateOutputTypes(iTypes,oTypes);
+  BOOST_REQUIRE(oTypes["output1"] == TypeInfo< uint8_t >::identifier);
+  BOOST_REQUIRE(oTypes["output2"] == TypeInfo< uint32_t >::identifier);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Init_Test)
+{
+  OfdmMultiDemodulatorComponent demod("test");
+  demod.setValue("numchannels", 4);
+  demod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  demod.calculateOutputTypes(iTypes,oTypes);
+
+  BOOST_REQUIRE_NO_THROW(demod.initialize());
+  BOOST_REQUIRE_NO_THROW(demod.initialize());
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Process_Test)
+{
+  OfdmMultiDemodulatorComponent demod("test");
+  demod.setValue("numchannels", 4);
+  demod.setValue("numdatacarriers", 40);
+  demod.setValue("numpilotcarriers", 8);
+  demod.setValue("numguardcarriers", 15);
+  demod.setValue("cyclicprefixlength", 8);
+
+  // Not a multiple of numchannels, so samples are carried between blocks
+  processNoise(demod, 4003);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Workers_Test)
+{
+  OfdmMultiDemodulatorComponent demod("test");
+  demod.setValue("numchannels", 8);
+  demod.setValue("numworkers", 3);
+  demod.setValue("numdatacarriers", 40);
+  demod.setValue("numpilotcarriers", 8);
+  demod.setValue("numguardcarriers", 15);
+  demod.setValue("cyclicprefixlength", 8);
+
+  processNoise(demod, 8000);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_Channel_Test)
+{
+  // Blocks which are not a multiple of numchannels
+  testChannels(0, 1001);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmMultiDemodulatorComponent_ChannelWorkers_Test)
+{
+  testChannels(3, 777);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
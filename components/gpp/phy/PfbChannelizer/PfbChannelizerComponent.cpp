@@ -104,10 +104,9 @@ void PfbChannelizerComponent::initialize()
   float As        = 60.0f;    // stop-band attenuation
   channelizer = firpfbch_crcf_create_kaiser(LIQUID_ANALYZER, nChans_x, m, As);
 
-  // create NCO to center spectrum
-  float offset = -0.5f*(float)(nChans_x-1) / (float)nChans_x * 2 * M_PI;
-  nco = nco_crcf_create(LIQUID_VCO);
-  nco_crcf_set_frequency(nco, offset);
+  // set NCO to center spectrum
+  nco.setFrequency(0.5*(nChans_x-1)/(double)nChans_x);
+  nco.setPhase(0);
 
   //Set up our input and output buffers
   buf.resize(nChans_x);
@@ -137,12 +136,7 @@ void PfbChannelizerComponent::process()
   }
 
   // mix signal down
-  for(int i=0;i<readDataSet->data.size();i++)
-  {
-    complex<float>* x = &readDataSet->data[i];
-    nco_crcf_mix_down(nco, *x, x);
-    nco_crcf_step(nco);
-  }
+  nco.mix(readDataSet->data.begin(), readDataSet->data.end());
 
   //Execute the channelizer
   int run=0;
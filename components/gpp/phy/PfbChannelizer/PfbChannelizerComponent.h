@@ -37,6 +37,7 @@
 
 #include "irisapi/PhyComponent.h"
 #include "liquid/liquid.h"
+#include "modulation/Nco.h"
 
 namespace iris
 {
@@ -74,7 +75,7 @@ class PfbChannelizerComponent
   CplxVecIt bufIt;              ///< Iterator into our input buffer
   CplxVec outBuf;               ///< Our output buffer
   firpfbch_crcf channelizer;    ///< Ptr to our channelizer struct
-  nco_crcf nco;                   // frequency-centering NCO
+  Nco nco;                        ///< Frequency-centering NCO
 
   void printTapsForMatlab();
 };
@@ -98,10 +98,9 @@ void PfbSynthesizerComponent::initialize()
   float As        = 60.0f;    // stop-band attenuation
   channelizer = firpfbch_crcf_create_kaiser(LIQUID_SYNTHESIZER, nChans_x, m, As);
 
-  // create NCO to center spectrum
-  float offset = -0.5f*(float)(nChans_x-1) / (float)nChans_x * 2 * M_PI;
-  nco = nco_crcf_create(LIQUID_VCO);
-  nco_crcf_set_frequency(nco, offset);
+  // set NCO to center spectrum
+  nco.setFrequency(0.5*(nChans_x-1)/(double)nChans_x);
+  nco.setPhase(0);
 
   //Set up our input and output buffers
   buf.resize(nChans_x);
@@ -144,12 +143,7 @@ void PfbSynthesizerComponent::process()
   }
 
   // mix signal down
-  for(int i=0;i<writeDataSet->data.size();i++)
-  {
-    complex<float>* x = &writeDataSet->data[i];
-    nco_crcf_mix_down(nco, *x, x);
-    nco_crcf_step(nco);
-  }
+  nco.mix(writeDataSet->data.begin(), writeDataSet->data.end());
 
   //Release the DataSets
   for(int i=0;i<nChans_x;i++)
@@ -0,0 +1,178 @@
+/**
+ * \file components/gpp/phy/Resampler/ResamplerComponent.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Implementation of the Resampler component.
+ */
+
+#include "ResamplerComponent.h"
+
+#include <algorithm>
+
+#include "irisapi/LibraryDefs.h"
+#include "irisapi/Version.h"
+#include "math/Dsp.h"
+
+using namespace std;
+
+namespace iris
+{
+namespace phy
+{
+
+// export library symbols
+IRIS_COMPONENT_EXPORTS(PhyComponent, ResamplerComponent);
+
+ResamplerComponent::ResamplerComponent(std::string name)
+  : PhyComponent(name,                          // component name
+                "resampler",                    // component type
+                "A polyphase rational resampler",
+                "Paul Sutton",                  // author
+                "1.0")                          // version
+  ,interpolation_(1)
+  ,decimation_(1)
+  ,delay_(0)
+{
+  registerParameter(
+    "interpolation", "Upsampling factor",
+    "1", true, interpolation_x, Interval<int>(1,1024));
+
+  registerParameter(
+    "decimation", "Downsampling factor",
+    "1", true, decimation_x, Interval<int>(1,1024));
+
+  registerParameter(
+    "bandwidth", "Passband as a fraction of the lower of the input and "
+    "output Nyquist rates",
+    "0.9", true, bandwidth_x, Interval<float>(0.1,0.99));
+
+  registerParameter(
+    "attenuation", "Stopband attenuation in dB",
+    "60", true, attenuation_x, Interval<float>(20,150));
+}
+
+void ResamplerComponent::registerPorts()
+{
+  registerInputPort("input1", TypeInfo< complex<float> >::identifier);
+  registerOutputPort("output1", TypeInfo< complex<float> >::identifier);
+}
+
+void ResamplerComponent::calculateOutputTypes(
+    std::map<std::string, int>& inputTypes,
+    std::map<std::string, int>& outputTypes)
+{
+  outputTypes["output1"] = TypeInfo< complex<float> >::identifier;
+}
+
+void ResamplerComponent::initialize()
+{
+  setup();
+}
+
+void ResamplerComponent::process()
+{
+  DataSet< Cplx >* in = NULL;
+  getInputDataSet("input1", in);
+
+  int numOut = engine_.numOutputs(in->data.size());
+  if(numOut > 0)
+  {
+    DataSet< Cplx >* out = NULL;
+    getOutputDataSet("output1", out, numOut);
+
+    // The first output is nextPhase() upsampled samples after the first
+    // input, less the delay of the filter
+    out->timeStamp = in->timeStamp;
+    out->sampleRate = in->sampleRate*interpolation_/decimation_;
+    if(in->sampleRate > 0)
+      out->timeStamp += (engine_.nextPhase()-delay_)/
+                        (in->sampleRate*interpolation_);
+
+    engine_.filter(in->data.begin(), in->data.end(), out->data.begin());
+    releaseOutputDataSet("output1", out);
+  }
+  else
+  {
+    CplxVec discard;
+    engine_.filter(in->data.begin(), in->data.end(), discard.begin());
+  }
+
+  releaseInputDataSet("input1", in);
+}
+
+void ResamplerComponent::parameterHasChanged(std::string name)
+{
+  setup();
+}
+
+ResamplerComponent::FloatVec ResamplerComponent::designPrototype(
+    int interpolation, int decimation, float bandwidth, float attenuation)
+{
+  if(interpolation == decimation)
+    return FloatVec(1, 1.0f);
+
+  // Stop at the lower Nyquist rate, as a fraction of the upsampled rate
+  double stop = 0.5/max(interpolation, decimation);
+  double pass = bandwidth*stop;
+  int numTaps = kaiserLength(attenuation, stop-pass);
+
+  // Give every phase the same number of taps
+  numTaps = (numTaps+interpolation-1)/interpolation*interpolation;
+  return kaiserLowpass<float>(numTaps, (pass+stop)/2,
+                              kaiserBeta(attenuation), interpolation);
+}
+
+/// Reduce the ratio and design our filter.
+void ResamplerComponent::setup()
+{
+  int a = interpolation_x;
+  int b = decimation_x;
+  while(b != 0)
+  {
+    int t = a%b;
+    a = b;
+    b = t;
+  }
+  interpolation_ = interpolation_x/a;
+  decimation_ = decimation_x/a;
+
+  FloatVec taps = designPrototype(interpolation_, decimation_,
+                                  bandwidth_x, attenuation_x);
+  delay_ = (taps.size()-1)/2.0;
+  engine_.setResampling(taps.begin(), taps.end(),
+                        interpolation_, decimation_);
+  engine_.reset();
+
+  LOG(LINFO) << "Resampling by " << interpolation_ << "/" << decimation_
+             << " with " << taps.size() << " taps, "
+             << engine_.numTaps() << " per phase";
+}
+
+} // namespace phy
+} // namespace iris
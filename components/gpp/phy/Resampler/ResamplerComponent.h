@@ -0,0 +1,111 @@
+/**
+ * \file components/gpp/phy/Resampler/ResamplerComponent.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A polyphase rational resampler component.
+ */
+
+#ifndef PHY_RESAMPLERCOMPONENT_H_
+#define PHY_RESAMPLERCOMPONENT_H_
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include "irisapi/PhyComponent.h"
+#include "utility/FirEngine.h"
+
+namespace iris
+{
+namespace phy
+{
+
+/** A polyphase rational resampler component.
+ *
+ * Changes the sample rate of a stream of complex<float> samples by
+ * interpolation/decimation, e.g. 125/128 to take 2.048 Msps to 2 Msps.
+ * The ratio is reduced to its lowest terms.
+ *
+ * The lowpass prototype is designed with a Kaiser window. It passes the
+ * given bandwidth of the lower of the input and output Nyquist
+ * frequencies and attenuates everything above that Nyquist frequency by
+ * the given attenuation. The prototype is split into interpolation
+ * phases and only the outputs kept after decimation are computed.
+ *
+ * Resampling is continuous across DataSets. The sample rate of each
+ * output DataSet is scaled by the ratio and its time stamp is that of
+ * its first sample, corrected for the delay of the filter.
+ */
+class ResamplerComponent
+  : public PhyComponent
+{
+ public:
+  typedef std::complex<float>   Cplx;
+  typedef std::vector<Cplx>     CplxVec;
+  typedef std::vector<float>    FloatVec;
+
+  ResamplerComponent(std::string name);
+  virtual void calculateOutputTypes(
+      std::map<std::string, int>& inputTypes,
+      std::map<std::string, int>& outputTypes);
+  virtual void registerPorts();
+  virtual void initialize();
+  virtual void process();
+  virtual void parameterHasChanged(std::string name);
+
+  /** Design the lowpass prototype of a resampler.
+   *
+   * @param interpolation   Upsampling factor.
+   * @param decimation      Downsampling factor.
+   * @param bandwidth       Passband as a fraction of the lower Nyquist rate.
+   * @param attenuation     Stopband attenuation in dB.
+   * @return                Taps at the upsampled rate, with a passband
+   *                        gain of interpolation.
+   */
+  static FloatVec designPrototype(int interpolation, int decimation,
+                                  float bandwidth, float attenuation);
+
+ private:
+  void setup();
+
+  int interpolation_x;    ///< Upsampling factor (default = 1)
+  int decimation_x;       ///< Downsampling factor (default = 1)
+  float bandwidth_x;      ///< Passband as a fraction of the lower Nyquist rate (default = 0.9)
+  float attenuation_x;    ///< Stopband attenuation in dB (default = 60)
+
+  int interpolation_;     ///< Upsampling factor in lowest terms.
+  int decimation_;        ///< Downsampling factor in lowest terms.
+  double delay_;          ///< Filter delay in upsampled samples.
+  FirEngine<Cplx, float, Cplx> engine_; ///< Our polyphase filter.
+};
+
+} // namespace phy
+} // namespace iris
+
+#endif // PHY_RESAMPLERCOMPONENT_H_
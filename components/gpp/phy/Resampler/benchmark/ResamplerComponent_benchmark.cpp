@@ -0,0 +1,94 @@
+/**
+ * \file components/gpp/phy/Resampler/benchmark/ResamplerComponent_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main benchmark file for Resampler component.
+ */
+
+#include "../ResamplerComponent.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+namespace bp = boost::posix_time;
+
+/// Resample numSets DataSets of 4096 samples and return input MSamples/sec.
+float runBenchmark(int up, int down, int numSets)
+{
+  ResamplerComponent mod("test");
+  mod.setValue("interpolation", up);
+  mod.setValue("decimation", down);
+  mod.registerPorts();
+
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< complex<float> >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< complex<float> > in;
+  DataBufferTrivial< complex<float> > out;
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  bp::time_duration time;
+  for(int s=0; s<numSets; s++)
+  {
+    DataSet< complex<float> >* iSet = NULL;
+    in.getWriteData(iSet, 4096);
+    for(int i=0; i<4096; i++)
+      iSet->data[i] = complex<float>(i%13, i%7);
+    iSet->sampleRate = 2.048e6;
+    in.releaseWriteData(iSet);
+
+    bp::ptime t1(bp::microsec_clock::local_time());
+    mod.process();
+    bp::ptime t2(bp::microsec_clock::local_time());
+    time += t2-t1;
+
+    DataSet< complex<float> >* oSet = NULL;
+    out.getReadData(oSet);
+    out.releaseReadData(oSet);
+  }
+  return (numSets*4096/1.0e6)*(1.0e9/time.total_nanoseconds());
+}
+
+int main(int argc, char* argv[])
+{
+  // e.g. 2.048 Msps to 2, 1.92, 3.072 and 1.024 Msps
+  int ratios[][2] = {{125,128}, {15,16}, {3,2}, {1,2}, {2,1}};
+  for(int i=0; i<5; i++)
+  {
+    int up = ratios[i][0];
+    int down = ratios[i][1];
+    float in = runBenchmark(up, down, 200);
+    cout << up << "/" << down << ": " << in << " MS/sec in, "
+         << in*up/down << " MS/sec out" << endl;
+  }
+}
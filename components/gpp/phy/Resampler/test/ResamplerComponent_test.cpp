@@ -0,0 +1,201 @@
+/**
+ * \file components/gpp/phy/Resampler/test/ResamplerComponent_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ * 
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ * 
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for Resampler component.
+ */
+
+#define BOOST_TEST_MODULE ResamplerComponent_Test
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+
+#include "../ResamplerComponent.h"
+#include "math/MathDefines.h"
+#include "utility/DataBufferTrivial.h"
+
+using namespace std;
+using namespace iris;
+using namespace iris::phy;
+
+typedef complex<float> Cplx;
+
+/** Resample a tone in DataSets of varying size.
+ *
+ * Outputs are checked against the upsampled, filtered and decimated
+ * input, and against the tone itself at the time given by the time
+ * stamps once the filter has settled.
+ */
+static void checkResampler(int up, int down, double freq)
+{
+  ResamplerComponent mod("test");
+  mod.setValue("interpolation", up);
+  mod.setValue("decimation", down);
+  mod.registerPorts();
+  map<string, int> iTypes,oTypes;
+  iTypes["input1"] = TypeInfo< Cplx >::identifier;
+  mod.calculateOutputTypes(iTypes,oTypes);
+
+  DataBufferTrivial< Cplx > in;
+  DataBufferTrivial< Cplx > out;
+  mod.setBuffers(&in,&out);
+  mod.initialize();
+
+  double rate = 1e6;
+  double outRate = rate*up/down;
+  vector<Cplx> input;
+  vector<Cplx> output;
+  vector<double> times;
+  int setSize = 1;
+  while(input.size() < 3000)
+  {
+    DataSet< Cplx >* iSet = NULL;
+    in.getWriteData(iSet, setSize);
+    iSet->timeStamp = 5.0 + input.size()/rate;
+    iSet->sampleRate = rate;
+    for(int i=0; i<setSize; i++)
+    {
+      double t = input.size()/rate;
+      iSet->data[i] = polar(1.0f, (float)(2*IRIS_PI*freq*t));
+      input.push_back(iSet->data[i]);
+    }
+    in.releaseWriteData(iSet);
+    BOOST_REQUIRE_NO_THROW(mod.process());
+    setSize = setSize*7%311+1;
+
+    while(out.hasData())
+    {
+      DataSet< Cplx >* oSet = NULL;
+      out.getReadData(oSet);
+      BOOST_CHECK_CLOSE(oSet->sampleRate, outRate, 1e-9);
+      for(size_t i=0; i<oSet->data.size(); i++)
+      {
+        output.push_back(oSet->data[i]);
+        times.push_back(oSet->timeStamp + i/outRate);
+      }
+      out.releaseReadData(oSet);
+    }
+  }
+
+  // Reference: upsample with zeros, filter and decimate
+  int g = up, b = down;
+  while(b != 0) { int t = g%b; g = b; b = t; }
+  vector<float> taps = ResamplerComponent::designPrototype(up/g, down/g,
+                                                           0.9f, 60.0f);
+  size_t numUp = input.size()*(up/g);
+  size_t numRef = (numUp+down/g-1)/(down/g);
+  BOOST_REQUIRE_EQUAL(output.size(), numRef);
+  for(size_t k=0; k<numRef; k++)
+  {
+    size_t n = k*(down/g);
+    Cplx ref(0,0);
+    for(size_t j=n%(up/g); j<taps.size() && j<=n; j+=up/g)
+      ref += input[(n-j)/(up/g)]*taps[j];
+    BOOST_CHECK_SMALL(abs(output[k]-ref), 1e-4f);
+  }
+
+  // Once settled, the output is the tone at its time stamp
+  size_t settled = taps.size()/(down/g) + 10;
+  for(size_t k=settled; k<numRef; k++)
+  {
+    Cplx tone = polar(1.0f, (float)(2*IRIS_PI*freq*(times[k]-5.0)));
+    BOOST_CHECK_SMALL(abs(output[k]-tone), 1e-2f);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE (ResamplerComponent_Test)
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(ResamplerComponent mod("test"));
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Parm_Test)
+{
+  ResamplerComponent mod("test");
+  BOOST_CHECK(mod.getParameterDefaultValue("interpolation") == "1");
+  BOOST_CHECK(mod.getParameterDefaultValue("decimation") == "1");
+  BOOST_CHECK(mod.getParameterDefaultValue("bandwidth") == "0.9");
+  BOOST_CHECK(mod.getParameterDefaultValue("attenuation") == "60");
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Ports_Test)
+{
+  ResamplerComponent mod("test");
+  BOOST_REQUIRE_NO_THROW(mod.registerPorts());
+
+  vector<Port> iPorts = mod.getInputPorts();
+  BOOST_REQUIRE(iPorts.size() == 1);
+  BOOST_REQUIRE(iPorts.front().portName == "input1");
+  BOOST_REQUIRE(iPorts.front().supportedTypes.front() ==
+      TypeInfo< complex<float> >::identifier);
+
+  vector<Port> oPorts = mod.getOutputPorts();
+  BOOST_REQUIRE(oPorts.size() == 1);
+  BOOST_REQUIRE(oPorts.front().portName == "output1");
+  BOOST_REQUIRE(oPorts.front().supportedTypes.front() ==
+      TypeInfo< complex<float> >::identifier);
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Prototype_Test)
+{
+  // 3/2 stops at the input Nyquist rate, a sixth of the upsampled rate
+  vector<float> taps = ResamplerComponent::designPrototype(3, 2, 0.9f, 60.0f);
+  BOOST_REQUIRE(taps.size()%3 == 0);
+  for(int i=0; i<=20; i++)
+  {
+    double f = i*0.9/6/20;
+    complex<double> pass(0,0);
+    complex<double> stop(0,0);
+    for(size_t n=0; n<taps.size(); n++)
+    {
+      pass += (double)taps[n]*polar(1.0, -2*IRIS_PI*f*n);
+      stop += (double)taps[n]*polar(1.0, -2*IRIS_PI*(1.0/6+f*10/9*2)*n);
+    }
+    BOOST_CHECK_CLOSE(abs(pass), 3.0, 0.5);
+    BOOST_CHECK(abs(stop) < 3.0*pow(10.0, -57.0/20));
+  }
+
+  // Equal factors pass the samples through
+  taps = ResamplerComponent::designPrototype(4, 4, 0.9f, 60.0f);
+  BOOST_REQUIRE(taps.size() == 1);
+}
+
+BOOST_AUTO_TEST_CASE(ResamplerComponent_Process_Test)
+{
+  checkResampler(3, 2, 0.1e6);
+  checkResampler(2, 3, -0.1e6);
+  checkResampler(1, 4, 0.05e6);
+  checkResampler(5, 1, 0.2e6);
+  checkResampler(125, 128, 0.3e6);
+  checkResampler(6, 4, 0.1e6);
+  checkResampler(2, 2, 0.1e6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
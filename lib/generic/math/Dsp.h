@@ -34,8 +34,12 @@
 #ifndef DSP_H_
 #define DSP_H_
 
+#include <algorithm>
 #include <cmath>
 #include <complex>
+#include <vector>
+
+#include "math/MathDefines.h"
 
 namespace iris
 {
@@ -64,6 +68,84 @@ T fastMag(std::complex<T> c,
   return alpha * absQ + beta * absI;
 }
 
+/** Modified Bessel function of the first kind, order zero.
+ *
+ * Evaluated with its power series, which converges quickly for the
+ * arguments used by Kaiser windows.
+ *
+ * @param x   The argument.
+ */
+inline double besselI0(double x)
+{
+  double sum = 1.0;
+  double term = 1.0;
+  double halfX = x/2.0;
+  for(int k=1; k<50; k++)
+  {
+    term *= (halfX/k)*(halfX/k);
+    sum += term;
+    if(term < sum*1e-12)
+      break;
+  }
+  return sum;
+}
+
+/** Kaiser window shape parameter for a given stopband attenuation.
+ *
+ * Uses Kaiser's empirical formula.
+ *
+ * @param attenuation   Stopband attenuation in dB.
+ */
+inline double kaiserBeta(double attenuation)
+{
+  if(attenuation > 50.0)
+    return 0.1102*(attenuation-8.7);
+  if(attenuation >= 21.0)
+    return 0.5842*pow(attenuation-21.0, 0.4) + 0.07886*(attenuation-21.0);
+  return 0.0;
+}
+
+/** Number of taps of a Kaiser window filter.
+ *
+ * @param attenuation   Stopband attenuation in dB.
+ * @param transition    Transition bandwidth as a fraction of the sample
+ *                      rate.
+ */
+inline int kaiserLength(double attenuation, double transition)
+{
+  double n = (attenuation-7.95)/(14.36*transition) + 1.0;
+  return std::max(1, (int)ceil(n));
+}
+
+/** Design a lowpass filter with a Kaiser window.
+ *
+ * The windowed sinc filter is symmetric about its centre, so it has a
+ * delay of (numTaps-1)/2 samples.
+ *
+ * @param numTaps   Number of taps.
+ * @param cutoff    Cutoff frequency as a fraction of the sample rate.
+ * @param beta      Kaiser window shape parameter.
+ * @param gain      Gain of the passband.
+ */
+template<class T>
+std::vector<T> kaiserLowpass(int numTaps, double cutoff, double beta,
+                             double gain = 1.0)
+{
+  std::vector<T> taps(numTaps);
+  double centre = (numTaps-1)/2.0;
+  double norm = besselI0(beta);
+  for(int n=0; n<numTaps; n++)
+  {
+    double t = n-centre;
+    double x = 2.0*cutoff*t;
+    double sinc = (t == 0) ? 1.0 : sin(IRIS_PI*x)/(IRIS_PI*x);
+    double r = (numTaps > 1) ? t/centre : 0.0;
+    double window = besselI0(beta*sqrt(std::max(0.0, 1.0-r*r)))/norm;
+    taps[n] = (T)(gain*2.0*cutoff*sinc*window);
+  }
+  return taps;
+}
+
 } // namespace iris
 
 #endif // DSP_H_
@@ -0,0 +1,190 @@
+/**
+ * \file lib/generic/math/FftwPlanner.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Shared creation and destruction of FFTW plans.
+ *
+ * The FFTW planner is not thread-safe, so every component which creates
+ * plans must go through a single lock. Plans may also be made from
+ * wisdom stored in a file, which makes startup with FFTW_MEASURE or
+ * FFTW_PATIENT fast and repeatable once the file has been written.
+ */
+
+#ifndef MATH_FFTWPLANNER_H_
+#define MATH_FFTWPLANNER_H_
+
+#include <set>
+#include <string>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#include "fftw3.h"
+#include "irisapi/Exceptions.h"
+
+namespace iris
+{
+
+/** Create and destroy FFTW plans safely from any thread.
+ *
+ * Planning rigor is given as a string so that it can be exposed directly
+ * as a component parameter: "estimate", "measure", "patient" or
+ * "exhaustive". If a wisdom file is given, it is imported before the
+ * first plan which uses it and exported again after every plan, so
+ * plans found by one component are reused by all others and by later
+ * runs. An empty file name disables wisdom.
+ */
+class FftwPlanner
+{
+ public:
+  /** Get the FFTW planner flags for a rigor.
+   *
+   * @param rigor   "estimate", "measure", "patient" or "exhaustive".
+   * @return        The corresponding FFTW flag.
+   */
+  static unsigned flags(const std::string& rigor)
+  {
+    if(rigor == "estimate")
+      return FFTW_ESTIMATE;
+    if(rigor == "measure")
+      return FFTW_MEASURE;
+    if(rigor == "patient")
+      return FFTW_PATIENT;
+    if(rigor == "exhaustive")
+      return FFTW_EXHAUSTIVE;
+    throw IrisException("Unknown fft planning rigor: " + rigor);
+  }
+
+  /** Plan a single one-dimensional transform.
+   *
+   * As with FFTW, planning with anything but "estimate" overwrites the
+   * contents of in and out.
+   *
+   * @param n           Length of the transform.
+   * @param in          Input array.
+   * @param out         Output array, may be the same as in.
+   * @param sign        FFTW_FORWARD or FFTW_BACKWARD.
+   * @param rigor       Planning rigor.
+   * @param wisdomFile  File used to store wisdom, or empty for none.
+   */
+  static fftwf_plan planDft1d(int n,
+                              fftwf_complex* in,
+                              fftwf_complex* out,
+                              int sign,
+                              const std::string& rigor,
+                              const std::string& wisdomFile = "")
+  {
+    return planManyDft(n, 1, in, n, out, n, sign, rigor, wisdomFile);
+  }
+
+  /** Plan a batch of contiguous one-dimensional transforms.
+   *
+   * @param n           Length of each transform.
+   * @param howMany     Number of transforms.
+   * @param in          Input array.
+   * @param inDist      Distance between the first elements of each input.
+   * @param out         Output array, may be the same as in.
+   * @param outDist     Distance between the first elements of each output.
+   * @param sign        FFTW_FORWARD or FFTW_BACKWARD.
+   * @param rigor       Planning rigor.
+   * @param wisdomFile  File used to store wisdom, or empty for none.
+   */
+  static fftwf_plan planManyDft(int n, int howMany,
+                                fftwf_complex* in, int inDist,
+                                fftwf_complex* out, int outDist,
+                                int sign,
+                                const std::string& rigor,
+                                const std::string& wisdomFile = "")
+  {
+    unsigned planFlags = flags(rigor);
+
+    boost::lock_guard< boost::mutex > lock(mutex());
+    if(!wisdomFile.empty() && importedFiles().count(wisdomFile) == 0)
+    {
+      fftwf_import_wisdom_from_filename(wisdomFile.c_str());
+      importedFiles().insert(wisdomFile);
+    }
+
+    fftwf_plan plan = fftwf_plan_many_dft(1, &n, howMany,
+                                          in, NULL, 1, inDist,
+                                          out, NULL, 1, outDist,
+                                          sign, planFlags);
+    if(plan == NULL)
+      throw IrisException("Failed to create fft plan.");
+
+    if(!wisdomFile.empty())
+      fftwf_export_wisdom_to_filename(wisdomFile.c_str());
+    return plan;
+  }
+
+  /// Destroy a plan. Does nothing if plan is NULL.
+  static void destroyPlan(fftwf_plan plan)
+  {
+    if(plan == NULL)
+      return;
+    boost::lock_guard< boost::mutex > lock(mutex());
+    fftwf_destroy_plan(plan);
+  }
+
+  /** Forget all accumulated wisdom.
+   *
+   * Wisdom files are imported again before the next plan which uses them,
+   * as they would be by a new process.
+   */
+  static void forgetWisdom()
+  {
+    boost::lock_guard< boost::mutex > lock(mutex());
+    fftwf_forget_wisdom();
+    importedFiles().clear();
+  }
+
+  /** Lock held while using the FFTW planner.
+   *
+   * Only needed by code which calls the FFTW planner directly.
+   */
+  static boost::mutex& mutex()
+  {
+    static boost::mutex m;
+    return m;
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "FftwPlanner"; }
+
+ private:
+  /// Wisdom files which have already been imported.
+  static std::set<std::string>& importedFiles()
+  {
+    static std::set<std::string> files;
+    return files;
+  }
+};
+
+} // namespace iris
+
+#endif // MATH_FFTWPLANNER_H_
@@ -54,7 +54,9 @@ enum QAM
 {
   BPSK=1,
   QPSK=2,
-  QAM16=4
+  QAM16=4,
+  QAM64=6,
+  QAM256=8
 };
 } // namespace iris
 
@@ -0,0 +1,87 @@
+/**
+ * \file lib/generic/math/test/Dsp_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for the DSP routines.
+ */
+
+#define BOOST_TEST_MODULE Dsp_Test
+
+#include "Dsp.h"
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+using namespace std;
+using namespace iris;
+
+/// Magnitude of the response of taps at frequency f (fraction of fs).
+static double response(const vector<double>& taps, double f)
+{
+  complex<double> sum(0,0);
+  for(size_t n=0; n<taps.size(); n++)
+    sum += taps[n]*polar(1.0, -2*IRIS_PI*f*n);
+  return abs(sum);
+}
+
+BOOST_AUTO_TEST_SUITE (Dsp_Test)
+
+BOOST_AUTO_TEST_CASE(Dsp_FastMag_Test)
+{
+  complex<float> c(3.0f, 4.0f);
+  BOOST_CHECK_CLOSE(fastMag(c), 5.0f, 5.0f);
+}
+
+BOOST_AUTO_TEST_CASE(Dsp_BesselI0_Test)
+{
+  BOOST_CHECK_CLOSE(besselI0(0.0), 1.0, 1e-9);
+  BOOST_CHECK_CLOSE(besselI0(1.0), 1.2660658777520082, 1e-9);
+  BOOST_CHECK_CLOSE(besselI0(10.0), 2815.7166284662544, 1e-9);
+}
+
+BOOST_AUTO_TEST_CASE(Dsp_KaiserLowpass_Test)
+{
+  // 60dB stopband, passband to 0.1, stopband from 0.15
+  double attenuation = 60;
+  int n = kaiserLength(attenuation, 0.05);
+  vector<double> taps = kaiserLowpass<double>(n, 0.125,
+                                              kaiserBeta(attenuation), 2.0);
+  BOOST_REQUIRE(n == (int)taps.size());
+  for(int i=0; i<n; i++)
+    BOOST_CHECK_CLOSE(taps[i], taps[n-1-i], 1e-9);
+
+  for(double f=0; f<=0.1; f+=0.005)
+    BOOST_CHECK_CLOSE(response(taps, f), 2.0, 0.2);
+  for(double f=0.15; f<=0.5; f+=0.005)
+    BOOST_CHECK(response(taps, f) < 2.0*pow(10.0, -57.0/20));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,170 @@
+/**
+ * \file lib/generic/math/test/FftwPlanner_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for FftwPlanner class.
+ */
+
+#define BOOST_TEST_MODULE FftwPlanner_Test
+
+#include "FftwPlanner.h"
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <fstream>
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float> Cplx;
+
+/// Plan, run and destroy a forward transform of an impulse.
+static void transformImpulse(int n, string rigor, string wisdomFile)
+{
+  Cplx* data = reinterpret_cast<Cplx*>(fftwf_malloc(sizeof(Cplx)*n));
+  fftwf_plan plan = FftwPlanner::planDft1d(n,
+                                           (fftwf_complex*)data,
+                                           (fftwf_complex*)data,
+                                           FFTW_FORWARD,
+                                           rigor, wisdomFile);
+  BOOST_REQUIRE(plan != NULL);
+
+  // Planning may overwrite the data, so fill it afterwards
+  fill(data, data+n, Cplx(0,0));
+  data[0] = Cplx(1,0);
+  fftwf_execute(plan);
+  for(int i=0; i<n; i++)
+  {
+    BOOST_CHECK_SMALL(data[i].real()-1.0f, 1e-4f);
+    BOOST_CHECK_SMALL(data[i].imag(), 1e-4f);
+  }
+
+  FftwPlanner::destroyPlan(plan);
+  fftwf_free(data);
+}
+
+/// Repeatedly create and destroy plans, counting any failures.
+static void planRepeatedly(int n, int* numFailed)
+{
+  Cplx* data = reinterpret_cast<Cplx*>(fftwf_malloc(sizeof(Cplx)*n));
+  for(int i=0; i<20; i++)
+  {
+    try
+    {
+      fftwf_plan plan = FftwPlanner::planDft1d(n,
+                                               (fftwf_complex*)data,
+                                               (fftwf_complex*)data,
+                                               FFTW_FORWARD, "measure");
+      FftwPlanner::destroyPlan(plan);
+    }
+    catch(IrisException& e)
+    {
+      boost::lock_guard< boost::mutex > lock(FftwPlanner::mutex());
+      (*numFailed)++;
+    }
+  }
+  fftwf_free(data);
+}
+
+BOOST_AUTO_TEST_SUITE (FftwPlanner_Test)
+
+BOOST_AUTO_TEST_CASE(FftwPlanner_Flags_Test)
+{
+  BOOST_CHECK(FftwPlanner::flags("estimate") == FFTW_ESTIMATE);
+  BOOST_CHECK(FftwPlanner::flags("measure") == FFTW_MEASURE);
+  BOOST_CHECK(FftwPlanner::flags("patient") == FFTW_PATIENT);
+  BOOST_CHECK(FftwPlanner::flags("exhaustive") == FFTW_EXHAUSTIVE);
+  BOOST_CHECK_THROW(FftwPlanner::flags("quick"), IrisException);
+}
+
+BOOST_AUTO_TEST_CASE(FftwPlanner_Plan_Test)
+{
+  transformImpulse(64, "estimate", "");
+  transformImpulse(64, "measure", "");
+  FftwPlanner::destroyPlan(NULL);
+}
+
+BOOST_AUTO_TEST_CASE(FftwPlanner_Many_Test)
+{
+  int n = 16;
+  int dist = 20;
+  int howMany = 4;
+  Cplx* data = reinterpret_cast<Cplx*>(fftwf_malloc(sizeof(Cplx)*dist*howMany));
+  fftwf_plan plan = FftwPlanner::planManyDft(n, howMany,
+                                             (fftwf_complex*)data, dist,
+                                             (fftwf_complex*)data, dist,
+                                             FFTW_FORWARD, "estimate");
+
+  // Each row holds an impulse delayed by its row number
+  fill(data, data+dist*howMany, Cplx(0,0));
+  for(int r=0; r<howMany; r++)
+    data[r*dist+r] = Cplx(1,0);
+  fftwf_execute(plan);
+  for(int r=0; r<howMany; r++)
+    for(int k=0; k<n; k++)
+    {
+      float a = -2*M_PI*r*k/n;
+      BOOST_CHECK_SMALL(abs(data[r*dist+k]-Cplx(cos(a),sin(a))), 1e-4f);
+    }
+
+  FftwPlanner::destroyPlan(plan);
+  fftwf_free(data);
+}
+
+BOOST_AUTO_TEST_CASE(FftwPlanner_Wisdom_Test)
+{
+  string wisdomFile = "FftwPlanner_test.wisdom";
+  remove(wisdomFile.c_str());
+
+  transformImpulse(128, "measure", wisdomFile);
+  ifstream f(wisdomFile.c_str());
+  BOOST_CHECK(f.good());
+  f.close();
+
+  // Plans made after forgetting are made from the stored wisdom
+  FftwPlanner::forgetWisdom();
+  transformImpulse(128, "measure", wisdomFile);
+  remove(wisdomFile.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(FftwPlanner_Threads_Test)
+{
+  // Boost.Test assertions are not thread-safe, so threads only plan
+  int numFailed = 0;
+  boost::thread_group threads;
+  for(int i=0; i<4; i++)
+    threads.create_thread(boost::bind(planRepeatedly, 32*(i+1), &numFailed));
+  threads.join_all();
+  BOOST_CHECK(numFailed == 0);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -29,13 +29,32 @@
  * \section DESCRIPTION
  *
  * Cyclic Redundancy Check Table.
+ *
+ * The CRC is generated eight bytes at a time using slice-by-8 tables. On
+ * x86 processors which support PCLMULQDQ, longer buffers are folded 64
+ * bytes at a time with carry-less multiplies, chosen at runtime.
  */
 
 #ifndef MOD_CRCTABLE_H_
 #define MOD_CRCTABLE_H_
 
+#include <cstddef>
+#include <vector>
 #include "irisapi/TypeInfo.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#define IRIS_CRC_CLMUL
+#define IRIS_CRC_CLMUL_TARGET __attribute__((target("pclmul,ssse3")))
+#elif defined(_M_X64)
+#include <intrin.h>
+#define IRIS_CRC_CLMUL
+#define IRIS_CRC_CLMUL_TARGET
+#endif
+
 namespace iris
 {
 
@@ -43,7 +62,7 @@ namespace iris
 namespace crcdetail
 {
 
-uint32_t crcTable[256]= {
+static const uint32_t crcTable[256]= {
   0x00000000U,0x04C11DB7U,0x09823B6EU,0x0D4326D9U,0x130476DCU,0x17C56B6BU,0x1A864DB2U,0x1E475005U,
   0x2608EDB8U,0x22C9F00FU,0x2F8AD6D6U,0x2B4BCB61U,0x350C9B64U,0x31CD86D3U,0x3C8EA00AU,0x384FBDBDU,
   0x4C11DB70U,0x48D0C6C7U,0x4593E01EU,0x4152FDA9U,0x5F15ADACU,0x5BD4B01BU,0x569796C2U,0x52568B75U,
@@ -78,11 +97,130 @@ uint32_t crcTable[256]= {
   0xAFB010B1U,0xAB710D06U,0xA6322BDFU,0xA2F33668U,0xBCB4666DU,0xB8757BDAU,0xB5365D03U,0xB1F740B4U,
   };
 
+/// The CRC polynomial x^32+x^26+x^23+x^22+x^16+x^12+x^11+x^10+x^8+x^7+x^5+x^4+x^2+x+1.
+const uint32_t crcPoly = 0x04C11DB7U;
+
+/// Remainder of x^n modulo the CRC polynomial.
+inline uint32_t xPowMod(int n)
+{
+  uint32_t r = 1;
+  for(int i=0; i<n; i++)
+    r = (r << 1) ^ ((r & 0x80000000U) ? crcPoly : 0);
+  return r;
+}
+
+/// Does the processor support PCLMULQDQ and SSSE3?
+inline bool cpuHasClmul()
+{
+#if defined(IRIS_CRC_CLMUL) && defined(__GNUC__)
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return false;
+  return (ecx & bit_PCLMUL) && (ecx & bit_SSSE3);
+#elif defined(IRIS_CRC_CLMUL)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 1)) && (info[2] & (1 << 9));
+#else
+  return false;
+#endif
+}
+
+/** Tables for generating the CRC, computed once per process.
+ *
+ * slice[k][b] is the CRC of byte b followed by k zero bytes, so
+ * slice[0] is crcTable. The folding constants are x^(n+64) and x^n
+ * modulo the CRC polynomial, for a fold across n bits.
+ */
+struct CrcTables
+{
+  uint32_t slice[8][256];
+  uint32_t fold16[2];   ///< Constants for folding across 16 bytes.
+  uint32_t fold64[2];   ///< Constants for folding across 64 bytes.
+  bool clmul;           ///< Use the carry-less multiply path.
+
+  CrcTables()
+  {
+    for(int b=0; b<256; b++)
+    {
+      slice[0][b] = crcTable[b];
+      for(int k=1; k<8; k++)
+        slice[k][b] = (slice[k-1][b] << 8) ^ crcTable[slice[k-1][b] >> 24];
+    }
+    fold16[0] = xPowMod(128);
+    fold16[1] = xPowMod(128+64);
+    fold64[0] = xPowMod(512);
+    fold64[1] = xPowMod(512+64);
+    clmul = cpuHasClmul();
+  }
+};
+
+/// The process-wide CRC tables.
+inline const CrcTables& crcTables()
+{
+  static const CrcTables tables;
+  return tables;
+}
+
+#ifdef IRIS_CRC_CLMUL
+/// Load 16 bytes with the first byte in the most significant position.
+IRIS_CRC_CLMUL_TARGET inline __m128i loadReversed(const uint8_t* in)
+{
+  const __m128i reverse = _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), reverse);
+}
+
+/// Fold x across n bits onto the following data, with k holding the
+/// constants {x^n, x^(n+64)} mod P in its low and high quadwords.
+IRIS_CRC_CLMUL_TARGET inline __m128i fold(__m128i x, __m128i k, __m128i data)
+{
+  return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x00),
+                                     _mm_clmulepi64_si128(x, k, 0x11)),
+                       data);
+}
+
+/** Fold a whole number of 64 byte blocks with carry-less multiplies.
+ *
+ * The data is treated as one polynomial and reduced to a 128-bit
+ * remainder with the same CRC, which is written to out.
+ *
+ * @param crc       CRC of the preceding data.
+ * @param in        The data (at least 64 bytes).
+ * @param numBlocks Number of 64 byte blocks.
+ * @param out       The 16 byte remainder.
+ */
+IRIS_CRC_CLMUL_TARGET inline void foldClmul(uint32_t crc, const uint8_t* in,
+                                            size_t numBlocks, uint8_t* out)
+{
+  const CrcTables& t = crcTables();
+  __m128i k64 = _mm_set_epi32(0, t.fold64[1], 0, t.fold64[0]);
+  __m128i k16 = _mm_set_epi32(0, t.fold16[1], 0, t.fold16[0]);
+
+  // The previous CRC is added to the first 32 bits of the data
+  __m128i x0 = _mm_xor_si128(loadReversed(in), _mm_set_epi32(crc, 0, 0, 0));
+  __m128i x1 = loadReversed(in+16);
+  __m128i x2 = loadReversed(in+32);
+  __m128i x3 = loadReversed(in+48);
+  for(size_t i=1; i<numBlocks; i++)
+  {
+    in += 64;
+    x0 = fold(x0, k64, loadReversed(in));
+    x1 = fold(x1, k64, loadReversed(in+16));
+    x2 = fold(x2, k64, loadReversed(in+32));
+    x3 = fold(x3, k64, loadReversed(in+48));
+  }
+  x0 = fold(fold(fold(x0, k16, x1), k16, x2), k16, x3);
+
+  const __m128i reverse = _mm_set_epi8(0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15);
+  _mm_storeu_si128((__m128i*)out, _mm_shuffle_epi8(x0, reverse));
+}
+#endif
+
 } // namespace crcdetail
 
 /** A cyclic redundancy check class.
  *
- * The Crc class simply provides a static function to
+ * The Crc class simply provides static functions to
  * generate a 32-bit CRC for a given set of data.
  */
 class Crc
@@ -104,6 +242,91 @@ public:
     return crc;
   }
 
+  /// Generate a 32-bit crc for contiguous uint8_t data.
+  static uint32_t generate(const uint8_t* inBegin, const uint8_t* inEnd)
+  {
+    return update(0, inBegin, inEnd);
+  }
+
+  /// Generate a 32-bit crc for contiguous uint8_t data.
+  static uint32_t generate(uint8_t* inBegin, uint8_t* inEnd)
+  {
+    return update(0, inBegin, inEnd);
+  }
+
+  /// Generate a 32-bit crc for the data in a vector.
+  static uint32_t generate(std::vector<uint8_t>::const_iterator inBegin,
+                           std::vector<uint8_t>::const_iterator inEnd)
+  {
+    return inBegin == inEnd ? 0 : update(0, &*inBegin, &*inBegin+(inEnd-inBegin));
+  }
+
+  /// Generate a 32-bit crc for the data in a vector.
+  static uint32_t generate(std::vector<uint8_t>::iterator inBegin,
+                           std::vector<uint8_t>::iterator inEnd)
+  {
+    return inBegin == inEnd ? 0 : update(0, &*inBegin, &*inBegin+(inEnd-inBegin));
+  }
+
+  /** Continue a 32-bit crc over some more contiguous uint8_t data.
+   *
+   * Uses carry-less multiplies if supported by the processor and the
+   * data is long enough, otherwise slice-by-8 tables.
+   *
+   * @param crc     The crc of the preceding data (0 to start).
+   * @param inBegin Pointer to first data element.
+   * @param inEnd   Pointer to one past last data element.
+   * @return        The crc of the preceding data followed by this data.
+   */
+  static uint32_t update(uint32_t crc, const uint8_t* inBegin,
+                         const uint8_t* inEnd)
+  {
+#ifdef IRIS_CRC_CLMUL
+    if(inEnd-inBegin >= 64 && crcdetail::crcTables().clmul)
+      return updateClmul(crc, inBegin, inEnd);
+#endif
+    return updateSlice8(crc, inBegin, inEnd);
+  }
+
+  /// Continue a 32-bit crc using slice-by-8 tables.
+  static uint32_t updateSlice8(uint32_t crc, const uint8_t* inBegin,
+                               const uint8_t* inEnd)
+  {
+    const uint32_t (*t)[256] = crcdetail::crcTables().slice;
+    for(; inEnd-inBegin >= 8; inBegin += 8)
+    {
+      const uint8_t* b = inBegin;
+      crc = t[7][b[0] ^ (crc >> 24)] ^ t[6][b[1] ^ ((crc >> 16) & 0xff)] ^
+            t[5][b[2] ^ ((crc >> 8) & 0xff)] ^ t[4][b[3] ^ (crc & 0xff)] ^
+            t[3][b[4]] ^ t[2][b[5]] ^ t[1][b[6]] ^ t[0][b[7]];
+    }
+    for(; inBegin != inEnd; ++inBegin)
+      crc = t[0][*inBegin ^ (crc >> 24)] ^ (crc << 8);
+    return crc;
+  }
+
+#ifdef IRIS_CRC_CLMUL
+  /// Continue a 32-bit crc using carry-less multiplies.
+  /// Only valid if hasClmul() is true.
+  static uint32_t updateClmul(uint32_t crc, const uint8_t* inBegin,
+                              const uint8_t* inEnd)
+  {
+    size_t numBlocks = (inEnd-inBegin)/64;
+    if(numBlocks == 0)
+      return updateSlice8(crc, inBegin, inEnd);
+    uint8_t remainder[16];
+    crcdetail::foldClmul(crc, inBegin, numBlocks, remainder);
+    crc = updateSlice8(0, remainder, remainder+16);
+    return updateSlice8(crc, inBegin+numBlocks*64, inEnd);
+  }
+#endif
+
+  /// Does this processor support the carry-less multiply path?
+  static bool hasClmul()
+  {
+    return crcdetail::crcTables().clmul;
+  }
+
 private:
   Crc(){}; ///< Disable constructor by making it private
 };
@@ -0,0 +1,232 @@
+/**
+ * \file lib/generic/modulation/Nco.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * A numerically controlled oscillator, which generates complex tones and
+ * mixes them with signals.
+ */
+
+#ifndef MOD_NCO_H_
+#define MOD_NCO_H_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IRIS_NCO_SSE2
+#endif
+
+#include "irisapi/TypeInfo.h"
+#include "math/MathDefines.h"
+
+namespace iris
+{
+
+/** A numerically controlled oscillator.
+ *
+ * The phase is kept in a 32-bit accumulator (2^32 per cycle) and carries
+ * on from one call to the next. Samples are processed in blocks of
+ * blockLength: the phasor at the start of each block is computed exactly
+ * and multiplied by a table of the phase steps within a block, so rounding
+ * errors do not build up.
+ *
+ * Frequencies are in cycles per sample and phases in cycles. The output
+ * and the samples mixed must be in contiguous containers.
+ */
+class Nco
+{
+ public:
+  typedef std::complex<float>     Cplx;
+  typedef std::vector<Cplx>       CplxVec;
+
+  /// Samples processed with each exactly computed phasor.
+  static const int blockLength = 64;
+
+  /** Create an NCO.
+   *
+   * @param frequency   Frequency in cycles per sample.
+   * @param phase       Initial phase in cycles.
+   */
+  Nco(double frequency = 0, double phase = 0)
+    : phase_(0), step_(0), steps_(blockLength)
+  {
+    setFrequency(frequency);
+    setPhase(phase);
+  }
+
+  /// Set the frequency in cycles per sample.
+  void setFrequency(double frequency)
+  {
+    step_ = toAccumulator(frequency);
+    for(int k=0; k<blockLength; k++)
+      steps_[k] = phasor(step_*(uint32_t)k);
+  }
+
+  /// Set the phase in cycles.
+  void setPhase(double phase)
+  {
+    phase_ = toAccumulator(phase);
+  }
+
+  /// Get the frequency in cycles per sample, in [-0.5, 0.5).
+  double frequency() const
+  {
+    return (int32_t)step_/4294967296.0;
+  }
+
+  /// Get the phase in cycles, in [0, 1).
+  double phase() const
+  {
+    return phase_/4294967296.0;
+  }
+
+  /** Generate a complex tone, continuing from the current phase.
+   *
+   * @param outBegin    Iterator to first element in output container.
+   * @param outEnd      Iterator to one past last element in output.
+   */
+  template <class Iterator>
+  void generate(Iterator outBegin, Iterator outEnd)
+  {
+    if(outBegin != outEnd)
+      process(NULL, &*outBegin, outEnd-outBegin);
+  }
+
+  /** Multiply some samples by the tone, in place.
+   *
+   * @param begin   Iterator to first sample.
+   * @param end     Iterator to one past last sample.
+   */
+  template <class Iterator>
+  void mix(Iterator begin, Iterator end)
+  {
+    if(begin != end)
+      process(&*begin, &*begin, end-begin);
+  }
+
+  /** Multiply some samples by the tone, writing to a separate output.
+   *
+   * @param inBegin     Iterator to first input sample.
+   * @param inEnd       Iterator to one past last input sample.
+   * @param outBegin    Iterator to first output sample.
+   */
+  template <class InputIterator, class OutputIterator>
+  void mix(InputIterator inBegin, InputIterator inEnd,
+           OutputIterator outBegin)
+  {
+    if(inBegin != inEnd)
+      process(&*inBegin, &*outBegin, inEnd-inBegin);
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "Nco"; }
+
+ private:
+  /// Convert cycles to the accumulator's units, modulo one cycle.
+  static uint32_t toAccumulator(double cycles)
+  {
+    double frac = cycles - std::floor(cycles);
+    return (uint32_t)(uint64_t)(frac*4294967296.0 + 0.5);
+  }
+
+  /// The unit phasor of an accumulator phase.
+  static Cplx phasor(uint32_t phase)
+  {
+    double angle = 2.0 * IRIS_PI * (phase/4294967296.0);
+    return Cplx((float)std::cos(angle), (float)std::sin(angle));
+  }
+
+#ifdef IRIS_NCO_SSE2
+  /// Multiply two pairs of interleaved complex floats.
+  static __m128 multiply(__m128 a, __m128 b)
+  {
+    const __m128 negReal = _mm_castsi128_ps(
+        _mm_set_epi32(0, 0x80000000, 0, 0x80000000));
+    __m128 aRe = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,2,0,0));
+    __m128 aIm = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3,3,1,1));
+    __m128 bSwap = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,3,0,1));
+    return _mm_add_ps(_mm_mul_ps(aRe, b),
+                      _mm_xor_ps(_mm_mul_ps(aIm, bSwap), negReal));
+  }
+#endif
+
+  /** Generate (in is NULL) or mix num samples from the current phase.
+   *
+   * in and out may be the same.
+   */
+  void process(const Cplx* in, Cplx* out, std::ptrdiff_t num)
+  {
+    while(num > 0)
+    {
+      int n = (int)std::min<std::ptrdiff_t>(num, blockLength);
+      Cplx base = phasor(phase_);
+      int k = 0;
+#ifdef IRIS_NCO_SSE2
+      __m128 b = _mm_setr_ps(base.real(), base.imag(),
+                             base.real(), base.imag());
+      const float* s = (const float*)&steps_[0];
+      float* o = (float*)out;
+      if(in)
+      {
+        const float* x = (const float*)in;
+        for(; k+2 <= n; k+=2)
+        {
+          __m128 rot = multiply(b, _mm_loadu_ps(s+2*k));
+          _mm_storeu_ps(o+2*k, multiply(_mm_loadu_ps(x+2*k), rot));
+        }
+      }
+      else
+      {
+        for(; k+2 <= n; k+=2)
+          _mm_storeu_ps(o+2*k, multiply(b, _mm_loadu_ps(s+2*k)));
+      }
+#endif
+      for(; k<n; k++)
+        out[k] = in ? in[k]*(base*steps_[k]) : base*steps_[k];
+
+      phase_ += step_*(uint32_t)n;
+      if(in)
+        in += n;
+      out += n;
+      num -= n;
+    }
+  }
+
+  uint32_t phase_;    ///< Phase accumulator, 2^32 per cycle.
+  uint32_t step_;     ///< Phase step per sample.
+  CplxVec steps_;     ///< Phasors of the first blockLength phase steps.
+};
+
+} // namespace iris
+
+#endif // MOD_NCO_H_
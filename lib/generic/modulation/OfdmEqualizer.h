@@ -0,0 +1,240 @@
+/**
+ * \file lib/generic/modulation/OfdmEqualizer.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Fused equalization of received OFDM symbols. Corrects the integer
+ * frequency offset, applies the channel equalizer, tracks the common
+ * phase error using the pilot carriers and extracts the data carriers
+ * in a single pass over the data carriers.
+ *
+ * The data carrier pass is vectorized using AVX or SSE2 when the compiler
+ * targets them (e.g. -mavx or x86_64) and falls back to scalar code
+ * otherwise.
+ */
+
+#ifndef MOD_OFDMEQUALIZER_H_
+#define MOD_OFDMEQUALIZER_H_
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define IRIS_OFDMEQUALIZER_AVX
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IRIS_OFDMEQUALIZER_SSE2
+#endif
+
+#include "irisapi/Exceptions.h"
+
+namespace iris
+{
+
+/** Equalize received OFDM symbols and extract their data carriers.
+ *
+ * For a symbol with bins b, the output is identical to the sequence
+ *   1. rotate b left by shift (integer frequency offset correction)
+ *   2. multiply each bin by the equalizer
+ *   3. average pilotSequence[i]/b[pilotIndices[i]] and multiply every
+ *      bin by a unit phasor with the angle of the average
+ *   4. gather the bins at dataIndices
+ * but only touches the pilot and data carriers, once each. The pilot
+ * error power of each symbol is returned for link quality metrics.
+ *
+ * An OfdmEqualizer is not modified by equalize() so a single object can
+ * be shared by several threads.
+ */
+class OfdmEqualizer
+{
+ public:
+  typedef std::complex<float>   Cplx;
+  typedef std::vector<Cplx>     CplxVec;
+  typedef std::vector<int>      IntVec;
+
+  OfdmEqualizer()
+    :numBins_(0)
+    ,pilotPower_(1)
+  {}
+
+  /** Set the carrier layout used for all following symbols.
+   *
+   * @param numBins         Number of bins per symbol.
+   * @param pilotIndices    Indices of the pilot carriers.
+   * @param dataIndices     Indices of the data carriers.
+   * @param pilotSequence   Known pilot symbols, repeated across the pilots.
+   */
+  void reset(int numBins,
+             const IntVec& pilotIndices,
+             const IntVec& dataIndices,
+             const CplxVec& pilotSequence)
+  {
+    if(pilotSequence.empty())
+      throw IrisException("OfdmEqualizer requires a pilot sequence.");
+    numBins_ = numBins;
+    pilotIndices_ = pilotIndices;
+    dataIndices_ = dataIndices;
+    pilots_.resize(pilotIndices.size());
+    pilotPower_ = 0;
+    for(int i=0; i<pilots_.size(); i++)
+    {
+      pilots_[i] = pilotSequence[i%pilotSequence.size()];
+      pilotPower_ += norm(pilots_[i]);
+    }
+  }
+
+  /** Equalize a single symbol.
+   *
+   * @param bins        Bins of the received symbol, before rotation.
+   * @param shift       Left rotation of the bins, 0 <= shift < numBins.
+   * @param equalizer   Equalizer for the rotated bins.
+   * @param out         Output for the equalized data carriers.
+   * @return            Pilot error power of the symbol, as pilotError().
+   */
+  float equalize(const Cplx* bins, int shift, const Cplx* equalizer,
+                 Cplx* out) const
+  {
+    // Common phase error from the equalized pilots
+    Cplx sum(0,0);
+    for(int i=0; i<pilotIndices_.size(); i++)
+    {
+      int k = pilotIndices_[i];
+      sum += pilots_[i]/(bins[wrap(k+shift)]*equalizer[k]);
+    }
+    float ave = arg(sum/(float)pilotIndices_.size());
+    Cplx corrector = Cplx(cos(ave), sin(ave));
+
+    float error = 0;
+    for(int i=0; i<pilotIndices_.size(); i++)
+    {
+      int k = pilotIndices_[i];
+      error += norm(bins[wrap(k+shift)]*equalizer[k]*corrector - pilots_[i]);
+    }
+
+    const int* idx = dataIndices_.empty() ? NULL : &dataIndices_[0];
+    int numData = dataIndices_.size();
+    int i = 0;
+
+#if defined(IRIS_OFDMEQUALIZER_AVX)
+    __m256 c = _mm256_setr_ps(corrector.real(), corrector.imag(),
+                              corrector.real(), corrector.imag(),
+                              corrector.real(), corrector.imag(),
+                              corrector.real(), corrector.imag());
+    for(; i+4<=numData; i+=4)
+    {
+      __m256 b = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                     load2(bins, wrap(idx[i]+shift), wrap(idx[i+1]+shift))),
+                     load2(bins, wrap(idx[i+2]+shift), wrap(idx[i+3]+shift)), 1);
+      __m256 e = _mm256_insertf128_ps(_mm256_castps128_ps256(
+                     load2(equalizer, idx[i], idx[i+1])),
+                     load2(equalizer, idx[i+2], idx[i+3]), 1);
+      _mm256_storeu_ps((float*)(out+i), mul(mul(b, e), c));
+    }
+#elif defined(IRIS_OFDMEQUALIZER_SSE2)
+    __m128 c = _mm_setr_ps(corrector.real(), corrector.imag(),
+                           corrector.real(), corrector.imag());
+    for(; i+2<=numData; i+=2)
+    {
+      __m128 b = load2(bins, wrap(idx[i]+shift), wrap(idx[i+1]+shift));
+      __m128 e = load2(equalizer, idx[i], idx[i+1]);
+      _mm_storeu_ps((float*)(out+i), mul(mul(b, e), c));
+    }
+#endif
+
+    for(; i<numData; i++)
+      out[i] = bins[wrap(idx[i]+shift)]*equalizer[idx[i]]*corrector;
+    return error/pilotPower_;
+  }
+
+  /** Get the pilot error power of an equalized symbol.
+   *
+   * The squared error of the equalized pilots, relative to the power of
+   * the known pilots. Its square root averaged over symbols is the rms
+   * error vector magnitude (EVM) of the pilots.
+   *
+   * @param bins    Rotated and equalized bins of the symbol.
+   */
+  float pilotError(const Cplx* bins) const
+  {
+    float error = 0;
+    for(int i=0; i<pilotIndices_.size(); i++)
+      error += norm(bins[pilotIndices_[i]] - pilots_[i]);
+    return error/pilotPower_;
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "OfdmEqualizer"; }
+
+ private:
+  /// Index into the unrotated bins, for 0 <= k < 2*numBins.
+  int wrap(int k) const { return k < numBins_ ? k : k-numBins_; }
+
+#if defined(IRIS_OFDMEQUALIZER_AVX) || defined(IRIS_OFDMEQUALIZER_SSE2)
+  /// Load two complex values from arbitrary positions.
+  static __m128 load2(const Cplx* p, int a, int b)
+  {
+    __m128 r = _mm_setzero_ps();
+    r = _mm_loadl_pi(r, (const __m64*)(p+a));
+    return _mm_loadh_pi(r, (const __m64*)(p+b));
+  }
+#endif
+
+#if defined(IRIS_OFDMEQUALIZER_AVX)
+  /// Multiply four pairs of interleaved complex values.
+  static __m256 mul(__m256 a, __m256 b)
+  {
+    __m256 re = _mm256_moveldup_ps(a);
+    __m256 im = _mm256_movehdup_ps(a);
+    __m256 sw = _mm256_permute_ps(b, 0xB1);
+    return _mm256_addsub_ps(_mm256_mul_ps(re, b), _mm256_mul_ps(im, sw));
+  }
+#elif defined(IRIS_OFDMEQUALIZER_SSE2)
+  /// Multiply two pairs of interleaved complex values.
+  static __m128 mul(__m128 a, __m128 b)
+  {
+    __m128 re = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2,2,0,0));
+    __m128 im = _mm_shuffle_ps(a, a, _MM_SHUFFLE(3,3,1,1));
+    __m128 sw = _mm_shuffle_ps(b, b, _MM_SHUFFLE(2,3,0,1));
+    __m128 sign = _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f);
+    return _mm_add_ps(_mm_mul_ps(re, b),
+                      _mm_xor_ps(_mm_mul_ps(im, sw), sign));
+  }
+#endif
+
+  int numBins_;           ///< Number of bins per symbol.
+  IntVec pilotIndices_;   ///< Indices of the pilot carriers.
+  IntVec dataIndices_;    ///< Indices of the data carriers.
+  CplxVec pilots_;        ///< Known pilot symbol for each pilot carrier.
+  float pilotPower_;      ///< Total power of the known pilots.
+};
+
+} // namespace iris
+
+#endif // MOD_OFDMEQUALIZER_H_
@@ -38,8 +38,8 @@
 #define MOD_OFDMPREAMBLEDETECTOR_H_
 
 #include <complex>
+#include <vector>
 #include <boost/noncopyable.hpp>
-#include <boost/circular_buffer.hpp>
 #include <algorithm>
 
 #include "irisapi/Exceptions.h"
@@ -52,16 +52,45 @@
 namespace iris
 {
 
-/// Detect OFDM preambles using Schmidl & Cox algorithm.
+/** Detect OFDM preambles using Schmidl & Cox algorithm.
+ *
+ * Input is processed in blocks of up to blockLen samples. Each block is
+ * copied in after the history kept from the previous block, so the
+ * delayed autocorrelation P, energy E and metric V can be computed over
+ * contiguous arrays. The running sums are updated in the same order as a
+ * sample-by-sample search, so peaks are found at exactly the same samples.
+ *
+ * An optional coarse stage (see setCoarseSearch()) evaluates the metric
+ * on every decimation'th sample only, over correspondingly fewer terms.
+ * The full-resolution search is run only on blocks within a symbol or so
+ * of a sample where the coarse metric exceeds its threshold. It is warmed
+ * up over the history kept from before the block, so preambles are found
+ * at the same samples as by the full search unless the coarse stage
+ * misses them.
+ */
 class OfdmPreambleDetector
   : boost::noncopyable
 {
 public:
-  typedef std::complex<float>             Cplx;
-  typedef boost::circular_buffer<Cplx>    CplxBuf;
-  typedef CplxBuf::iterator               CplxBufIt;
-  typedef boost::circular_buffer<float>   FloatBuf;
-  typedef FloatBuf::iterator              FloatBufIt;
+  typedef std::complex<float>       Cplx;
+  typedef std::vector<Cplx>         CplxVec;
+  typedef CplxVec::iterator         CplxVecIt;
+  typedef std::vector<float>        FloatVec;
+  typedef FloatVec::iterator        FloatVecIt;
+
+  /// Details of a detected preamble.
+  struct Result
+  {
+    bool detected;      ///< Was a preamble detected?
+    float freqOffset;   ///< Fractional frequency offset (subcarriers).
+    float snr;          ///< Estimated SNR (dB).
+    float peakMetric;   ///< Peak of the moving average of V (in range [0,1]).
+    int plateauWidth;   ///< Samples above threshold up to the peak.
+
+    Result()
+      :detected(false), freqOffset(0), snr(0), peakMetric(0), plateauWidth(0)
+    {}
+  };
 
   /** Create an OFDM preamble detector.
    *
@@ -73,45 +102,62 @@ public:
                        int cyclicPrefixLen = 16,
                        float threshold = 0.827,
                        bool debug = false)
-    :sLen_(symbolLen)
-    ,cpLen_(cyclicPrefixLen)
-    ,thresh_(threshold*cyclicPrefixLen)
-    ,debug_(debug)
-    ,symbolBuffer_(symbolLen+cyclicPrefixLen)
-    ,halfBuffer_(symbolLen/2, Cplx(0,0))
-    ,eBuffer_(symbolLen, Cplx(0,0))
-    ,pBuffer_(symbolLen/2, Cplx(0,0))
-    ,vBuffer_(cyclicPrefixLen, 0.0)
-    ,vDebugBuffer_(symbolLen, 0.0)
-    ,currentP_(0,0)
-    ,currentE_(0,0)
-    ,vMovingAve_(0.0)
-    ,lastVma_(0.0)
-  {}
+    :decimation_(1)
+    ,coarseThresh_(0.5)
+  {
+    reset(symbolLen, cyclicPrefixLen, threshold, debug);
+  }
 
   /** Search for a preamble in the range [inBegin, inEnd).
    *
    * A detected preamble will be copied into the range
-   * [preambleBegin, preambleEnd). If no preamble is detected,
-   * the returned iterator == inEnd.
+   * [preambleBegin, preambleEnd) and described in result. The
+   * estimates in result are only computed when a preamble is detected.
+   * If no preamble is detected, the returned iterator == inEnd and
+   * result is left unchanged.
    *
    * @param inBegin         Iterator to first input signal sample.
    * @param inEnd           Iterator to one past last input sample.
    * @param preambleBegin   Iterator to first sample preamble container.
    * @param preambleEnd     Iterator to one past last sample of container.
-   * @param freqOffset      Estimated frequency offset.
-   * @param snr             Estimated SNR.
+   * @param result          Details of the detected preamble.
    * \return                Iterator to start of detected preamble or last
    *                          searched input sample.
    */
   template <class Iterator>
   Iterator search(Iterator inBegin, Iterator inEnd,
                   Iterator preambleBegin, Iterator preambleEnd,
-                  bool &detected, float &freqOffset, float &snr);
+                  Result &result);
+
+  /** Configure the coarse search stage and reset the detector.
+   *
+   * @param decimation  Evaluate the coarse metric on every decimation'th
+   *                    sample (1 disables the coarse stage).
+   * @param threshold   Coarse metric threshold (in range [0,1]).
+   */
+  void setCoarseSearch(int decimation, float threshold)
+  {
+    if(decimation < 1)
+      throw IrisException("Coarse search decimation must be at least 1");
+    decimation_ = decimation;
+    coarseThresh_ = threshold;
+    reset(sLen_, cpLen_, thresh_/cpLen_, debug_);
+  }
 
   /// Reset the detector (keep current parameters).
   void reset()
-  {reset(sLen_,cpLen_,thresh_/cpLen_, debug_);}
+  {
+    std::fill(samples_.begin(), samples_.begin()+hist_, Cplx(0,0));
+    clearFineState(hist_);
+    fineWarm_ = true;
+    fineLeft_ = 0;
+    std::fill(coarseP_.begin(), coarseP_.end(), Cplx(0,0));
+    std::fill(coarseE_.begin(), coarseE_.end(), 0);
+    coarseIndex_ = 0;
+    coarseSumP_ = Cplx(0,0);
+    coarseSumE_ = 0;
+    coarsePhase_ = 0;
+  }
 
   /// Reset the detector.
   void reset(int symbolLen, int cyclicPrefixLen, float threshold, bool debug=false)
@@ -120,36 +166,65 @@ public:
     cpLen_ = cyclicPrefixLen;
     thresh_ = threshold*cyclicPrefixLen;
     debug_ = debug;
-    symbolBuffer_.assign(sLen_+cpLen_, Cplx(0,0));
-    halfBuffer_.assign(sLen_/2, Cplx(0,0));
-    eBuffer_.assign(sLen_, Cplx(0,0));
-    pBuffer_.assign(sLen_/2, Cplx(0,0));
-    vBuffer_.assign(cpLen_, 0);
-    vDebugBuffer_.assign(sLen_, 0);
-    currentP_ = Cplx(0,0);
-    currentE_ = Cplx(0,0);
-    vMovingAve_ = 0;
+
+    // The V moving average is exact one symbol plus CP after a restart
+    warmLen_ = (decimation_ > 1) ? sLen_+cpLen_ : 0;
+    hist_ = sLen_+cpLen_+warmLen_;
+    samples_.assign(hist_+blockLen, Cplx(0,0));
+    pTerms_.assign(hist_+blockLen, Cplx(0,0));
+    eTerms_.assign(hist_+blockLen, Cplx(0,0));
+    pSums_.assign(hist_+blockLen, Cplx(0,0));
+    eSums_.assign(hist_+blockLen, Cplx(0,0));
+    v_.assign(hist_+blockLen, 0);
+
+    int coarseLen = std::max(1, sLen_/(2*decimation_));
+    coarseP_.assign(coarseLen, Cplx(0,0));
+    coarseE_.assign(coarseLen*2, 0);
+    reset();
   }
 
   /// Convenience function for logging.
   static std::string getName(){ return "OfdmPreambleDetector"; }
 
+  /// Maximum number of samples processed per block.
+  static const int blockLen = 1024;
+
 private:
-  CplxBuf symbolBuffer_;    ///< Holds last full symbol (including CP).
-  CplxBuf halfBuffer_;      ///< Holds last half-symbol.
-  CplxBuf eBuffer_;         ///< Holds last symbol length of e values.
-  CplxBuf pBuffer_;         ///< Holds last half-symbol length of p values.
-  FloatBuf vBuffer_;        ///< Holds last CP length of v values.
-  FloatBuf vDebugBuffer_;   ///< Holds last symbol length of v values for debug.
+  int coarseSearch(int n);
+  void clearFineState(int first);
+  void computeMetric(int first, int last);
+  void carryHistory(int n);
+
+  // Sample, term and metric arrays share one layout: hist_ entries kept
+  // from earlier blocks, followed by the current block.
+  CplxVec samples_;   ///< Input samples.
+  CplxVec pTerms_;    ///< Terms of P.
+  CplxVec eTerms_;    ///< Terms of E.
+  CplxVec pSums_;     ///< Running P after each sample.
+  CplxVec eSums_;     ///< Running E after each sample.
+  FloatVec v_;        ///< V (normalized correlation) of each sample.
+  int hist_;          ///< Entries kept from earlier blocks.
+  int warmLen_;       ///< Samples used to warm up a restarted search.
 
   Cplx currentP_;               ///< Current P (correlation value)
   Cplx currentE_;               ///< Current E (power value)
   float vMovingAve_, lastVma_;  ///< Moving averages of V (normalized correlation)
-  float maxVal_, maxValThresh_; ///< Used for peak detection.
-  int sLen_, cpLen_;            ///< Symbol length, CP length, extension length
+  int plateauWidth_;            ///< Samples above threshold so far.
+  int sLen_, cpLen_;            ///< Symbol length, CP length
   float thresh_;                ///< Detection threshold.
   bool debug_;                  ///< Is debugging on?
 
+  int decimation_;              ///< Coarse stage decimation (1 = no coarse stage).
+  float coarseThresh_;          ///< Coarse stage threshold.
+  bool fineWarm_;               ///< Did the full search run on the last block?
+  int fineLeft_;                ///< Samples left to search at full resolution.
+  CplxVec coarseP_;             ///< Last half-symbol of decimated P terms.
+  FloatVec coarseE_;            ///< Last symbol of decimated E terms.
+  int coarseIndex_;             ///< Oldest entry of coarseE_.
+  Cplx coarseSumP_;             ///< Decimated P.
+  float coarseSumE_;            ///< Decimated E.
+  int coarsePhase_;             ///< Index of the next decimated sample in the block.
+
 };
 
 template <class Iterator>
@@ -157,80 +232,185 @@ Iterator OfdmPreambleDetector::search(Iterator inBegin,
                                       Iterator inEnd,
                                       Iterator preambleBegin,
                                       Iterator preambleEnd,
-                                      bool &detected,
-                                      float &freqOffset,
-                                      float &snr)
+                                      Result &result)
 {
-  int counter=-1;
-
-  for(; inBegin != inEnd; ++inBegin)
+  while(inBegin != inEnd)
   {
-    counter++;
-
-    //Add current sample to symbolBuffer_
-    symbolBuffer_.push_back(*inBegin);
-
-    Cplx  nextSymbol = *inBegin;
-    Cplx  midSymbol = halfBuffer_.front();
-
-    //Add current sample to the halfBuffer_
-    halfBuffer_.push_back(*inBegin);
-
-    //Iterate for P
-    Cplx  nextP = conj(nextSymbol)*midSymbol;
-    Cplx  tailP = pBuffer_.front();
-    currentP_ += (nextP - tailP);
-    pBuffer_.push_back(nextP);
-
-    //Iterate for E
-    Cplx  nextE = conj(nextSymbol)*nextSymbol;
-    Cplx  tailE = eBuffer_.front();
-    currentE_ += (nextE - tailE);
-    eBuffer_.push_back(nextE);
-
-    //Use P and E values to calculate V
-    //float magP = abs(currentP_);
-    //float magE = abs(currentE_);
-    float magP = fastMag(currentP_);
-    float magE = fastMag(currentE_);
-    float den = magE*magE;
-    float v = (den == 0) ? 0 : ((2*magP)*(2*magP))/den;
+    int n = std::min<std::ptrdiff_t>(blockLen, inEnd-inBegin);
+    std::copy(inBegin, inBegin+n, samples_.begin()+hist_);
 
-    //Estimate the SNR
-    snr = 10*log10(sqrtf(v)/(1-sqrtf(v)));
+    // Skip blocks the coarse stage finds nothing near
+    int first = hist_;
+    if(decimation_ > 1)
+    {
+      int candidate = coarseSearch(n);
+      bool runFine = candidate >= 0 || fineLeft_ > 0;
+      if(candidate >= 0)
+        fineLeft_ = std::max(fineLeft_, candidate+sLen_+2*cpLen_);
+      fineLeft_ = std::max(0, fineLeft_-n);
 
-    //Iterate for the moving average value of V
-    lastVma_ = vMovingAve_;
-    vMovingAve_ += (v - vBuffer_.front());
-    vBuffer_.push_back(v);
-    vDebugBuffer_.push_back(v);
+      if(!runFine)
+      {
+        fineWarm_ = false;
+        carryHistory(n);
+        inBegin += n;
+        continue;
+      }
+      if(!fineWarm_)
+      {
+        first = hist_-warmLen_;
+        clearFineState(first);
+        fineWarm_ = true;
+      }
+    }
+    computeMetric(first, hist_+n);
 
     //Check the moving average V value for threshold and peak
-    if(vMovingAve_ > thresh_ && vMovingAve_ < lastVma_)
+    for(int i=first; i<hist_+n; i++)
     {
-      detected = true;
+      lastVma_ = vMovingAve_;
+      vMovingAve_ += (v_[i] - v_[i-cpLen_]);
+      if(!(vMovingAve_ > thresh_))
+      {
+        plateauWidth_ = 0;
+        continue;
+      }
+      if(!(vMovingAve_ < lastVma_) || i < hist_)
+      {
+        plateauWidth_++;
+        continue;
+      }
+
+      result.detected = true;
+      result.snr = 10*log10(sqrtf(v_[i])/(1-sqrtf(v_[i])));
+      result.peakMetric = lastVma_/cpLen_;
+      result.plateauWidth = plateauWidth_;
 
       if(debug_)
-          RawFileUtility::write(vDebugBuffer_.begin(), vDebugBuffer_.end(),
+          RawFileUtility::write(v_.begin()+i+1-sLen_, v_.begin()+i+1,
                                 "OutputData/RxFrameDetectVArray");
 
       //We've detected the peak - copy the preamble into output vector
       if((preambleEnd-preambleBegin) < sLen_+cpLen_)
         throw IrisException("Insufficient storage provided for preamble output");
-      std::copy(symbolBuffer_.begin(), symbolBuffer_.end(), preambleBegin);
+      CplxVecIt s = samples_.begin()+i+1-(sLen_+cpLen_);
+      std::copy(s, s+sLen_+cpLen_, preambleBegin);
 
       //Phase of P gives the fractional frequency offset
-      freqOffset = arg(currentP_);
-      freqOffset = -(freqOffset)/(float)IRIS_PI;
+      result.freqOffset = -arg(pSums_[i])/(float)IRIS_PI;
 
       reset();
-      return ++inBegin;
+      return inBegin+(i-hist_)+1;
     }
+
+    carryHistory(n);
+    inBegin += n;
   }
 
   return inBegin;
 }
 
+/** Evaluate the coarse metric for the n samples of the current block.
+ *
+ * P and E are summed over every decimation'th sample of the last
+ * half-symbol and symbol respectively.
+ *
+ * @param n   Number of samples in the block.
+ * @return    Index in the block of the last sample where the coarse
+ *            metric exceeds its threshold, or -1 if there is none.
+ */
+inline int OfdmPreambleDetector::coarseSearch(int n)
+{
+  CplxVecIt x = samples_.begin()+hist_;
+  int half = sLen_/2;
+  int pLen = coarseP_.size();
+  int eLen = coarseE_.size();
+  int candidate = -1;
+  int k = coarsePhase_;
+  for(; k<n; k+=decimation_)
+  {
+    Cplx p = conj(x[k])*x[k-half];
+    float e = norm(x[k]);
+    int pIndex = coarseIndex_ % pLen;
+    coarseSumP_ += p - coarseP_[pIndex];
+    coarseSumE_ += e - coarseE_[coarseIndex_];
+    coarseP_[pIndex] = p;
+    coarseE_[coarseIndex_] = e;
+    if(++coarseIndex_ == eLen)
+      coarseIndex_ = 0;
+
+    // 4|P|^2/E^2 > threshold, as for V
+    if(4*norm(coarseSumP_) > coarseThresh_*coarseSumE_*coarseSumE_)
+      candidate = k;
+  }
+  coarsePhase_ = k-n;
+  return candidate;
+}
+
+/** Clear the running sums and the terms and metrics before first.
+ *
+ * @param first   Index of the first sample to search from.
+ */
+inline void OfdmPreambleDetector::clearFineState(int first)
+{
+  std::fill(pTerms_.begin(), pTerms_.begin()+first, Cplx(0,0));
+  std::fill(eTerms_.begin(), eTerms_.begin()+first, Cplx(0,0));
+  std::fill(v_.begin(), v_.begin()+first, 0);
+  currentP_ = Cplx(0,0);
+  currentE_ = Cplx(0,0);
+  vMovingAve_ = 0;
+  lastVma_ = 0;
+  plateauWidth_ = 0;
+}
+
+/** Compute the metric V for the samples in [first, last).
+ *
+ * The p and e terms and V are independent per sample and are computed
+ * in separate passes over the arrays. Only the running sums P and E
+ * are carried from sample to sample.
+ *
+ * @param first   Index of the first sample.
+ * @param last    Index of one past the last sample.
+ */
+inline void OfdmPreambleDetector::computeMetric(int first, int last)
+{
+  int half = sLen_/2;
+  for(int i=first; i<last; i++)
+  {
+    pTerms_[i] = conj(samples_[i])*samples_[i-half];
+    eTerms_[i] = conj(samples_[i])*samples_[i];
+  }
+
+  for(int i=first; i<last; i++)
+  {
+    currentP_ += (pTerms_[i] - pTerms_[i-half]);
+    currentE_ += (eTerms_[i] - eTerms_[i-sLen_]);
+    pSums_[i] = currentP_;
+    eSums_[i] = currentE_;
+  }
+
+  for(int i=first; i<last; i++)
+  {
+    float magP = fastMag(pSums_[i]);
+    float magE = fastMag(eSums_[i]);
+    float den = magE*magE;
+    v_[i] = (den == 0) ? 0 : ((2*magP)*(2*magP))/den;
+  }
+}
+
+/** Move the last hist_ entries of the arrays to their fronts, as history
+ * for the next block.
+ *
+ * @param n   Number of samples in the block.
+ */
+inline void OfdmPreambleDetector::carryHistory(int n)
+{
+  std::copy(samples_.begin()+n, samples_.begin()+n+hist_, samples_.begin());
+  std::copy(pTerms_.begin()+n, pTerms_.begin()+n+hist_, pTerms_.begin());
+  std::copy(eTerms_.begin()+n, eTerms_.begin()+n+hist_, eTerms_.begin());
+  std::copy(v_.begin()+n, v_.begin()+n+hist_, v_.begin());
+}
+
 } // namespace iris
 
 #endif // MOD_OFDMPREAMBLEDETECTOR_H_
@@ -29,7 +29,9 @@
  * \section DESCRIPTION
  *
  * An OFDM preamble generator. Objects of this class can be used to
- * generate preambles with half-symbol repetitions.
+ * generate preambles with half-symbol repetitions. The preamble sequences,
+ * and the preamble symbol of each set of carrier numbers, are built once
+ * and shared by all generators in a process.
  */
 
 #ifndef MOD_OFDMPREAMBLEGENERATOR_H_
@@ -40,11 +42,13 @@
 #include <algorithm>
 #include <boost/lambda/lambda.hpp>
 #include "fftw3.h"
+#include "math/FftwPlanner.h"
 
 #include "irisapi/Exceptions.h"
 #include "irisapi/TypeInfo.h"
 #include "irisapi/Logging.h"
 #include "utility/RawFileUtility.h"
+#include "utility/SharedTables.h"
 
 namespace iris
 {
@@ -57,11 +61,68 @@ class OfdmPreambleGenerator
   typedef std::vector<Cplx>     CplxVec;
   typedef CplxVec::iterator     CplxVecIt;
 
-  OfdmPreambleGenerator()
+  /// The 802.16 preamble sequences, shared by all generators.
+  struct Sequences
   {
-    createPosPreambleSequence();
-    createNegPreambleSequence();
-  }
+    CplxVec pos;    ///< Sequence for the positive frequency carriers.
+    CplxVec neg;    ///< Sequence for the negative frequency carriers.
+
+    Sequences()
+    {
+      createPosPreambleSequence(pos);
+      createNegPreambleSequence(neg);
+    }
+
+    /// Size of the table contents in bytes.
+    std::size_t bytes() const
+    {
+      return sizeof(Cplx)*(pos.size() + neg.size());
+    }
+  };
+
+  /// Numbers of data, pilot and guard carriers of a preamble.
+  struct Numerology
+  {
+    int numData;
+    int numPilot;
+    int numGuard;
+
+    Numerology(int d, int p, int g)
+      :numData(d), numPilot(p), numGuard(g)
+    {}
+
+    bool operator<(const Numerology& other) const
+    {
+      if(numData != other.numData)
+        return numData < other.numData;
+      if(numPilot != other.numPilot)
+        return numPilot < other.numPilot;
+      return numGuard < other.numGuard;
+    }
+  };
+
+  /// A preamble symbol and its bins, shared by all generators using it.
+  struct Preamble
+  {
+    CplxVec symbol;   ///< The preamble, without a cyclic prefix.
+    CplxVec halfBins; ///< Bins of the first half of the preamble, times 2.
+
+    explicit Preamble(const Numerology& n)
+    {
+      createPreamble(n.numData, n.numPilot, n.numGuard, symbol);
+      createHalfBins(symbol, halfBins);
+    }
+
+    /// Size of the table contents in bytes.
+    std::size_t bytes() const
+    {
+      return sizeof(Cplx)*(symbol.size() + halfBins.size());
+    }
+  };
+
+  OfdmPreambleGenerator()
+    :sequences_(SharedTables::get<Sequences>())
+  {}
 
   /** Generate an OFDM preamble symbol with a half-symbol repetition.
    *
@@ -83,46 +144,120 @@ class OfdmPreambleGenerator
                        CplxVecIt outBegin,
                        CplxVecIt outEnd)
   {
-    using namespace boost::lambda;
-
-    int numActive = numData + numPilot;
     int numBins = numData + numPilot + numGuard + 1;
 
     if(outEnd-outBegin < numBins)
       throw IrisException("Insufficient storage provided for generatePreamble output.");
 
+    // Keep the last preamble, so it is shared while this generator lives
+    preamble_ = SharedTables::get<Preamble>(
+          Numerology(numData, numPilot, numGuard));
+    copy(preamble_->symbol.begin(), preamble_->symbol.end(), outBegin);
+  }
+
+  /** Generate the bins of the first half of an OFDM preamble symbol.
+   *
+   * These are the bins of a half-length fft of the preamble given by
+   * generatePreamble(), scaled by 2 to match the bins of a full symbol.
+   *
+   * @param numData   Number of data carriers (not including pilots).
+   * @param numPilot  Number of pilot carriers.
+   * @param numGuard  Number of guard carriers (not including DC).
+   * @param outBegin  Iterator to first element of output vector.
+   * @param outEnd    Iterator to one past last element of output.
+   */
+  void generatePreambleHalfBins(int numData,
+                                int numPilot,
+                                int numGuard,
+                                CplxVecIt outBegin,
+                                CplxVecIt outEnd)
+  {
+    int numBins = numData + numPilot + numGuard + 1;
+
+    if(outEnd-outBegin < numBins/2)
+      throw IrisException("Insufficient storage provided for generatePreambleHalfBins output.");
+
+    preamble_ = SharedTables::get<Preamble>(
+          Numerology(numData, numPilot, numGuard));
+    copy(preamble_->halfBins.begin(), preamble_->halfBins.end(), outBegin);
+  }
+
+  /// The shared preamble sequences used by this generator.
+  const Sequences& sequences() const { return *sequences_; }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "OfdmPreambleGenerator"; }
+
+
+ private:
+
+  /** Generate the time-domain preamble of a set of carrier numbers.
+   *
+   * @param numData   Number of data carriers (not including pilots).
+   * @param numPilot  Number of pilot carriers.
+   * @param numGuard  Number of guard carriers (not including DC).
+   * @param out       Output for the numBins samples of the preamble.
+   */
+  static void createPreamble(int numData,
+                             int numPilot,
+                             int numGuard,
+                             CplxVec& out)
+  {
+    using namespace boost::lambda;
+
+    int numActive = numData + numPilot;
+    int numBins = numData + numPilot + numGuard + 1;
+    boost::shared_ptr<const Sequences> seq = SharedTables::get<Sequences>();
+
     Cplx* bins = reinterpret_cast<Cplx*>(
           fftwf_malloc(sizeof(fftwf_complex) * numBins));
     fill(&bins[0], &bins[numBins], Cplx(0,0));
 
     for(int i=2; i<=numActive/2; i+=2)
-      bins[i] = posPreambleSequence_[i%100];
+      bins[i] = seq->pos[i%100];
     for(int i=1; i<numActive/2; i+=2)
-      bins[numBins-1-i] = negPreambleSequence_[i%100];
+      bins[numBins-1-i] = seq->neg[i%100];
 
-    fftwf_plan fft = fftwf_plan_dft_1d(numBins,
-                                       (fftwf_complex*)bins,
-                                       (fftwf_complex*)bins,
-                                       FFTW_BACKWARD,
-                                       FFTW_ESTIMATE);
+    fftwf_plan fft = FftwPlanner::planDft1d(numBins,
+                                            (fftwf_complex*)bins,
+                                            (fftwf_complex*)bins,
+                                            FFTW_BACKWARD,
+                                            "estimate");
 
     fftwf_execute(fft);
-    copy(&bins[0], &bins[numBins], outBegin);
+    out.assign(&bins[0], &bins[numBins]);
     float scaleFactor = numActive/2.0;
-    transform(outBegin, outEnd, outBegin, _1/scaleFactor);
+    transform(out.begin(), out.end(), out.begin(), _1/scaleFactor);
 
     fftwf_free(bins);
-    fftwf_destroy_plan(fft);
+    FftwPlanner::destroyPlan(fft);
   }
 
-  /// Convenience function for logging.
-  std::string getName(){ return "OfdmPreambleGenerator"; }
+  /// Transform the first half of a preamble, scaling its bins by 2.
+  static void createHalfBins(const CplxVec& symbol, CplxVec& out)
+  {
+    using namespace boost::lambda;
 
+    int numHalf = symbol.size()/2;
+    Cplx* bins = reinterpret_cast<Cplx*>(
+          fftwf_malloc(sizeof(fftwf_complex) * numHalf));
+    fftwf_plan fft = FftwPlanner::planDft1d(numHalf,
+                                            (fftwf_complex*)bins,
+                                            (fftwf_complex*)bins,
+                                            FFTW_FORWARD,
+                                            "estimate");
 
- private:
+    copy(symbol.begin(), symbol.begin()+numHalf, bins);
+    fftwf_execute(fft);
+    out.assign(&bins[0], &bins[numHalf]);
+    transform(out.begin(), out.end(), out.begin(), 2.0f*_1);
+
+    fftwf_free(bins);
+    FftwPlanner::destroyPlan(fft);
+  }
 
-  /// Static function used to build up posPreambleSequence_ vector.
-  void createPosPreambleSequence()
+  /// Static function used to build up the positive preamble sequence.
+  static void createPosPreambleSequence(CplxVec& seq)
   {
     using namespace boost::lambda;
     typedef Cplx c;
@@ -142,14 +277,12 @@ class OfdmPreambleGenerator
       c( 1, 1),c( 1, 1),c( 1, 1),c(-1,-1),c(-1,-1),c(-1,-1),c(-1,-1),c( 1, 1),c( 1,-1),c( 1,-1)   \
     };
 
-    posPreambleSequence_.assign(begin(posSeq), end(posSeq));
-    transform(posPreambleSequence_.begin(),
-              posPreambleSequence_.end(),
-              posPreambleSequence_.begin(), _1/sqrtf(2.0f));
+    seq.assign(begin(posSeq), end(posSeq));
+    transform(seq.begin(), seq.end(), seq.begin(), _1/sqrtf(2.0f));
   }
 
-  /// Static function used to build up negPreambleSequence_ vector.
-  void createNegPreambleSequence()
+  /// Static function used to build up the negative preamble sequence.
+  static void createNegPreambleSequence(CplxVec& seq)
   {
     using namespace boost::lambda;
     typedef Cplx c;
@@ -169,14 +302,12 @@ class OfdmPreambleGenerator
       c( 1,-1),c( 1,-1),c( 1,-1),c(-1, 1),c( 1,-1),c( 1,-1),c( 1, 1),c(-1,-1),c( 1,-1),c( 1,-1)   \
     };
 
-    negPreambleSequence_.assign(begin(negSeq), end(negSeq));
-    transform(negPreambleSequence_.begin(),
-              negPreambleSequence_.end(),
-              negPreambleSequence_.begin(), _1/sqrtf(2.0f));
+    seq.assign(begin(negSeq), end(negSeq));
+    transform(seq.begin(), seq.end(), seq.begin(), _1/sqrtf(2.0f));
   }
 
-  CplxVec posPreambleSequence_;
-  CplxVec negPreambleSequence_;
+  boost::shared_ptr<const Sequences> sequences_;  ///< The 802.16 sequences.
+  boost::shared_ptr<const Preamble> preamble_;    ///< Last preamble generated.
 
   template <typename T, size_t N>
   static T* begin(T(&arr)[N]) { return &arr[0]; }
@@ -39,11 +39,19 @@
 
 #include <complex>
 #include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IRIS_QAMDEMODULATOR_SSE2
+#endif
 
 #include "irisapi/Exceptions.h"
 #include "irisapi/TypeInfo.h"
-#include "irisapi/Logging.h"
 #include "math/MathDefines.h"
+#include "utility/SharedTables.h"
 
 namespace iris
 {
@@ -52,6 +60,18 @@ namespace iris
  *
  * Objects of this class provide M-ary QAM demodulation. Expects constellations
  * which are Gray coded with average unit energy.
+ *
+ * Hard decisions are returned as packed bytes by demodulate(). Soft
+ * decisions are returned as one log-likelihood ratio (LLR) per bit by
+ * demodulateSoft(), using the max-log approximation. LLRs are positive
+ * for a 0 bit and are written in the same bit order as demodulate().
+ *
+ * BPSK, QPSK and QAM16 symbols are sliced without branches. The decision
+ * bits of each output byte are gathered into a mask of comparisons (with
+ * movemask where SSE2 is available), which indexes a table of output
+ * bytes. QAM64 and QAM256 symbols are sliced with a table lookup per
+ * axis, with the bit layout described in QamModulator. The tables are
+ * built once and shared by all demodulators in a process.
  */
 class QamDemodulator
 {
@@ -60,19 +80,112 @@ class QamDemodulator
   typedef std::complex<float>   Cplx;
   typedef std::vector<Cplx>     CplxVec;
 
-  QamDemodulator()
+  /** Slicer and LLR tables for the axes of a square constellation.
+   *
+   * Level j of an axis is (2j-(numLevels-1))*scale. Each bit splits the
+   * levels of a Gray coded axis into contiguous runs, so the nearest level
+   * with the other value of bit b is the nearest one outside the run of
+   * level j, either below (lower[j*k+b]) or above (upper[j*k+b]) it.
+   */
+  struct SquareAxis
   {
-    createQam16Lut();
-  }
+    int k;                  ///< Bits per axis.
+    int numLevels;          ///< Levels per axis.
+    float scale;            ///< Distance from an axis level to zero.
+    std::vector<float> levels;  ///< Scaled axis levels.
+    std::vector<float> lower;   ///< Nearest lower level with bit b flipped.
+    std::vector<float> upper;   ///< Nearest upper level with bit b flipped.
+    std::vector<float> signs;   ///< +1 if bit b of level j is 1, else -1.
+    Uint8Vec iBits;         ///< Symbol bits of each in-phase level.
+    Uint8Vec qBits;         ///< Symbol bits of each quadrature level.
+
+    /// Size of the table contents in bytes.
+    std::size_t bytes() const
+    {
+      return sizeof(float)*(levels.size() + lower.size() + upper.size()
+                            + signs.size()) + iBits.size() + qBits.size();
+    }
+
+    /// Index of the level nearest to x, without branches.
+    int nearest(float x) const
+    {
+      float j = x/(2*scale) + numLevels*0.5f;
+      return (int)std::max(0.0f, std::min(numLevels-1.0f, j));
+    }
+
+    /// Hard decision of a symbol.
+    uint8_t slice(Cplx x) const
+    {
+      return iBits[nearest(x.real())] | qBits[nearest(x.imag())];
+    }
+
+    /// Max-log LLRs of the 2k bits of a symbol, in symbol bit order.
+    void llrs(Cplx x, float weight, float* out) const
+    {
+      axisLlrs(x.real(), weight, out);
+      axisLlrs(x.imag(), weight, out+1);
+    }
+
+    /// Max-log LLRs of one axis, written to every second output.
+    void axisLlrs(float x, float weight, float* out) const
+    {
+      int j = nearest(x);
+      float d = x-levels[j];
+      float dNear = d*d;
+      const float* lo = &lower[j*k];
+      const float* hi = &upper[j*k];
+      const float* sign = &signs[j*k];
+      for(int b=0; b<k; b++)
+      {
+        float dFar = std::min((x-lo[b])*(x-lo[b]), (x-hi[b])*(x-hi[b]));
+        out[2*b] = sign[b]*(dNear-dFar)*weight;
+      }
+    }
+  };
+
+  /// Slicing tables of all modulation depths, shared by all demodulators.
+  struct Tables
+  {
+    Uint8Vec qam16;             ///< QAM16 symbol bits of each quadrant pair.
+    uint8_t hardBpsk[256];      ///< BPSK output byte of each decision mask.
+    uint8_t hardQpsk[256];      ///< QPSK output byte of each decision mask.
+    uint8_t hardQam16[256];     ///< QAM16 output byte of each decision mask.
+    SquareAxis qam64Axis;
+    SquareAxis qam256Axis;
+
+    Tables()
+    {
+      createQam16Lut(qam16);
+      createHardLuts(*this);
+      createSquareLut(QAM64, qam64Axis);
+      createSquareLut(QAM256, qam256Axis);
+    }
+
+    /// Size of the table contents in bytes.
+    std::size_t bytes() const
+    {
+      return qam16.size() + sizeof(hardBpsk) + sizeof(hardQpsk)
+          + sizeof(hardQam16) + qam64Axis.bytes() + qam256Axis.bytes();
+    }
+  };
+
+  QamDemodulator()
+    :tables_(SharedTables::get<Tables>())
+  {}
 
   /** Demodulate a set of QAM complex<float> symbols to uint8_t bytes.
    * Defaults to BPSK.
    *
+   * Both ranges must be contiguous. With BPSK, QPSK and QAM16 the bits of
+   * a final partial byte are shifted into the existing output byte.
+   *
    * @param inBegin   Iterator to first input QAM symbol.
    * @param inEnd     Iterator to one past last input QAM symbol.
    * @param outBegin  Iterator to first output byte.
    * @param outEnd    Iterator to one past last output byte.
-   * @param M         Modulation depth (1=BPSK, 2=QPSK, 4=QAM16)
+   * @param M         Modulation depth (1=BPSK, 2=QPSK, 4=QAM16,
+   *                  6=QAM64, 8=QAM256)
+   * @return          Iterator to one past the last byte written.
    */
   template <class InputInterator, class OutputIterator>
   OutputIterator demodulate(InputInterator inBegin,
@@ -84,123 +197,461 @@ class QamDemodulator
     // Check for sufficient output size
     if((outEnd-outBegin)*8/M < inEnd-inBegin)
       throw IrisException("Insufficient storage provided for demodulate output.");
+    if(inBegin == inEnd)
+      return outBegin;
 
-    if((outEnd-outBegin)*8/M > inEnd-inBegin)
-      LOG(LWARNING) << "Output size larger than required for demodulate.";
+    const float* x = (const float*)&*inBegin;
+    uint8_t* out = &*outBegin;
+    int num = inEnd-inBegin;
+    switch (M)
+    {
+      case QPSK: //QPSK
+        return outBegin + sliceSigns(x, num, QPSK, tables_->hardQpsk, out);
+      case QAM16: //16 QAM
+        return outBegin + sliceQam16(x, num, out);
+      case QAM64: //64 QAM
+      {
+        //Pack 6-bit symbols into a stream of bytes
+        const SquareAxis& axis = tables_->qam64Axis;
+        unsigned int bits = 0;
+        int numBits = 0;
+        for(; inBegin != inEnd; inBegin++)
+        {
+          bits = (bits << 6) | axis.slice(*inBegin);
+          numBits += 6;
+          if(numBits >= 8)
+          {
+            numBits -= 8;
+            *outBegin++ = (bits >> numBits) & 0xFF;
+          }
+        }
+        if(numBits > 0)
+          *outBegin++ = (bits << (8-numBits)) & 0xFF;
+        return outBegin;
+      }
+      case QAM256: //256 QAM
+      {
+        const SquareAxis& axis = tables_->qam256Axis;
+        for(; inBegin != inEnd; inBegin++)
+          *outBegin++ = axis.slice(*inBegin);
+        return outBegin;
+      }
+      default : //BPSK
+        return outBegin + sliceSigns(x, num, BPSK, tables_->hardBpsk, out);
+    }
+  }
 
-    int count=0;
-    int symIndex,pointsPerQuadrant;
-    Cplx tempV;
-    float biasValues[2]={2.0f/sqrtf(10.0f),0.0f};
+  /** Demodulate a set of QAM complex<float> symbols to float LLRs.
+   *
+   * @param in        Pointer to first input QAM symbol.
+   * @param weights   Reciprocal of the noise variance of each symbol.
+   * @param num       Number of input symbols.
+   * @param out       Output for num*M LLRs.
+   * @param M         Modulation depth (1=BPSK, 2=QPSK, 4=QAM16,
+   *                  6=QAM64, 8=QAM256)
+   */
+  void demodulateSoft(const Cplx* in, const float* weights, int num,
+                      float* out, unsigned int M) const
+  {
+    const float* x = (const float*)in;
+    int i = 0;
 
     switch (M)
     {
-      case QPSK: //QPSK
-        for(;inBegin!=inEnd;inBegin++)
+      case QPSK:
+      {
+        const float c = -2.0f*sqrtf(2.0f);
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+        __m128 cv = _mm_set1_ps(c);
+        for(; i+4<=num; i+=4)
+        {
+          __m128 w = _mm_loadu_ps(weights+i);
+          __m128 wLo = _mm_mul_ps(_mm_unpacklo_ps(w, w), cv);
+          __m128 wHi = _mm_mul_ps(_mm_unpackhi_ps(w, w), cv);
+          _mm_storeu_ps(out+2*i, _mm_mul_ps(_mm_loadu_ps(x+2*i), wLo));
+          _mm_storeu_ps(out+2*i+4, _mm_mul_ps(_mm_loadu_ps(x+2*i+4), wHi));
+        }
+#endif
+        for(; i<num; i++)
         {
-          if(count%4 == 0 && count!=0)
-            outBegin++;
-          //slice to demodulate
-          if((*inBegin).real() > 0)
-            if((*inBegin).imag() > 0)
-              *outBegin = *outBegin<<2 | 0x3;
-            else
-              *outBegin = *outBegin<<2 | 0x2;
-          else
-            if((*inBegin).imag() > 0)
-              *outBegin = *outBegin<<2 | 0x1;
-            else
-              *outBegin = *outBegin<<2 | 0x0;
-          count++;
+          out[2*i] = c*x[2*i]*weights[i];
+          out[2*i+1] = c*x[2*i+1]*weights[i];
         }
         break;
-      case QAM16: //16 QAM
-        for(;inBegin!=inEnd;inBegin++)
+      }
+      case QAM16:
+      {
+        const float d = 1.0f/sqrtf(10.0f);
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+        for(; i+4<=num; i+=4)
         {
-          if(count%2 == 0 && count!=0)
-            outBegin++;
-
-          symIndex = 0;
-          pointsPerQuadrant = 4;
-          tempV = *inBegin;
-          for(int j=0;j<2;j++)
-          {
-            if (tempV.real() > 0)
-            {
-              if (tempV.imag() > 0)
-              {
-                tempV = tempV + Cplx(-biasValues[j],-biasValues[j]);
-              }
-              else
-              {
-                tempV = tempV + Cplx(-biasValues[j],biasValues[j]);
-                symIndex += 3*pointsPerQuadrant;
-              }
-            }
-            else
-            {
-              if (tempV.imag() > 0)
-              {
-                tempV = tempV + Cplx(biasValues[j],-biasValues[j]);
-                symIndex += pointsPerQuadrant;
-              }
-              else
-              {
-                tempV = tempV + Cplx(biasValues[j],biasValues[j]);
-                symIndex += 2*pointsPerQuadrant;
-              }
-            }
-            pointsPerQuadrant = pointsPerQuadrant >> 2;
-          }
-          *outBegin = *outBegin<<4 | Qam16Lut_[symIndex];
-          count++;
+          __m128 w = _mm_loadu_ps(weights+i);
+          qam16Pair(_mm_loadu_ps(x+2*i), _mm_unpacklo_ps(w, w), out+4*i);
+          qam16Pair(_mm_loadu_ps(x+2*i+4), _mm_unpackhi_ps(w, w), out+4*i+8);
+        }
+#endif
+        for(; i<num; i++)
+        {
+          float re = x[2*i], im = x[2*i+1];
+          out[4*i] = qam16Sign(re, d)*weights[i];
+          out[4*i+1] = qam16Sign(im, d)*weights[i];
+          out[4*i+2] = 4*d*(2*d-std::fabs(re))*weights[i];
+          out[4*i+3] = 4*d*(2*d-std::fabs(im))*weights[i];
         }
         break;
-      default : //BPSK
-        for(;inBegin!=inEnd;inBegin++)
+      }
+      case QAM64:
+        for(; i<num; i++)
+          tables_->qam64Axis.llrs(in[i], weights[i], out+i*M);
+        break;
+      case QAM256:
+        for(; i<num; i++)
+          tables_->qam256Axis.llrs(in[i], weights[i], out+i*M);
+        break;
+      default: //BPSK
+      {
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+        __m128 cv = _mm_set1_ps(4.0f);
+        for(; i+4<=num; i+=4)
         {
-          if(count%8 == 0 && count!=0)
-            outBegin++;
-          (*inBegin).real() > 0 ? *outBegin = *outBegin<<1 | 0: *outBegin = *outBegin<<1 | 1;
-          count++;
+          __m128 re = _mm_shuffle_ps(_mm_loadu_ps(x+2*i), _mm_loadu_ps(x+2*i+4),
+                                     _MM_SHUFFLE(2,0,2,0));
+          __m128 w = _mm_mul_ps(_mm_loadu_ps(weights+i), cv);
+          _mm_storeu_ps(out+i, _mm_mul_ps(re, w));
         }
+#endif
+        // Advance pointers rather than index x[2*i], which GCC warns may
+        // overflow when num is known at the call site
+        const float* re = x+2*i;
+        const float* w = weights+i;
+        for(float* o = out+i; o != out+num; o++, re+=2, w++)
+          *o = 4.0f*(*re)*(*w);
         break;
+      }
     }
+  }
 
-    return outBegin;
+  /** Demodulate a set of QAM complex<float> symbols to saturated int8 LLRs.
+   *
+   * @param in        Pointer to first input QAM symbol.
+   * @param weights   Reciprocal of the noise variance of each symbol.
+   * @param num       Number of input symbols.
+   * @param out       Output for num*M LLRs.
+   * @param M         Modulation depth (1=BPSK, 2=QPSK, 4=QAM16,
+   *                  6=QAM64, 8=QAM256)
+   * @param scale     LLRs are multiplied by scale, rounded and saturated
+   *                  to [-127,127].
+   */
+  void demodulateSoft(const Cplx* in, const float* weights, int num,
+                      int8_t* out, unsigned int M, float scale) const
+  {
+    // Demodulate in blocks small enough to stay in the L1 cache
+    const int blockLen = 64;
+    float llrs[blockLen*QAM256];
+    for(int i=0; i<num; i+=blockLen)
+    {
+      int len = std::min(blockLen, num-i);
+      demodulateSoft(in+i, weights+i, len, llrs, M);
+      saturate(llrs, len*M, out+i*M, scale);
+    }
   }
 
+  /// The shared tables used by this demodulator.
+  const Tables& tables() const { return *tables_; }
+
   /// Convenience function for logging.
   std::string getName(){ return "QamDemodulator"; }
 
 
  private:
 
-  void createQam16Lut()
+  /// Create the axis tables of a square constellation of M bits per symbol.
+  static void createSquareLut(int M, SquareAxis& axis)
+  {
+    int k = M/2;
+    int numLevels = 1 << k;
+    axis.k = k;
+    axis.numLevels = numLevels;
+    axis.scale = 1.0f/sqrtf(2.0f*(numLevels*numLevels-1)/3.0f);
+    axis.levels.resize(numLevels);
+    axis.lower.resize(numLevels*k);
+    axis.upper.resize(numLevels*k);
+    axis.signs.resize(numLevels*k);
+    axis.iBits.resize(numLevels);
+    axis.qBits.resize(numLevels);
+
+    // Axis bits of each level: a sign bit then the Gray coded magnitude
+    std::vector<int> codes(numLevels);
+    for(int j=0; j<numLevels; j++)
+    {
+      int level = 2*j-(numLevels-1);
+      int mag = (std::abs(level)-1)/2;
+      codes[j] = ((level > 0) << (k-1)) | (mag ^ (mag >> 1));
+      axis.levels[j] = level*axis.scale;
+      axis.iBits[j] = axis.qBits[j] = 0;
+      for(int b=0; b<k; b++)
+      {
+        axis.iBits[j] |= ((codes[j] >> b) & 1) << (2*b+1);
+        axis.qBits[j] |= ((codes[j] >> b) & 1) << (2*b);
+      }
+    }
+
+    const float far = 1e10f;
+    for(int j=0; j<numLevels; j++)
+    {
+      for(int b=0; b<k; b++)
+      {
+        int bit = (codes[j] >> (k-1-b)) & 1;
+        int lo = j, hi = j;
+        while(lo >= 0 && ((codes[lo] >> (k-1-b)) & 1) == bit)
+          lo--;
+        while(hi < numLevels && ((codes[hi] >> (k-1-b)) & 1) == bit)
+          hi++;
+        axis.lower[j*k+b] = (lo >= 0) ? axis.levels[lo] : -far;
+        axis.upper[j*k+b] = (hi < numLevels) ? axis.levels[hi] : far;
+        axis.signs[j*k+b] = bit ? 1.0f : -1.0f;
+      }
+    }
+  }
+
+  /// Max-log LLR of a 16-QAM sign bit with amplitude x.
+  static float qam16Sign(float x, float d)
+  {
+    float clipped = std::max(-2*d, std::min(2*d, x));
+    return -4*d*(2*x - clipped);
+  }
+
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+  /// LLRs of two 16-QAM symbols (re0,im0,re1,im1) with weights (w0,w0,w1,w1).
+  static void qam16Pair(__m128 x, __m128 w, float* out)
+  {
+    const float d = 1.0f/sqrtf(10.0f);
+    __m128 d2 = _mm_set1_ps(2*d);
+    __m128 d4 = _mm_set1_ps(4*d);
+    __m128 clipped = _mm_max_ps(_mm_sub_ps(_mm_setzero_ps(), d2),
+                                _mm_min_ps(d2, x));
+    __m128 sign = _mm_mul_ps(_mm_sub_ps(clipped, _mm_add_ps(x, x)), d4);
+    __m128 absX = _mm_andnot_ps(_mm_set1_ps(-0.0f), x);
+    __m128 mag = _mm_mul_ps(_mm_sub_ps(d2, absX), d4);
+    sign = _mm_mul_ps(sign, w);
+    mag = _mm_mul_ps(mag, w);
+    _mm_storeu_ps(out, _mm_movelh_ps(sign, mag));
+    _mm_storeu_ps(out+4, _mm_movehl_ps(mag, sign));
+  }
+#endif
+
+  /// Scale, round and saturate float LLRs to int8.
+  static void saturate(const float* in, int num, int8_t* out, float scale)
+  {
+    int i = 0;
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+    __m128 s = _mm_set1_ps(scale);
+    __m128 hi = _mm_set1_ps(127.0f);
+    __m128 lo = _mm_set1_ps(-127.0f);
+    for(; i+16<=num; i+=16)
+    {
+      __m128i a = _mm_cvtps_epi32(_mm_max_ps(lo, _mm_min_ps(hi,
+                      _mm_mul_ps(_mm_loadu_ps(in+i), s))));
+      __m128i b = _mm_cvtps_epi32(_mm_max_ps(lo, _mm_min_ps(hi,
+                      _mm_mul_ps(_mm_loadu_ps(in+i+4), s))));
+      __m128i c = _mm_cvtps_epi32(_mm_max_ps(lo, _mm_min_ps(hi,
+                      _mm_mul_ps(_mm_loadu_ps(in+i+8), s))));
+      __m128i d = _mm_cvtps_epi32(_mm_max_ps(lo, _mm_min_ps(hi,
+                      _mm_mul_ps(_mm_loadu_ps(in+i+12), s))));
+      _mm_storeu_si128((__m128i*)(out+i),
+                       _mm_packs_epi16(_mm_packs_epi32(a, b),
+                                       _mm_packs_epi32(c, d)));
+    }
+#endif
+    for(; i<num; i++)
+    {
+      float v = std::max(-127.0f, std::min(127.0f, in[i]*scale));
+      out[i] = (int8_t)(v < 0 ? v-0.5f : v+0.5f);
+    }
+  }
+
+  /** Slice BPSK or QPSK symbols on the signs of their components.
+   *
+   * The comparisons for each output byte form a mask, with bit j set if
+   * float j of the byte's symbols is positive (only real parts with
+   * BPSK), and the mask is looked up in lut.
+   *
+   * @param x     Interleaved real and imaginary parts of the symbols.
+   * @param num   Number of symbols.
+   * @param M     Modulation depth (BPSK or QPSK).
+   * @param lut   Output byte of each mask.
+   * @param out   Output bytes.
+   * @return      Number of bytes written.
+   */
+  static int sliceSigns(const float* x, int num, unsigned int M,
+                        const uint8_t* lut, uint8_t* out)
+  {
+    int perByte = 8/M;
+    int numBytes = num/perByte;
+    int i = 0;
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+    __m128 zero = _mm_setzero_ps();
+    if(M == BPSK)
+    {
+      for(; i<numBytes; i++, x+=16)
+      {
+        __m128 a = _mm_shuffle_ps(_mm_loadu_ps(x), _mm_loadu_ps(x+4),
+                                  _MM_SHUFFLE(2,0,2,0));
+        __m128 b = _mm_shuffle_ps(_mm_loadu_ps(x+8), _mm_loadu_ps(x+12),
+                                  _MM_SHUFFLE(2,0,2,0));
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(a, zero)) |
+                   _mm_movemask_ps(_mm_cmpgt_ps(b, zero)) << 4;
+        out[i] = lut[mask];
+      }
+    }
+    else
+    {
+      for(; i<numBytes; i++, x+=8)
+      {
+        int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(x), zero)) |
+                   _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(x+4), zero)) << 4;
+        out[i] = lut[mask];
+      }
+    }
+#endif
+    int step = 2/M;   // Floats per decision
+    for(; i<numBytes; i++, x+=16/M)
+    {
+      int mask = 0;
+      for(int j=0; j<8; j++)
+        mask |= (x[j*step] > 0) << j;
+      out[i] = lut[mask];
+    }
+
+    // Shift the bits of a final partial byte into the output
+    int remaining = num-numBytes*perByte;
+    if(remaining > 0)
+    {
+      int mask = 0;
+      for(size_t j=0; j<remaining*M; j++)
+        mask |= (x[j*step] > 0) << j;
+      uint8_t bits = lut[mask] >> (8-remaining*M);
+      out[numBytes] = (out[numBytes] << (remaining*M)) | bits;
+      numBytes++;
+    }
+    return numBytes;
+  }
+
+  /** Slice QAM16 symbols.
+   *
+   * Each component is sliced on its sign, moved towards the centre of
+   * its quadrant and sliced on its sign again. The two masks of the
+   * decisions for a pair of symbols index a table of output bytes.
+   *
+   * @param x     Interleaved real and imaginary parts of the symbols.
+   * @param num   Number of symbols.
+   * @param out   Output bytes.
+   * @return      Number of bytes written.
+   */
+  int sliceQam16(const float* x, int num, uint8_t* out) const
   {
     using namespace std;
-    Qam16Lut_.push_back(15);
-    Qam16Lut_.push_back(13);
-    Qam16Lut_.push_back(12);
-    Qam16Lut_.push_back(14);
-
-    Qam16Lut_.push_back(5);
-    Qam16Lut_.push_back(7);
-    Qam16Lut_.push_back(6);
-    Qam16Lut_.push_back(4);
-
-    Qam16Lut_.push_back(0);
-    Qam16Lut_.push_back(2);
-    Qam16Lut_.push_back(3);
-    Qam16Lut_.push_back(1);
-
-    Qam16Lut_.push_back(10);
-    Qam16Lut_.push_back(8);
-    Qam16Lut_.push_back(9);
-    Qam16Lut_.push_back(11);
+    const float bias = 2.0f/sqrtf(10.0f);
+    const uint8_t* lut = tables_->hardQam16;
+    int numBytes = num/2;
+    int i = 0;
+#ifdef IRIS_QAMDEMODULATOR_SSE2
+    __m128 zero = _mm_setzero_ps();
+    __m128 up = _mm_set1_ps(bias);
+    __m128 down = _mm_set1_ps(-bias);
+    for(; i<numBytes; i++, x+=4)
+    {
+      __m128 v = _mm_loadu_ps(x);
+      __m128 gt = _mm_cmpgt_ps(v, zero);
+      __m128 shift = _mm_or_ps(_mm_and_ps(gt, down), _mm_andnot_ps(gt, up));
+      __m128 gt2 = _mm_cmpgt_ps(_mm_add_ps(v, shift), zero);
+      out[i] = lut[_mm_movemask_ps(gt) | _mm_movemask_ps(gt2) << 4];
+    }
+#endif
+    for(; i<numBytes; i++, x+=4)
+      out[i] = lut[qam16Mask(x, 4, bias)];
+
+    // Shift the bits of a final partial byte into the output
+    if(num%2)
+    {
+      uint8_t bits = lut[qam16Mask(x, 2, bias)] >> 4;
+      out[numBytes] = (out[numBytes] << 4) | bits;
+      numBytes++;
+    }
+    return numBytes;
+  }
+
+  /// Mask of the two QAM16 slicing stages for n floats (as in sliceQam16).
+  static int qam16Mask(const float* x, int n, float bias)
+  {
+    int mask = 0;
+    for(int j=0; j<n; j++)
+    {
+      bool gt = x[j] > 0;
+      float shifted = x[j] + (gt ? -bias : bias);
+      mask |= gt << j | (shifted > 0) << (j+4);
+    }
+    return mask;
+  }
+
+  /** Create the output byte tables of the decision masks.
+   *
+   * Bit j of a BPSK or QPSK mask is set if float j of the byte's symbols
+   * is positive. A set bit gives a 0 bit with BPSK and a 1 bit with QPSK,
+   * with the first decision in the most significant bit of the byte.
+   *
+   * The low nibble of a QAM16 mask holds the first stage decisions for
+   * the components of two symbols and the high nibble the second stage
+   * decisions. The quadrants found by each stage index qam16.
+   */
+  static void createHardLuts(Tables& t)
+  {
+    int quadrant[4] = {2, 3, 1, 0};   // Index by (re > 0) | (im > 0) << 1
+    for(int mask=0; mask<256; mask++)
+    {
+      uint8_t reversed = 0;
+      for(int j=0; j<8; j++)
+        reversed |= ((mask >> j) & 1) << (7-j);
+      t.hardBpsk[mask] = ~reversed;
+      t.hardQpsk[mask] = reversed;
+
+      uint8_t byte = 0;
+      for(int s=0; s<2; s++)
+      {
+        int first = (mask >> (2*s)) & 3;
+        int second = (mask >> (2*s+4)) & 3;
+        int symIndex = quadrant[first]*4 + quadrant[second];
+        byte = (byte << 4) | t.qam16[symIndex];
+      }
+      t.hardQam16[mask] = byte;
+    }
+  }
+
+  static void createQam16Lut(Uint8Vec& lut)
+  {
+    using namespace std;
+    lut.push_back(15);
+    lut.push_back(13);
+    lut.push_back(12);
+    lut.push_back(14);
+
+    lut.push_back(5);
+    lut.push_back(7);
+    lut.push_back(6);
+    lut.push_back(4);
+
+    lut.push_back(0);
+    lut.push_back(2);
+    lut.push_back(3);
+    lut.push_back(1);
+
+    lut.push_back(10);
+    lut.push_back(8);
+    lut.push_back(9);
+    lut.push_back(11);
   }
 
-  Uint8Vec Qam16Lut_;
+  boost::shared_ptr<const Tables> tables_;
 };
 
 } // namespace iris
@@ -40,11 +40,13 @@
 #include <complex>
 #include <vector>
 #include <cmath>
+#include <iterator>
 
 #include "irisapi/Exceptions.h"
 #include "irisapi/TypeInfo.h"
 #include "irisapi/Logging.h"
 #include "math/MathDefines.h"
+#include "utility/SharedTables.h"
 
 namespace iris
 {
@@ -53,6 +55,14 @@ namespace iris
  *
  * Objects of this class provide M-ary QAM modulation. Constellations
  * are Gray coded with average unit energy.
+ *
+ * Bits of a symbol alternate between the in-phase and quadrature axes,
+ * starting with the sign of each axis. The remaining bits of each axis
+ * Gray code the magnitude of its level, smallest first.
+ *
+ * Except with QAM64, each input byte is looked up in a 256-entry table
+ * holding the 8/M symbols it modulates to. The tables are built once
+ * and shared by all modulators in a process.
  */
 class QamModulator
 {
@@ -60,12 +70,65 @@ class QamModulator
   typedef std::complex<float>   Cplx;
   typedef std::vector<Cplx>     CplxVec;
 
-  QamModulator()
+  /** Writes through an index iterator, e.g. to map symbols onto the
+   * data carriers of an fft input buffer.
+   */
+  template <class BinIterator, class IndexIterator>
+  class MappedIterator
   {
-    createBpskLut();
-    createQpskLut();
-    createQam16Lut();
-  }
+   public:
+    MappedIterator(BinIterator bins, IndexIterator index)
+      :bins_(bins), index_(index)
+    {}
+    typename std::iterator_traits<BinIterator>::reference operator*() const
+    { return bins_[*index_]; }
+    MappedIterator& operator++() { ++index_; return *this; }
+    MappedIterator operator++(int)
+    { MappedIterator old(*this); ++index_; return old; }
+    std::ptrdiff_t operator-(const MappedIterator& other) const
+    { return index_-other.index_; }
+    IndexIterator index() const { return index_; }
+   private:
+    BinIterator bins_;
+    IndexIterator index_;
+  };
+
+  /// Symbol tables of all modulation depths, shared by all modulators.
+  struct Tables
+  {
+    CplxVec bpsk;
+    CplxVec qpsk;
+    CplxVec qam16;
+    CplxVec qam64;
+    CplxVec qam256;
+    CplxVec bpskBytes;    ///< 8 BPSK symbols per byte.
+    CplxVec qpskBytes;    ///< 4 QPSK symbols per byte.
+    CplxVec qam16Bytes;   ///< 2 QAM16 symbols per byte.
+
+    Tables()
+    {
+      createBpskLut(bpsk);
+      createQpskLut(qpsk);
+      createQam16Lut(qam16);
+      createSquareLut(QAM64, qam64);
+      createSquareLut(QAM256, qam256);
+      createByteLut(BPSK, bpsk, bpskBytes);
+      createByteLut(QPSK, qpsk, qpskBytes);
+      createByteLut(QAM16, qam16, qam16Bytes);
+    }
+
+    /// Size of the table contents in bytes.
+    std::size_t bytes() const
+    {
+      return sizeof(Cplx)*(bpsk.size() + qpsk.size() + qam16.size()
+                           + qam64.size() + qam256.size() + bpskBytes.size()
+                           + qpskBytes.size() + qam16Bytes.size());
+    }
+  };
+
+  QamModulator()
+    :tables_(SharedTables::get<Tables>())
+  {}
 
   /** Modulate a sequence of uint8_t bytes to QAM complex<float>
    * symbols. Defaults to BPSK.
@@ -74,8 +137,11 @@ class QamModulator
    * @param inEnd     Iterator to one past last input byte.
    * @param outBegin  Iterator to first output QAM symbol.
    * @param outEnd    Iterator to one past last output QAM symbol.
-   * @param M         Modulation depth (1=BPSK, 2=QPSK, 4=QAM16)
+   * @param M         Modulation depth (1=BPSK, 2=QPSK, 4=QAM16,
+   *                  6=QAM64, 8=QAM256)
    * @return          Iterator to end of written range
+   *
+   * With QAM64 a final partial symbol is padded with zero bits.
    */
   template <class InputInterator, class OutputIterator>
   OutputIterator modulate(InputInterator inBegin,
@@ -83,89 +149,212 @@ class QamModulator
                           OutputIterator outBegin,
                           OutputIterator outEnd,
                           unsigned int M)
+  {
+    switch (M)
+    {
+      case QPSK:
+        return modulate<QPSK>(inBegin, inEnd, outBegin, outEnd);
+      case QAM16:
+        return modulate<QAM16>(inBegin, inEnd, outBegin, outEnd);
+      case QAM64:
+        return modulate<QAM64>(inBegin, inEnd, outBegin, outEnd);
+      case QAM256:
+        return modulate<QAM256>(inBegin, inEnd, outBegin, outEnd);
+      default:
+        return modulate<BPSK>(inBegin, inEnd, outBegin, outEnd);
+    }
+  }
+
+  /** Modulate a sequence of uint8_t bytes with a modulation depth
+   * chosen at compile time.
+   *
+   * @param inBegin   Iterator to first input byte.
+   * @param inEnd     Iterator to one past last input byte.
+   * @param outBegin  Iterator to first output QAM symbol.
+   * @param outEnd    Iterator to one past last output QAM symbol.
+   * @return          Iterator to end of written range
+   */
+  template <unsigned int M, class InputInterator, class OutputIterator>
+  OutputIterator modulate(InputInterator inBegin,
+                          InputInterator inEnd,
+                          OutputIterator outBegin,
+                          OutputIterator outEnd)
   {
     // Check for sufficient output size
-    if(outEnd-outBegin < (inEnd-inBegin)*8/M)
+    if(outEnd-outBegin < ((inEnd-inBegin)*8+M-1)/M)
       throw IrisException("Insufficient storage provided for modulate output.");
 
-    switch (M)
+    if(M == QAM64)
     {
-      case QPSK: //QPSK
-        //Convert bytes into bit-sequences and use LUT
-        for(; inBegin != inEnd; inBegin++)
-        {
-          for(int j = 3; j>=0; j--)
-            *outBegin++ = QpskLut_[(int)((*inBegin >> (j*2)) & 0x3)];
-        }
-        break;
-      case QAM16: //16 QAM
-        //Convert bytes into bit-sequences and use LUT
-        for(; inBegin != inEnd; inBegin++)
-        {
-          for (int j = 1; j>=0; j--)
-            *outBegin++ = Qam16Lut_[(int)((*inBegin >> (j*4)) & 0xF)];
-        }
-        break;
-      default : //BPSK
-        //Convert bytes into bit-sequences and use LUT
-        for(; inBegin != inEnd; inBegin++){
-          for (int j = 7; j>=0; j--)
-            *outBegin++ = BpskLut_[(int)((*inBegin >> j) & 0x1)];
-        }
-        break;
+      //Take 6-bit symbols from a stream of bits
+      const Cplx* lut = &tables_->qam64[0];
+      unsigned int bits = 0;
+      int numBits = 0;
+      for(; inBegin != inEnd; inBegin++)
+      {
+        bits = (bits << 8) | *inBegin;
+        numBits += 8;
+        for(; numBits >= 6; numBits -= 6)
+          *outBegin++ = lut[(bits >> (numBits-6)) & 0x3F];
+      }
+      if(numBits > 0)
+        *outBegin++ = lut[(bits << (6-numBits)) & 0x3F];
+      return outBegin;
     }
 
+    //Copy the symbols of each byte from its table entry
+    const int symbolsPerByte = (M == QAM64) ? 1 : 8/M;
+    const Cplx* lut = &byteLut(M)[0];
+    for(; inBegin != inEnd; inBegin++)
+    {
+      const Cplx* symbols = lut + (int)*inBegin*symbolsPerByte;
+      for(int j=0; j<symbolsPerByte; j++)
+        *outBegin++ = symbols[j];
+    }
     return outBegin;
   }
 
+  /** Modulate a sequence of uint8_t bytes straight into the bins given
+   * by a range of indices, e.g. the data carriers of an fft input buffer.
+   *
+   * @param inBegin     Iterator to first input byte.
+   * @param inEnd       Iterator to one past last input byte.
+   * @param bins        Iterator to first bin.
+   * @param indexBegin  Iterator to index of the bin of the first symbol.
+   * @param indexEnd    Iterator to one past the last index.
+   * @param M           Modulation depth (as for modulate()).
+   * @return            Iterator to one past the index of the last symbol.
+   */
+  template <class InputInterator, class BinIterator, class IndexIterator>
+  IndexIterator modulateMapped(InputInterator inBegin,
+                               InputInterator inEnd,
+                               BinIterator bins,
+                               IndexIterator indexBegin,
+                               IndexIterator indexEnd,
+                               unsigned int M)
+  {
+    typedef MappedIterator<BinIterator, IndexIterator> Mapped;
+    return modulate(inBegin, inEnd, Mapped(bins, indexBegin),
+                    Mapped(bins, indexEnd), M).index();
+  }
+
+  /// The shared tables used by this modulator.
+  const Tables& tables() const { return *tables_; }
+
   /// Convenience function for logging.
   std::string getName(){ return "QamModulator"; }
 
  private:
 
-  void createBpskLut()
+  static void createBpskLut(CplxVec& lut)
   {
     using namespace std;
-    BpskLut_.push_back(Cplx(1,0));
-    BpskLut_.push_back(Cplx(-1,0));
+    lut.push_back(Cplx(1,0));
+    lut.push_back(Cplx(-1,0));
   }
 
-  void createQpskLut()
+  static void createQpskLut(CplxVec& lut)
   {
     using namespace std;
-    QpskLut_.push_back(Cplx(-1.0f/sqrtf(2.0f),-1.0f/sqrtf(2.0f)));
-    QpskLut_.push_back(Cplx(-1.0f/sqrtf(2.0f), 1.0f/sqrtf(2.0f)));
-    QpskLut_.push_back(Cplx( 1.0f/sqrtf(2.0f),-1.0f/sqrtf(2.0f)));
-    QpskLut_.push_back(Cplx( 1.0f/sqrtf(2.0f), 1.0f/sqrtf(2.0f)));
+    lut.push_back(Cplx(-1.0f/sqrtf(2.0f),-1.0f/sqrtf(2.0f)));
+    lut.push_back(Cplx(-1.0f/sqrtf(2.0f), 1.0f/sqrtf(2.0f)));
+    lut.push_back(Cplx( 1.0f/sqrtf(2.0f),-1.0f/sqrtf(2.0f)));
+    lut.push_back(Cplx( 1.0f/sqrtf(2.0f), 1.0f/sqrtf(2.0f)));
   }
 
-  void createQam16Lut()
+  static void createQam16Lut(CplxVec& lut)
+  {
+    using namespace std;
+    lut.push_back(Cplx(-1.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx(-1.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx(-3.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx(-3.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
+
+    lut.push_back(Cplx(-1.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx(-1.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx(-3.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx(-3.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
+
+    lut.push_back(Cplx( 1.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx( 1.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx( 3.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx( 3.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
+
+    lut.push_back(Cplx( 1.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx( 1.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx( 3.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
+    lut.push_back(Cplx( 3.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
+  }
+
+  /** Create the lookup table of a square Gray coded constellation.
+   *
+   * Each axis has levels +-1, +-3, ... scaled to unit average energy.
+   *
+   * @param M     Bits per symbol (even).
+   * @param lut   Table of the 2^M symbols, indexed by their bits.
+   */
+  static void createSquareLut(int M, CplxVec& lut)
   {
     using namespace std;
-    Qam16Lut_.push_back(Cplx(-1.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx(-1.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx(-3.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx(-3.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
-
-    Qam16Lut_.push_back(Cplx(-1.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx(-1.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx(-3.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx(-3.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
-
-    Qam16Lut_.push_back(Cplx( 1.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx( 1.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx( 3.0f/sqrtf(10.0f),-1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx( 3.0f/sqrtf(10.0f),-3.0f/sqrtf(10.0f)));
-
-    Qam16Lut_.push_back(Cplx( 1.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx( 1.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx( 3.0f/sqrtf(10.0f), 1.0f/sqrtf(10.0f)));
-    Qam16Lut_.push_back(Cplx( 3.0f/sqrtf(10.0f), 3.0f/sqrtf(10.0f)));
+    int k = M/2;
+    int numLevels = 1 << k;
+    float scale = 1.0f/sqrtf(2.0f*(numLevels*numLevels-1)/3.0f);
+    lut.resize(1 << M);
+    for(int p=0; p<(int)lut.size(); p++)
+    {
+      // Separate the interleaved axis bits, most significant first
+      int iBits = 0, qBits = 0;
+      for(int b=k-1; b>=0; b--)
+      {
+        iBits = (iBits << 1) | ((p >> (2*b+1)) & 1);
+        qBits = (qBits << 1) | ((p >> (2*b)) & 1);
+      }
+      lut[p] = Cplx(axisLevel(iBits, k)*scale, axisLevel(qBits, k)*scale);
+    }
+  }
+
+  /** Create the byte-indexed table of a modulation which packs whole
+   * symbols into each byte.
+   *
+   * @param M         Bits per symbol (1, 2, 4 or 8).
+   * @param lut       Table of the 2^M symbols, indexed by their bits.
+   * @param byteLut   Table of the 8/M symbols of each byte, first
+   *                  symbol from the most significant bits.
+   */
+  static void createByteLut(int M, const CplxVec& lut, CplxVec& byteLut)
+  {
+    int symbolsPerByte = 8/M;
+    byteLut.resize(256*symbolsPerByte);
+    for(int b=0; b<256; b++)
+      for(int j=0; j<symbolsPerByte; j++)
+        byteLut[b*symbolsPerByte+j] =
+            lut[(b >> (8-M*(j+1))) & ((1 << M)-1)];
+  }
+
+  /// The byte-indexed table of modulation depth M.
+  const CplxVec& byteLut(unsigned int M) const
+  {
+    switch (M)
+    {
+      case QPSK:   return tables_->qpskBytes;
+      case QAM16:  return tables_->qam16Bytes;
+      case QAM256: return tables_->qam256;
+      default:     return tables_->bpskBytes;
+    }
+  }
+
+  /// Unscaled level of k axis bits: a sign bit then a Gray coded magnitude.
+  static float axisLevel(int bits, int k)
+  {
+    int gray = bits & ((1 << (k-1))-1);
+    int mag = 0;
+    for(; gray; gray >>= 1)
+      mag ^= gray;
+    float level = 2*mag+1;
+    return ((bits >> (k-1)) & 1) ? level : -level;
   }
 
-  CplxVec BpskLut_;
-  CplxVec QpskLut_;
-  CplxVec Qam16Lut_;
+  boost::shared_ptr<const Tables> tables_;
 };
 
 } // namespace iris
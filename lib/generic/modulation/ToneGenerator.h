@@ -35,32 +35,23 @@
 #define MOD_TONEGENERATOR_H_
 
 #include <complex>
-#include <vector>
 
 #include "irisapi/TypeInfo.h"
-#include "irisapi/Logging.h"
-#include "math/MathDefines.h"
+#include "modulation/Nco.h"
 
 namespace iris
 {
 
-/// Generate tones with a given frequency
+/** Generate tones with a given frequency.
+ *
+ * Each tone starts at zero phase. Use Nco directly for tones which carry
+ * on from one call to the next.
+ */
 class ToneGenerator
 {
  public:
-  typedef std::vector<float>      FloatVec;
   typedef std::complex<float>     Cplx;
 
-  ToneGenerator()
-  {
-    double angle;
-    for(int i=0; i<65536; i++)
-    {
-      angle = (2.0 * IRIS_PI * (double)i) / (double)65536.0;
-      lookup_.push_back((float)cos(angle));
-    }
-  }
-
   /** Generate a complex tone with a given frequency
    *
    * @param outBegin    Iterator to first element in output container.
@@ -70,25 +61,16 @@ class ToneGenerator
   template <class Iterator>
   void generate(Iterator outBegin, Iterator outEnd, float frequency)
   {
-    int neg = 1;
-    frequency >= 0 ? neg = 1 : neg = -1;
-    uint16_t delta = (uint16_t)abs(65536.0 * frequency);
-    uint16_t deltaAcc = 0;
-    uint16_t deltaAccSin = (65536/4 * 3);
-
-    for(; outBegin!=outEnd; outBegin++)
-    {
-      *outBegin = Cplx(lookup_[deltaAcc], neg*lookup_[deltaAccSin]);
-      deltaAcc += delta;
-      deltaAccSin += delta;
-    }
+    nco_.setFrequency(frequency);
+    nco_.setPhase(0);
+    nco_.generate(outBegin, outEnd);
   }
 
   /// Convenience function for logging.
   std::string getName(){ return "ToneGenerator"; }
 
  private:
-  FloatVec lookup_;  ///< An oversampled cosine
+  Nco nco_;   ///< The oscillator used to generate each tone.
 };
 
 } // namespace iris
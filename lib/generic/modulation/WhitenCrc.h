@@ -0,0 +1,110 @@
+/**
+ * \file lib/generic/modulation/WhitenCrc.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Whitens data and generates its CRC together, a block at a time, so that
+ * the data is only brought into the cache once.
+ */
+
+#ifndef MOD_WHITENCRC_H_
+#define MOD_WHITENCRC_H_
+
+#include <algorithm>
+#include "irisapi/TypeInfo.h"
+#include "modulation/Crc.h"
+#include "modulation/Whitener.h"
+
+namespace iris
+{
+
+/** Whitens data and generates a 32-bit CRC for it in a single pass.
+ *
+ * The CRC is always that of the unwhitened data: the input when
+ * transmitting and the output when receiving. The output may be the input,
+ * to whiten in place.
+ */
+class WhitenCrc
+{
+public:
+  /** Generate the crc of some data, then whiten it (for transmission).
+   *
+   * @param inBegin Pointer to first data element.
+   * @param inEnd   Pointer to one past last data element.
+   * @param out     Pointer to first whitened output element.
+   * @return        The crc of the input data.
+   */
+  static uint32_t crcThenWhiten(const uint8_t* inBegin, const uint8_t* inEnd,
+                                uint8_t* out)
+  {
+    uint32_t crc = 0;
+    for(int count=0; inBegin != inEnd; count += blockLength)
+    {
+      const uint8_t* blockEnd = inBegin + std::min<ptrdiff_t>(inEnd-inBegin,
+                                                              blockLength);
+      crc = Crc::update(crc, inBegin, blockEnd);
+      Whitener::whiten(inBegin, blockEnd, out, count);
+      out += blockEnd-inBegin;
+      inBegin = blockEnd;
+    }
+    return crc;
+  }
+
+  /** Whiten (dewhiten) some data, then generate its crc (for reception).
+   *
+   * @param inBegin Pointer to first data element.
+   * @param inEnd   Pointer to one past last data element.
+   * @param out     Pointer to first dewhitened output element.
+   * @return        The crc of the output data.
+   */
+  static uint32_t whitenThenCrc(const uint8_t* inBegin, const uint8_t* inEnd,
+                                uint8_t* out)
+  {
+    uint32_t crc = 0;
+    for(int count=0; inBegin != inEnd; count += blockLength)
+    {
+      const uint8_t* blockEnd = inBegin + std::min<ptrdiff_t>(inEnd-inBegin,
+                                                              blockLength);
+      Whitener::whiten(inBegin, blockEnd, out, count);
+      crc = Crc::update(crc, out, out+(blockEnd-inBegin));
+      out += blockEnd-inBegin;
+      inBegin = blockEnd;
+    }
+    return crc;
+  }
+
+  /// Bytes whitened and checked at a time, small enough to stay in cache.
+  static const int blockLength = 4096;
+
+private:
+  WhitenCrc(){}; ///< Disable constructor by making it private
+};
+
+} // namespace iris
+
+#endif // MOD_WHITENCRC_H_
@@ -34,6 +34,9 @@
 #ifndef MOD_WHITENER_H_
 #define MOD_WHITENER_H_
 
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
 #include <vector>
 #include "irisapi/TypeInfo.h"
 
@@ -45,7 +48,7 @@ namespace whitenerdetail
 {
 
 /// The code used to whiten incoming data
-uint8_t whitenCode[4096] = {
+static const uint8_t whitenCode[4096] = {
 	255,  63,   0,  16,   0,  12,   0,   5, 192,   3,  16,   1, 204,   0,  85, 192,
 	63,  16,  16,  12,  12,   5, 197, 195,  19,  17, 205, 204,  85, 149, 255,  47, 
 	0,  28,   0,   9, 192,   6, 208,   2, 220,   1, 153, 192, 106, 208,  47,  28, 
@@ -327,10 +330,85 @@ public:
 	  int count = 0;
 		for(; inBegin != inEnd; ++inBegin, ++count)
 		{
-			*inBegin = *inBegin ^ whitenerdetail::whitenCode[count%4096];
+			if(count == codeLength)
+				count = 0;
+			*inBegin = *inBegin ^ whitenerdetail::whitenCode[count];
 		}
 	}
 
+	/// Whiten some contiguous uint8_t data in place.
+	static void whiten(uint8_t* inBegin, uint8_t* inEnd)
+	{
+		whiten(inBegin, inEnd, inBegin);
+	}
+
+	/// Whiten the uint8_t data in a vector in place.
+	static void whiten(std::vector<uint8_t>::iterator inBegin,
+	                   std::vector<uint8_t>::iterator inEnd)
+	{
+		if(inBegin != inEnd)
+			whiten(&*inBegin, &*inBegin+(inEnd-inBegin), &*inBegin);
+	}
+
+	/** Whiten some contiguous uint8_t data, eight bytes at a time.
+	 *
+	 * @param inBegin   Pointer to first data element.
+	 * @param inEnd     Pointer to one past last data element.
+	 * @param out       Pointer to first output element (may be inBegin).
+	 * @param codeIndex Position of the first data element in the whitening
+	 *                  code (the number of bytes which came before it).
+	 */
+	static void whiten(const uint8_t* inBegin, const uint8_t* inEnd,
+	                   uint8_t* out, int codeIndex = 0)
+	{
+		codeIndex %= codeLength;
+		while(inBegin != inEnd)
+		{
+			int n = std::min<ptrdiff_t>(inEnd-inBegin, codeLength-codeIndex);
+			const uint8_t* code = whitenerdetail::whitenCode+codeIndex;
+			int i = 0;
+			for(; i+8 <= n; i+=8)
+			{
+				uint64_t x, c;
+				memcpy(&x, inBegin+i, 8);
+				memcpy(&c, code+i, 8);
+				x ^= c;
+				memcpy(out+i, &x, 8);
+			}
+			for(; i<n; i++)
+				out[i] = inBegin[i] ^ code[i];
+			inBegin += n;
+			out += n;
+			codeIndex = 0;
+		}
+	}
+
+	/** Whiten soft bits (LLRs) of some uint8_t data.
+	 *
+	 * Flips the sign of each LLR whose bit would be inverted by whiten().
+	 * LLRs are given in bit order, most significant bit of each byte first.
+	 *
+	 * @param inBegin Iterator to first LLR.
+	 * @param inEnd   Iterator to one past last LLR.
+	 */
+	template<class InputIterator>
+	static void whitenSoft(InputIterator inBegin, InputIterator inEnd)
+	{
+	  int count = 0;
+		for(; inBegin != inEnd; ++count)
+		{
+			uint8_t code = whitenerdetail::whitenCode[count%codeLength];
+			for(int bit=7; bit>=0 && inBegin != inEnd; --bit, ++inBegin)
+			{
+				if((code >> bit) & 1)
+					*inBegin = -*inBegin;
+			}
+		}
+	}
+
+	/// Length of the whitening code, after which it repeats.
+	static const int codeLength = 4096;
+
 private:
   Whitener(){}; ///< Disable constructor by making it private
 };
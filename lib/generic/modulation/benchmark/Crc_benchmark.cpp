@@ -0,0 +1,95 @@
+/**
+ * \file lib/generic/modulation/benchmark/Crc_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ * \section DESCRIPTION
+ *
+ * Benchmark of Crc for buffers from 64 bytes to 64 KBytes. Generating the
+ * crc a byte at a time is compared with the slice-by-8 tables and, where
+ * the processor supports it, carry-less multiplies.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "Crc.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+/// Rate of numBytes bytes in time t2-t1 in MBytes/sec.
+static double rate(double numBytes, bp::ptime t1, bp::ptime t2)
+{
+  return (numBytes/1.0e6)*(1.0e9/(t2-t1).total_nanoseconds());
+}
+
+int main(int argc, char* argv[])
+{
+  int totalBytes = 64 << 20;   // Per size and method
+  vector<uint8_t> data(65536);
+  for(int i=0; i<data.size(); i++)
+    data[i] = rand() & 0xFF;
+
+  cout << "Carry-less multiply "
+       << (Crc::hasClmul() ? "supported" : "not supported") << endl;
+  for(int size=64; size<=65536; size*=4)
+  {
+    const uint8_t* in = &data[0];
+    int numPasses = totalBytes/size;
+    volatile uint32_t check = 0;   // Keeps the crcs from being optimized away
+
+    bp::ptime t1(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+    {
+      uint32_t crc = 0;
+      for(int i=0; i<size; i++)
+        crc = crcdetail::crcTable[in[i] ^ (crc >> 24)] ^ (crc << 8);
+      check ^= crc;
+    }
+    bp::ptime t2(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+      check ^= Crc::updateSlice8(0, in, in+size);
+    bp::ptime t3(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses && Crc::hasClmul(); n++)
+      check ^= Crc::updateClmul(0, in, in+size);
+    bp::ptime t4(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+      check ^= Crc::generate(in, in+size);
+    bp::ptime t5(bp::microsec_clock::local_time());
+
+    cout << size << " bytes: bytewise = " << rate(totalBytes, t1, t2)
+         << " MBytes/sec, slice-by-8 = " << rate(totalBytes, t2, t3)
+         << " MBytes/sec";
+    if(Crc::hasClmul())
+      cout << ", clmul = " << rate(totalBytes, t3, t4) << " MBytes/sec";
+    cout << ", generate = " << rate(totalBytes, t4, t5) << " MBytes/sec" << endl;
+  }
+}
@@ -0,0 +1,100 @@
+/**
+ * \file lib/generic/modulation/benchmark/Nco_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ * \section DESCRIPTION
+ *
+ * Benchmark of frequency correction with Nco::mix against generating a
+ * corrector with a 16-bit phase table and multiplying in a second pass,
+ * and against computing a phasor for every sample.
+ */
+
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "Nco.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+
+/// Rate of numSamples samples in time t2-t1 in MSamples/sec.
+static double rate(double numSamples, bp::ptime t1, bp::ptime t2)
+{
+  return (numSamples/1.0e6)*(1.0e9/(t2-t1).total_nanoseconds());
+}
+
+int main(int argc, char* argv[])
+{
+  int length = 272;           // An OFDM symbol with its cyclic prefix
+  int numPasses = 200000;
+  float frequency = 0.0123f;
+  CplxVec samples(length), corrector(length);
+  for(int i=0; i<length; i++)
+    samples[i] = Cplx(rand()/(float)RAND_MAX-0.5f, rand()/(float)RAND_MAX-0.5f);
+
+  // A 65536 entry cosine table stepped by a 16-bit accumulator
+  vector<float> lookup(65536);
+  for(int i=0; i<65536; i++)
+    lookup[i] = (float)cos(2.0*IRIS_PI*i/65536.0);
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(int n=0; n<numPasses; n++)
+  {
+    uint16_t delta = (uint16_t)(65536.0*frequency);
+    uint16_t acc = 0, accSin = 65536/4*3;
+    for(int i=0; i<length; i++, acc+=delta, accSin+=delta)
+      corrector[i] = Cplx(lookup[acc], lookup[accSin]);
+    for(int i=0; i<length; i++)
+      samples[i] *= corrector[i];
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  for(int n=0; n<numPasses; n++)
+    for(int i=0; i<length; i++)
+      samples[i] *= polar(1.0f, (float)(2*IRIS_PI*frequency*i));
+  bp::ptime t3(bp::microsec_clock::local_time());
+  Nco nco(frequency);
+  for(int n=0; n<numPasses; n++)
+    nco.mix(samples.begin(), samples.end());
+  bp::ptime t4(bp::microsec_clock::local_time());
+
+  double total = (double)numPasses*length;
+  cout << "table and multiply = " << rate(total, t1, t2) << " MSamples/sec"
+       << endl;
+  cout << "phasor per sample = " << rate(total, t2, t3) << " MSamples/sec"
+       << endl;
+  cout << "Nco::mix = " << rate(total, t3, t4) << " MSamples/sec"
+       << endl;
+}
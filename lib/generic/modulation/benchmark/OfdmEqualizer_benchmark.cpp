@@ -0,0 +1,116 @@
+/**
+ * \file lib/generic/modulation/benchmark/OfdmEqualizer_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Benchmark of the fused OfdmEqualizer against the separate rotate,
+ * equalize, phase correct and gather passes it replaces.
+ */
+
+#include <algorithm>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/lambda/lambda.hpp>
+
+#include "OfdmEqualizer.h"
+#include "OfdmIndexGenerator.h"
+
+using namespace std;
+using namespace iris;
+using namespace boost::lambda;
+namespace bp = boost::posix_time;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+typedef vector<int>       IntVec;
+
+static Cplx randomCplx()
+{
+  return Cplx(rand()/(float)RAND_MAX*2-1, rand()/(float)RAND_MAX*2-1);
+}
+
+int main(int argc, char* argv[])
+{
+  int numData = 192, numPilots = 8, numGuards = 55;
+  int numBins = numData + numPilots + numGuards + 1;
+  int numSymbols = 200000;
+
+  IntVec pilotIdx(numPilots), dataIdx(numData);
+  OfdmIndexGenerator::generateIndices(numData, numPilots, numGuards,
+                                      pilotIdx.begin(), pilotIdx.end(),
+                                      dataIdx.begin(), dataIdx.end());
+  Cplx s[] = {Cplx(1,0),Cplx(1,0),Cplx(-1,0),Cplx(-1,0),
+              Cplx(-1,0),Cplx(1,0),Cplx(-1,0),Cplx(1,0)};
+  CplxVec pilotSeq(s, s+8);
+
+  CplxVec rxBins(numBins), bins(numBins), eq(numBins), out(numData);
+  generate(rxBins.begin(), rxBins.end(), randomCplx);
+  generate(eq.begin(), eq.end(), randomCplx);
+  int shift = numBins-2;
+
+  // The separate passes previously made by OfdmDemodulatorComponent
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(int n=0; n<numSymbols; n++)
+  {
+    copy(rxBins.begin(), rxBins.end(), bins.begin());
+    rotate(bins.begin(), bins.begin()+shift, bins.end());
+    transform(bins.begin(), bins.end(), eq.begin(), bins.begin(), _1*_2);
+    Cplx sum(0,0);
+    for(int i=0; i<numPilots; i++)
+      sum += pilotSeq[i%pilotSeq.size()]/bins[pilotIdx[i]];
+    float ave = arg(sum/(float)numPilots);
+    Cplx corrector = Cplx(cos(ave), sin(ave));
+    transform(bins.begin(), bins.end(), bins.begin(), _1*corrector);
+    for(int i=0; i<numData; i++)
+      out[i] = bins[dataIdx[i]];
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+  Cplx check = out[0];
+
+  // The fused equalizer
+  OfdmEqualizer e;
+  e.reset(numBins, pilotIdx, dataIdx, pilotSeq);
+  bp::ptime t3(bp::microsec_clock::local_time());
+  for(int n=0; n<numSymbols; n++)
+  {
+    copy(rxBins.begin(), rxBins.end(), bins.begin());
+    e.equalize(&bins[0], shift, &eq[0], &out[0]);
+  }
+  bp::ptime t4(bp::microsec_clock::local_time());
+  check -= out[0];
+
+  double separate = (numSymbols/1.0e6)*(1.0e9/(t2-t1).total_nanoseconds());
+  double fused = (numSymbols/1.0e6)*(1.0e9/(t4-t3).total_nanoseconds());
+  cout << "Separate passes = " << separate << " MSymbols/sec" << endl;
+  cout << "Fused equalizer = " << fused << " MSymbols/sec" << endl;
+  cout << "Speedup = " << fused/separate << "x (error " << abs(check) << ")"
+       << endl;
+}
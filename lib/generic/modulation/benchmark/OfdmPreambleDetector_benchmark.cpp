@@ -0,0 +1,103 @@
+/**
+ * \file lib/generic/modulation/benchmark/OfdmPreambleDetector_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Benchmark of the block OfdmPreambleDetector against the sample-by-sample
+ * implementation it replaces, searching an idle (noise only) channel.
+ */
+
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "OfdmPreambleDetector.h"
+#include "../test/OfdmPreambleDetectorReference.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+typedef CplxVec::iterator CplxVecIt;
+
+/// Search the input in blocks of blockSize samples and return ns/sample.
+float runReference(CplxVec& input, int blockSize)
+{
+  OfdmPreambleDetectorReference detector;
+  CplxVec preamble(272);
+  bool detected = false;
+  float freqOffset, snr;
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(CplxVecIt it=input.begin(); it!=input.end(); it+=blockSize)
+    detector.search(it, it+blockSize, preamble.begin(), preamble.end(),
+                    detected, freqOffset, snr);
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  return (t2-t1).total_nanoseconds()/(float)input.size();
+}
+
+/// Search the input in blocks of blockSize samples and return ns/sample.
+float runDetector(CplxVec& input, int blockSize)
+{
+  OfdmPreambleDetector detector;
+  CplxVec preamble(272);
+  OfdmPreambleDetector::Result result;
+
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(CplxVecIt it=input.begin(); it!=input.end(); it+=blockSize)
+    detector.search(it, it+blockSize, preamble.begin(), preamble.end(),
+                    result);
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  return (t2-t1).total_nanoseconds()/(float)input.size();
+}
+
+int main(int argc, char* argv[])
+{
+  int numSamples = 1<<24;
+  CplxVec input(numSamples);
+  for(int i=0; i<numSamples; i++)
+    input[i] = Cplx(rand()/(float)RAND_MAX-0.5f, rand()/(float)RAND_MAX-0.5f);
+
+  int blockSizes[] = {256, 4096, 65536};
+  for(int i=0; i<3; i++)
+  {
+    float before = runReference(input, blockSizes[i]);
+    float after = runDetector(input, blockSizes[i]);
+    cout << "Input blocks of " << blockSizes[i] << " samples: "
+         << before << " ns/sample sample-by-sample, "
+         << after << " ns/sample block, gain = " << before/after << "x"
+         << endl;
+  }
+  return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * \file lib/generic/modulation/benchmark/QamDemodulator_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ * \section DESCRIPTION
+ *
+ * Benchmark of QamModulator and QamDemodulator for each modulation order.
+ * Modulation with byte-indexed tables is compared with indexing a table
+ * of single symbols for each group of bits, and hard demodulation of
+ * BPSK, QPSK and QAM16 with decision tables is compared with branching on
+ * the quadrant of each symbol.
+ */
+
+#include <cmath>
+#include <complex>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "QamModulator.h"
+#include "QamDemodulator.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+
+/// Rate of n passes over numBytes bytes in MBytes/sec.
+static double rate(int n, int numBytes, bp::ptime t1, bp::ptime t2)
+{
+  return (n*numBytes/1.0e6)*(1.0e9/(t2-t1).total_nanoseconds());
+}
+
+/// Modulate with a table of the 2^M single symbols, as QamModulator did.
+static void modulatePerSymbol(const vector<uint8_t>& data, const CplxVec& lut,
+                              CplxVec& symbols, unsigned int M)
+{
+  CplxVec::iterator out = symbols.begin();
+  for(int i=0; i<(int)data.size(); i++)
+    for(int j=8/M-1; j>=0; j--)
+      *out++ = lut[(data[i] >> (j*M)) & ((1 << M)-1)];
+}
+
+/// Hard demodulate BPSK, QPSK or QAM16 by branching on the quadrant of each
+/// symbol, as QamDemodulator did.
+static void demodulateBranching(const CplxVec& symbols, vector<uint8_t>& out,
+                                unsigned int M)
+{
+  const uint8_t qam16Lut[] = {15,13,12,14,5,7,6,4,0,2,3,1,10,8,9,11};
+  const float biasValues[2] = {2.0f/sqrtf(10.0f), 0.0f};
+  vector<uint8_t>::iterator o = out.begin();
+  for(int count=0; count<(int)symbols.size(); count++)
+  {
+    if(count%(8/M) == 0 && count != 0)
+      o++;
+    Cplx x = symbols[count];
+    if(M == BPSK)
+    {
+      *o = *o<<1 | (x.real() > 0 ? 0 : 1);
+      continue;
+    }
+    if(M == QPSK)
+    {
+      *o = *o<<2 | (x.real() > 0) << 1 | (x.imag() > 0);
+      continue;
+    }
+    int symIndex = 0;
+    int pointsPerQuadrant = 4;
+    for(int j=0; j<2; j++)
+    {
+      float b = biasValues[j];
+      if(x.real() > 0)
+      {
+        if(x.imag() > 0)
+          x += Cplx(-b,-b);
+        else
+        {
+          x += Cplx(-b,b);
+          symIndex += 3*pointsPerQuadrant;
+        }
+      }
+      else
+      {
+        if(x.imag() > 0)
+        {
+          x += Cplx(b,-b);
+          symIndex += pointsPerQuadrant;
+        }
+        else
+        {
+          x += Cplx(b,b);
+          symIndex += 2*pointsPerQuadrant;
+        }
+      }
+      pointsPerQuadrant >>= 2;
+    }
+    *o = *o<<4 | qam16Lut[symIndex];
+  }
+}
+
+int main(int argc, char* argv[])
+{
+  int numBytes = 144*24;    // A whole number of symbols for every order
+  int numPasses = 2000;
+  vector<uint8_t> data(numBytes), out(numBytes);
+  for(int i=0; i<numBytes; i++)
+    data[i] = rand() & 0xFF;
+
+  QamModulator mod;
+  QamDemodulator demod;
+  unsigned int mods[] = {BPSK, QPSK, QAM16, QAM64, QAM256};
+  const char* names[] = {"BPSK", "QPSK", "QAM16", "QAM64", "QAM256"};
+  for(int m=0; m<5; m++)
+  {
+    unsigned int M = mods[m];
+    int num = numBytes*8/M;
+    CplxVec symbols(num);
+    vector<float> weights(num, 1.0f), llrs(num*M);
+
+    // Single symbol table, taken from the most significant bits of bytes
+    CplxVec lut(1 << M), first(8);
+    for(int k=0; k<(1 << M) && M != QAM64; k++)
+    {
+      uint8_t byte = k << (8-M);
+      mod.modulate(&byte, &byte+1, first.begin(), first.end(), M);
+      lut[k] = first[0];
+    }
+    bp::ptime t0(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses && M != QAM64; n++)
+      modulatePerSymbol(data, lut, symbols, M);
+
+    bp::ptime t1(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+      mod.modulate(data.begin(), data.end(), symbols.begin(), symbols.end(), M);
+    bp::ptime t2(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+      demod.demodulate(symbols.begin(), symbols.end(), out.begin(), out.end(), M);
+    bp::ptime t3(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+      demod.demodulateSoft(&symbols[0], &weights[0], num, &llrs[0], M);
+    bp::ptime t4(bp::microsec_clock::local_time());
+    bool branching = M == BPSK || M == QPSK || M == QAM16;
+    vector<uint8_t> outBranching(numBytes);
+    for(int n=0; n<numPasses && branching; n++)
+      demodulateBranching(symbols, outBranching, M);
+    bp::ptime t5(bp::microsec_clock::local_time());
+
+    if(M != QAM64)
+      cout << names[m] << ": per-symbol modulate = "
+           << rate(numPasses, numBytes, t0, t1) << " MBytes/sec" << endl;
+    cout << names[m] << ": modulate = " << rate(numPasses, numBytes, t1, t2)
+         << " MBytes/sec, demodulate = " << rate(numPasses, numBytes, t2, t3)
+         << " MBytes/sec, soft = " << rate(numPasses, numBytes, t3, t4)
+         << " MBytes/sec" << (out == data ? "" : " (MISMATCH)") << endl;
+    if(branching)
+      cout << names[m] << ": branching demodulate = "
+           << rate(numPasses, numBytes, t4, t5) << " MBytes/sec"
+           << (outBranching == out ? "" : " (MISMATCH)") << endl;
+  }
+}
@@ -0,0 +1,147 @@
+/**
+ * \file lib/generic/modulation/benchmark/SharedTables_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Memory footprint and creation time of the table-driven modulation
+ * classes, with tables owned by each instance against tables shared by
+ * all instances. Owned tables are measured by building a copy of the
+ * shared tables for every instance, as the classes used to.
+ */
+
+#include <complex>
+#include <cstddef>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "QamModulator.h"
+#include "QamDemodulator.h"
+#include "OfdmPreambleGenerator.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+
+/// Create numInstances objects of class T, optionally each with a copy
+/// of its tables, and print their footprint and creation time.
+template <class T, class Tables>
+static void report(const char* name, int numInstances, bool owned,
+                   size_t tableBytes, Tables* (*build)(), void (*use)(T&))
+{
+  vector<T*> objects(numInstances);
+  vector<Tables*> tables(numInstances, (Tables*)NULL);
+  bp::ptime t1(bp::microsec_clock::local_time());
+  for(int i=0; i<numInstances; i++)
+  {
+    objects[i] = new T;
+    if(owned)
+      tables[i] = build();
+    use(*objects[i]);
+  }
+  bp::ptime t2(bp::microsec_clock::local_time());
+
+  size_t total = numInstances*sizeof(T) + tableBytes*(owned ? numInstances : 1);
+  cout << name << (owned ? " owned" : " shared") << ", " << numInstances
+       << " instances: " << total/numInstances << " bytes/instance, "
+       << (t2-t1).total_microseconds()/(double)numInstances
+       << " us/instance" << endl;
+
+  for(int i=0; i<numInstances; i++)
+  {
+    delete objects[i];
+    delete tables[i];
+  }
+}
+
+static QamModulator::Tables* buildModulatorTables()
+{
+  return new QamModulator::Tables;
+}
+
+static QamDemodulator::Tables* buildDemodulatorTables()
+{
+  return new QamDemodulator::Tables;
+}
+
+static OfdmPreambleGenerator::Preamble* buildPreamble()
+{
+  // Owned sequences were built by each generator as well
+  OfdmPreambleGenerator::Sequences sequences;
+  return new OfdmPreambleGenerator::Preamble(
+      OfdmPreambleGenerator::Numerology(192, 8, 55));
+}
+
+static void useModulator(QamModulator& m)
+{
+  unsigned char byte = 0x5A;
+  Cplx symbols[8];
+  m.modulate(&byte, &byte+1, symbols, symbols+8, QPSK);
+}
+
+static void useDemodulator(QamDemodulator& d)
+{
+  CplxVec symbols(4, Cplx(0.5f, -0.5f));
+  vector<uint8_t> bytes(1);
+  d.demodulate(symbols.begin(), symbols.end(), bytes.begin(), bytes.end(),
+               QPSK);
+}
+
+static void usePreambleGenerator(OfdmPreambleGenerator& g)
+{
+  CplxVec preamble(256);
+  g.generatePreamble(192, 8, 55, preamble.begin(), preamble.end());
+}
+
+int main(int argc, char* argv[])
+{
+  size_t modBytes = QamModulator().tables().bytes();
+  size_t demodBytes = QamDemodulator().tables().bytes();
+  OfdmPreambleGenerator g;
+  usePreambleGenerator(g);
+  size_t preambleBytes = g.sequences().bytes()
+      + OfdmPreambleGenerator::Preamble(
+          OfdmPreambleGenerator::Numerology(192, 8, 55)).bytes();
+
+  int counts[] = {1, 16, 64};
+  for(int c=0; c<3; c++)
+  {
+    for(int owned=1; owned>=0; owned--)
+    {
+      report("QamModulator", counts[c], owned, modBytes,
+             &buildModulatorTables, &useModulator);
+      report("QamDemodulator", counts[c], owned, demodBytes,
+             &buildDemodulatorTables, &useDemodulator);
+      report("OfdmPreambleGenerator", counts[c], owned, preambleBytes,
+             &buildPreamble, &usePreambleGenerator);
+    }
+  }
+}
@@ -0,0 +1,95 @@
+/**
+ * \file lib/generic/modulation/benchmark/WhitenCrc_benchmark.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ * \section DESCRIPTION
+ *
+ * Benchmark of WhitenCrc against generating the crc and whitening in
+ * separate passes, both byte at a time and with the word-wide functions.
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "WhitenCrc.h"
+
+using namespace std;
+using namespace iris;
+namespace bp = boost::posix_time;
+
+/// Rate of numBytes bytes in time t2-t1 in MBytes/sec.
+static double rate(double numBytes, bp::ptime t1, bp::ptime t2)
+{
+  return (numBytes/1.0e6)*(1.0e9/(t2-t1).total_nanoseconds());
+}
+
+int main(int argc, char* argv[])
+{
+  int totalBytes = 64 << 20;   // Per size and method
+  int sizes[] = {256, 1536, 6144, 65536};
+  vector<uint8_t> data(65536), out(65536);
+  for(int i=0; i<data.size(); i++)
+    data[i] = rand() & 0xFF;
+
+  for(int s=0; s<4; s++)
+  {
+    int size = sizes[s];
+    int numPasses = totalBytes/size;
+    uint8_t* in = &data[0];
+    volatile uint32_t check = 0;   // Keeps the crcs from being optimized away
+
+    // Byte at a time, as the modulator did
+    bp::ptime t1(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+    {
+      uint32_t crc = 0;
+      for(int i=0; i<size; i++)
+        crc = crcdetail::crcTable[in[i] ^ (crc >> 24)] ^ (crc << 8);
+      check ^= crc;
+      for(int i=0; i<size; i++)
+        in[i] ^= whitenerdetail::whitenCode[i%4096];
+    }
+    bp::ptime t2(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+    {
+      check ^= Crc::generate(in, in+size);
+      Whitener::whiten(in, in+size, &out[0]);
+    }
+    bp::ptime t3(bp::microsec_clock::local_time());
+    for(int n=0; n<numPasses; n++)
+      check ^= WhitenCrc::crcThenWhiten(in, in+size, &out[0]);
+    bp::ptime t4(bp::microsec_clock::local_time());
+
+    cout << size << " bytes: bytewise = " << rate(totalBytes, t1, t2)
+         << " MBytes/sec, separate = " << rate(totalBytes, t2, t3)
+         << " MBytes/sec, fused = " << rate(totalBytes, t3, t4)
+         << " MBytes/sec" << endl;
+  }
+}
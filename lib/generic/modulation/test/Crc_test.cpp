@@ -37,6 +37,9 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <cstdlib>
+#include <list>
+#include <vector>
 #include "irisapi/TypeInfo.h"
 
 using namespace std;
@@ -68,4 +71,70 @@ BOOST_AUTO_TEST_CASE(Crc_Test)
   BOOST_CHECK(crc != 0xAC148725); // Ensure checksum is different
 }
 
+/// Byte at a time crc, as generated for any input iterator.
+static uint32_t bytewiseCrc(uint32_t crc, const vector< uint8_t >& data,
+                            int first, int last)
+{
+  for(int i=first; i<last; i++)
+    crc = crcdetail::crcTable[data[i] ^ (crc >> 24)] ^ (crc << 8);
+  return crc;
+}
+
+BOOST_AUTO_TEST_CASE(Crc_Fast_Test)
+{
+  // Every length up to 1100 bytes and a few longer, at odd offsets
+  vector< uint8_t > data(70000);
+  for(int i=0; i<data.size(); ++i)
+    data[i] = rand() & 0xFF;
+
+  vector< int > lengths;
+  for(int n=0; n<1100; n++)
+    lengths.push_back(n);
+  lengths.push_back(4096);
+  lengths.push_back(65536+37);
+
+  for(int i=0; i<lengths.size(); i++)
+  {
+    int n = lengths[i];
+    int first = i%7;
+    const uint8_t* in = &data[first];
+    uint32_t expected = bytewiseCrc(0, data, first, first+n);
+    BOOST_CHECK_EQUAL(Crc::generate(data.begin()+first, data.begin()+first+n),
+                      expected);
+    BOOST_CHECK_EQUAL(Crc::updateSlice8(0, in, in+n), expected);
+#ifdef IRIS_CRC_CLMUL
+    if(Crc::hasClmul())
+      BOOST_CHECK_EQUAL(Crc::updateClmul(0, in, in+n), expected);
+#endif
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Crc_Update_Test)
+{
+  // A crc continued over split data matches the crc of the whole
+  vector< uint8_t > data(3000);
+  for(int i=0; i<data.size(); ++i)
+    data[i] = rand() & 0xFF;
+  uint32_t expected = Crc::generate(data.begin(), data.end());
+
+  for(int split=0; split<data.size(); split+=97)
+  {
+    const uint8_t* in = &data[0];
+    uint32_t crc = Crc::update(0, in, in+split);
+    BOOST_CHECK_EQUAL(Crc::update(crc, in+split, in+data.size()), expected);
+#ifdef IRIS_CRC_CLMUL
+    if(Crc::hasClmul())
+    {
+      crc = Crc::updateClmul(0, in, in+split);
+      BOOST_CHECK_EQUAL(Crc::updateClmul(crc, in+split, in+data.size()),
+                        expected);
+    }
+#endif
+  }
+
+  // Other input iterators still generate the same crc
+  list< uint8_t > dataList(data.begin(), data.end());
+  BOOST_CHECK_EQUAL(Crc::generate(dataList.begin(), dataList.end()), expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
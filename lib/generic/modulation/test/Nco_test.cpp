@@ -0,0 +1,121 @@
+/**
+ * \file lib/generic/modulation/Nco_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for Nco class.
+ */
+
+#define BOOST_TEST_MODULE Nco_Test
+
+#include <boost/test/unit_test.hpp>
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "Nco.h"
+
+#include "irisapi/TypeInfo.h"
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+
+BOOST_AUTO_TEST_SUITE (Nco_Test)
+
+/// Largest error of a tone against exp(j*2*pi*(phase+frequency*i)).
+static double toneError(const CplxVec& tone, double frequency, double phase)
+{
+  double maxError = 0;
+  for(int i=0; i<tone.size(); i++)
+  {
+    double angle = 2*IRIS_PI*(phase + frequency*i);
+    Cplx expected((float)cos(angle), (float)sin(angle));
+    maxError = max(maxError, (double)abs(tone[i]-expected));
+  }
+  return maxError;
+}
+
+BOOST_AUTO_TEST_CASE(Nco_Generate_Test)
+{
+  double frequencies[] = {0.0, 1.0/64, -3.0/64, 0.123456789, -0.4999};
+  for(int f=0; f<5; f++)
+  {
+    CplxVec tone(10000);
+    Nco nco(frequencies[f], 0.25);
+    nco.generate(tone.begin(), tone.end());
+    BOOST_CHECK(toneError(tone, frequencies[f], 0.25) < 1e-5);
+    BOOST_CHECK(fabs(nco.frequency() - frequencies[f]) < 1e-9);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Nco_Continuity_Test)
+{
+  // Tones generated in pieces of any length carry on from each other
+  double frequency = 0.0173;
+  CplxVec whole(5000), pieces(5000);
+  Nco a(frequency), b(frequency);
+  a.generate(whole.begin(), whole.end());
+
+  int lengths[] = {1, 63, 64, 65, 130, 7};
+  CplxVec::iterator it = pieces.begin();
+  for(int i=0; it != pieces.end(); i++)
+  {
+    int n = min<int>(lengths[i%6], pieces.end()-it);
+    b.generate(it, it+n);
+    it += n;
+  }
+  BOOST_CHECK(toneError(pieces, frequency, 0) < 1e-5);
+  for(int i=0; i<whole.size(); i++)
+    BOOST_CHECK(abs(whole[i]-pieces[i]) < 1e-5);
+  BOOST_CHECK(a.phase() == b.phase());
+}
+
+BOOST_AUTO_TEST_CASE(Nco_Mix_Test)
+{
+  double frequency = -0.0891;
+  CplxVec samples(1001), tone(1001), mixed(1001);
+  for(int i=0; i<samples.size(); i++)
+    samples[i] = Cplx(sin(i*0.1f), cos(i*0.37f));
+
+  Nco gen(frequency, 0.5), mixer(frequency, 0.5);
+  gen.generate(tone.begin(), tone.end());
+  mixer.mix(samples.begin(), samples.end(), mixed.begin());
+  for(int i=0; i<samples.size(); i++)
+    BOOST_CHECK(abs(mixed[i] - samples[i]*tone[i]) < 1e-5);
+
+  // In place
+  mixer.setPhase(0.5);
+  mixer.mix(samples.begin(), samples.end());
+  for(int i=0; i<samples.size(); i++)
+    BOOST_CHECK(abs(mixed[i] - samples[i]) < 1e-6);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,161 @@
+/**
+ * \file lib/generic/modulation/test/OfdmEqualizer_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for OfdmEqualizer class.
+ */
+
+#define BOOST_TEST_MODULE OfdmEqualizer_Test
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+#include <complex>
+
+#include "OfdmEqualizer.h"
+#include "OfdmIndexGenerator.h"
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float>    Cplx;
+typedef vector<Cplx>      CplxVec;
+typedef vector<int>       IntVec;
+
+/// Random complex value with components in [-1,1].
+static Cplx randomCplx()
+{
+  return Cplx(rand()/(float)RAND_MAX*2-1, rand()/(float)RAND_MAX*2-1);
+}
+
+/// The step-by-step equalization which OfdmEqualizer replaces.
+static float referenceEqualize(CplxVec bins, int shift, const CplxVec& eq,
+                               const IntVec& pilotIdx, const IntVec& dataIdx,
+                               const CplxVec& pilotSeq, CplxVec& out)
+{
+  rotate(bins.begin(), bins.begin()+shift, bins.end());
+  for(int i=0; i<bins.size(); i++)
+    bins[i] *= eq[i];
+  Cplx sum(0,0);
+  for(int i=0; i<pilotIdx.size(); i++)
+    sum += pilotSeq[i%pilotSeq.size()]/bins[pilotIdx[i]];
+  float ave = arg(sum/(float)pilotIdx.size());
+  Cplx corrector(cos(ave), sin(ave));
+  for(int i=0; i<bins.size(); i++)
+    bins[i] *= corrector;
+  for(int i=0; i<dataIdx.size(); i++)
+    out[i] = bins[dataIdx[i]];
+
+  float error = 0, power = 0;
+  for(int i=0; i<pilotIdx.size(); i++)
+  {
+    Cplx p = pilotSeq[i%pilotSeq.size()];
+    error += norm(bins[pilotIdx[i]] - p);
+    power += norm(p);
+  }
+  return error/power;
+}
+
+BOOST_AUTO_TEST_SUITE (OfdmEqualizer_Test)
+
+BOOST_AUTO_TEST_CASE(OfdmEqualizer_Basic_Test)
+{
+  BOOST_REQUIRE_NO_THROW(OfdmEqualizer e);
+}
+
+BOOST_AUTO_TEST_CASE(OfdmEqualizer_Reference_Test)
+{
+  // Odd data carrier counts exercise the scalar tail of the vector loop
+  int numData[] = {40, 41, 192, 193};
+  int numPilots[] = {8, 8, 8, 4};
+  int numGuards[] = {15, 14, 55, 30};
+
+  Cplx seq[] = {Cplx(1,0),Cplx(1,0),Cplx(-1,0),Cplx(-1,0),
+                Cplx(-1,0),Cplx(1,0),Cplx(-1,0),Cplx(1,0)};
+  CplxVec pilotSeq(seq, seq+8);
+
+  for(int c=0; c<4; c++)
+  {
+    int numBins = numData[c] + numPilots[c] + numGuards[c] + 1;
+    IntVec pilotIdx(numPilots[c]), dataIdx(numData[c]);
+    OfdmIndexGenerator::generateIndices(numData[c], numPilots[c], numGuards[c],
+                                        pilotIdx.begin(), pilotIdx.end(),
+                                        dataIdx.begin(), dataIdx.end());
+
+    OfdmEqualizer e;
+    e.reset(numBins, pilotIdx, dataIdx, pilotSeq);
+
+    CplxVec bins(numBins), eq(numBins);
+    CplxVec out(numData[c]), expected(numData[c]);
+    for(int offset=-16; offset<=16; offset+=4)
+    {
+      generate(bins.begin(), bins.end(), randomCplx);
+      generate(eq.begin(), eq.end(), randomCplx);
+      int shift = (numBins-offset*2)%numBins;
+
+      float error = e.equalize(&bins[0], shift, &eq[0], &out[0]);
+      float expectedError = referenceEqualize(bins, shift, eq, pilotIdx,
+                                              dataIdx, pilotSeq, expected);
+      BOOST_CHECK_CLOSE(error, expectedError, 1e-2);
+
+      for(int i=0; i<numData[c]; i++)
+      {
+        BOOST_CHECK_SMALL(out[i].real()-expected[i].real(), 1e-5f);
+        BOOST_CHECK_SMALL(out[i].imag()-expected[i].imag(), 1e-5f);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OfdmEqualizer_PilotError_Test)
+{
+  int numData = 40, numPilots = 8, numGuards = 15;
+  int numBins = numData + numPilots + numGuards + 1;
+  IntVec pilotIdx(numPilots), dataIdx(numData);
+  OfdmIndexGenerator::generateIndices(numData, numPilots, numGuards,
+                                      pilotIdx.begin(), pilotIdx.end(),
+                                      dataIdx.begin(), dataIdx.end());
+  CplxVec pilotSeq(1, Cplx(1,0));
+
+  OfdmEqualizer e;
+  e.reset(numBins, pilotIdx, dataIdx, pilotSeq);
+
+  // Perfect pilots have no error, whatever their common phase
+  CplxVec bins(numBins, Cplx(0,1)), eq(numBins, Cplx(1,0));
+  CplxVec out(numData);
+  BOOST_CHECK_SMALL(e.equalize(&bins[0], 0, &eq[0], &out[0]), 1e-6f);
+
+  // An error of 0.1 on every pilot is an error power of 0.01
+  for(int i=0; i<numPilots; i++)
+    bins[pilotIdx[i]] = Cplx(1.1,0);
+  BOOST_CHECK_CLOSE(e.pilotError(&bins[0]), 0.01f, 1e-2);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
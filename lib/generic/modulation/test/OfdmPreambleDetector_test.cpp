@@ -36,9 +36,12 @@
 #include <boost/test/unit_test.hpp>
 #include <vector>
 #include <complex>
+#include <cstdlib>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 #include "OfdmPreambleDetector.h"
 #include "OfdmPreambleDetectorTestData.h"
+#include "OfdmPreambleDetectorReference.h"
 
 #include "irisapi/TypeInfo.h"
 #include "utility/RawFileUtility.h"
@@ -50,7 +53,7 @@ BOOST_AUTO_TEST_SUITE (OfdmPreambleDetector_Test)
 
 BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Basic_Test)
 {
-  BOOST_REQUIRE_NO_THROW(OfdmPreambleDetector detector;)
+  BOOST_REQUIRE_NO_THROW(OfdmPreambleDetector detector);
 }
 
 /** Test using a clean signal with preamble
@@ -67,9 +70,7 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Detect1_Test)
   typedef CplxVec::iterator             CplxVecIt;
 
   CplxVec preamble(272);
-  bool detected = false;
-  float freqOffset;
-  float snr;
+  OfdmPreambleDetector::Result result;
 
   OfdmPreambleDetector detector;
   CplxVecIt it;
@@ -78,28 +79,28 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Detect1_Test)
                     D::preambleTestData1_.end(),
                     preamble.begin(),
                     preamble.end(),
-                    detected,
-                    freqOffset,
-                    snr);
-  )
+                    result);
+  );
   int index = it - D::preambleTestData1_.begin();
-  BOOST_CHECK( detected );
+  BOOST_CHECK( result.detected );
   BOOST_CHECK( abs(preamble.front()) > 0);
   BOOST_CHECK( index == 545);
-  BOOST_CHECK( snr > 25 );
-  BOOST_CHECK( freqOffset < 0.001 );
+  BOOST_CHECK( result.snr > 25 );
+  BOOST_CHECK( result.freqOffset < 0.001 );
+  BOOST_CHECK( result.peakMetric > 0.827 );
+  BOOST_CHECK( result.peakMetric <= 1.0 );
+  BOOST_CHECK( result.plateauWidth > 0 );
+  BOOST_CHECK( result.plateauWidth < 256 );
 
   // Run preamble through detector again to verify
   CplxVec scratch(272);
-  detected = false;
+  result = OfdmPreambleDetector::Result();
   it = detector.search(preamble.begin(),
                        preamble.end(),
                        scratch.begin(),
                        scratch.end(),
-                       detected,
-                       freqOffset,
-                       snr);
-  BOOST_CHECK( detected );
+                       result);
+  BOOST_CHECK( result.detected );
   BOOST_CHECK( it == preamble.end() );
 }
 
@@ -121,9 +122,7 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Detect2_Test)
   typedef CplxVec::iterator             CplxVecIt;
 
   CplxVec preamble(272);
-  bool detected = false;
-  float freqOffset;
-  float snr;
+  OfdmPreambleDetector::Result result;
 
   OfdmPreambleDetector detector;
   CplxVecIt it;
@@ -132,30 +131,26 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Detect2_Test)
                     D::preambleTestData2_.end(),
                     preamble.begin(),
                     preamble.end(),
-                    detected,
-                    freqOffset,
-                    snr);
-  )
+                    result);
+  );
   int index = it - D::preambleTestData2_.begin();
-  BOOST_CHECK( detected );
+  BOOST_CHECK( result.detected );
   BOOST_CHECK( abs(preamble.front()) > 0);
   BOOST_CHECK( index == 545);
-  BOOST_CHECK( snr > 13 );
-  BOOST_CHECK( snr < 17 );
-  BOOST_CHECK( freqOffset > 0.225 );
-  BOOST_CHECK( freqOffset < 0.275 );
+  BOOST_CHECK( result.snr > 13 );
+  BOOST_CHECK( result.snr < 17 );
+  BOOST_CHECK( result.freqOffset > 0.225 );
+  BOOST_CHECK( result.freqOffset < 0.275 );
 
   // Run preamble through detector again to verify
   CplxVec scratch(272);
-  detected = false;
+  result = OfdmPreambleDetector::Result();
   it = detector.search(preamble.begin(),
                        preamble.end(),
                        scratch.begin(),
                        scratch.end(),
-                       detected,
-                       freqOffset,
-                       snr);
-  BOOST_CHECK( detected );
+                       result);
+  BOOST_CHECK( result.detected );
   BOOST_CHECK( it == preamble.end());
 }
 
@@ -177,9 +172,7 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Detect3_Test)
   typedef CplxVec::iterator             CplxVecIt;
 
   CplxVec preamble(272);
-  bool detected = false;
-  float freqOffset;
-  float snr;
+  OfdmPreambleDetector::Result result;
 
   OfdmPreambleDetector detector;
   CplxVecIt it;
@@ -188,13 +181,153 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Detect3_Test)
                     D::preambleTestData3_.end(),
                     preamble.begin(),
                     preamble.end(),
-                    detected,
-                    freqOffset,
-                    snr);
-  )
-  BOOST_CHECK( !detected );
+                    result);
+  );
+  BOOST_CHECK( !result.detected );
   BOOST_CHECK( abs(preamble.front()) == 0);
   BOOST_CHECK( it == D::preambleTestData3_.end());
 }
 
+/** Compare the block detector with the sample-by-sample reference.
+ *
+ * A stream of noisy frames separated by noise of random length is
+ * searched by both detectors, with the block detector fed in chunks
+ * which do not line up with its blocks. Every preamble must be found at
+ * the same sample, with the same estimates.
+ */
+BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Reference_Test)
+{
+  typedef OfdmPreambleDetectorTestData  D;
+  typedef std::complex<float>           Cplx;
+  typedef std::vector<Cplx>             CplxVec;
+  typedef CplxVec::iterator             CplxVecIt;
+
+  srand(7);
+  CplxVec stream;
+  for(int i=0; i<20; i++)
+  {
+    int gap = rand()%3000;
+    for(int j=0; j<gap; j++)
+      stream.push_back(Cplx(rand()/(float)RAND_MAX-0.5f,
+                            rand()/(float)RAND_MAX-0.5f)*0.1f);
+    stream.insert(stream.end(), D::preambleTestData2_.begin(),
+                  D::preambleTestData2_.end());
+  }
+
+  vector<int> refIndex, index;
+  vector<float> refOffset, offset, refSnr, snr;
+  CplxVec preamble(272), refPreamble(272);
+
+  OfdmPreambleDetectorReference reference;
+  CplxVecIt it = stream.begin();
+  while(it != stream.end())
+  {
+    bool detected = false;
+    float f, s;
+    it = reference.search(it, stream.end(), refPreamble.begin(),
+                          refPreamble.end(), detected, f, s);
+    if(detected)
+    {
+      refIndex.push_back(it-stream.begin());
+      refOffset.push_back(f);
+      refSnr.push_back(s);
+    }
+  }
+
+  OfdmPreambleDetector detector;
+  it = stream.begin();
+  while(it != stream.end())
+  {
+    CplxVecIt end = it + min<int>(stream.end()-it, 1+rand()%1500);
+    while(it != end)
+    {
+      OfdmPreambleDetector::Result result;
+      it = detector.search(it, end, preamble.begin(), preamble.end(), result);
+      if(result.detected)
+      {
+        index.push_back(it-stream.begin());
+        offset.push_back(result.freqOffset);
+        snr.push_back(result.snr);
+      }
+    }
+  }
+
+  BOOST_CHECK(refIndex.size() == 20);
+  BOOST_CHECK_EQUAL_COLLECTIONS(index.begin(), index.end(),
+                                refIndex.begin(), refIndex.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(offset.begin(), offset.end(),
+                                refOffset.begin(), refOffset.end());
+  BOOST_CHECK_EQUAL_COLLECTIONS(snr.begin(), snr.end(),
+                                refSnr.begin(), refSnr.end());
+}
+
+/** Report the miss rate and CPU time of the coarse search stage.
+ *
+ * 20 noisy frames separated by noise, and the frame-free test signal,
+ * are searched with increasing decimation. Frames which are found must
+ * be found at the same sample as by the full-resolution search.
+ */
+BOOST_AUTO_TEST_CASE(OfdmPreambleDetector_Coarse_Test)
+{
+  typedef OfdmPreambleDetectorTestData  D;
+  typedef std::complex<float>           Cplx;
+  typedef std::vector<Cplx>             CplxVec;
+  typedef CplxVec::iterator             CplxVecIt;
+  namespace bp = boost::posix_time;
+
+  srand(11);
+  CplxVec stream;
+  for(int i=0; i<20; i++)
+  {
+    int gap = 20000+rand()%20000;
+    for(int j=0; j<gap; j++)
+      stream.push_back(Cplx(rand()/(float)RAND_MAX-0.5f,
+                            rand()/(float)RAND_MAX-0.5f)*0.1f);
+    stream.insert(stream.end(), D::preambleTestData2_.begin(),
+                  D::preambleTestData2_.end());
+  }
+
+  CplxVec preamble(272);
+  vector<int> fullIndex;
+  int decimations[] = {1, 2, 4, 8, 16};
+  for(int d=0; d<5; d++)
+  {
+    OfdmPreambleDetector detector;
+    detector.setCoarseSearch(decimations[d], 0.5);
+
+    vector<int> index;
+    bp::ptime t1(bp::microsec_clock::local_time());
+    CplxVecIt it = stream.begin();
+    while(it != stream.end())
+    {
+      OfdmPreambleDetector::Result result;
+      it = detector.search(it, stream.end(), preamble.begin(),
+                           preamble.end(), result);
+      if(result.detected)
+        index.push_back(it-stream.begin());
+    }
+    bp::ptime t2(bp::microsec_clock::local_time());
+    if(d == 0)
+      fullIndex = index;
+
+    int found = 0;
+    for(int i=0; i<index.size(); i++)
+      found += count(fullIndex.begin(), fullIndex.end(), index[i]);
+    BOOST_CHECK_EQUAL(found, index.size());
+
+    OfdmPreambleDetector::Result result;
+    detector.search(D::preambleTestData3_.begin(), D::preambleTestData3_.end(),
+                    preamble.begin(), preamble.end(), result);
+    BOOST_CHECK( !result.detected );
+
+    float missRate = 1 - index.size()/(float)fullIndex.size();
+    float ns = (t2-t1).total_nanoseconds()/(float)stream.size();
+    BOOST_TEST_MESSAGE("Decimation " << decimations[d] << ": miss rate "
+                       << missRate*100 << "%, " << ns << " ns/sample");
+    if(decimations[d] <= 8)
+      BOOST_CHECK( missRate == 0 );
+  }
+  BOOST_CHECK( fullIndex.size() == 20 );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -40,6 +40,7 @@
 #include "OfdmPreambleGenerator.h"
 
 #include "irisapi/TypeInfo.h"
+#include "math/MathDefines.h"
 #include "utility/RawFileUtility.h"
 
 using namespace std;
@@ -77,4 +78,39 @@ BOOST_AUTO_TEST_CASE(OfdmPreambleGenerator_Long_Test)
     BOOST_CHECK(preamble[i] == preamble[i+256]);
 }
 
+BOOST_AUTO_TEST_CASE(OfdmPreambleGenerator_HalfBins_Test)
+{
+  int numData=210;
+  int numPilot=10;
+  int numGuard=35;
+  std::vector< std::complex<float> > preamble(256);
+  std::vector< std::complex<float> > halfBins(128);
+
+  OfdmPreambleGenerator g;
+  g.generatePreamble(numData,numPilot,numGuard,
+                     preamble.begin(),preamble.end());
+  g.generatePreambleHalfBins(numData,numPilot,numGuard,
+                             halfBins.begin(),halfBins.end());
+
+  // Half bin m is full bin 2m, which is empty on odd full bins
+  for(int m=0;m<128;m++)
+  {
+    std::complex<float> sum(0,0);
+    for(int n=0;n<128;n++)
+      sum += preamble[n]*std::polar(1.0f, (float)(-2*IRIS_PI*m*n/128));
+    BOOST_CHECK_SMALL(std::abs(2.0f*sum-halfBins[m]), 1e-3f);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(OfdmPreambleGenerator_Shared_Test)
+{
+  std::vector< std::complex<float> > a(256), b(256);
+
+  OfdmPreambleGenerator g1, g2;
+  BOOST_CHECK(&g1.sequences() == &g2.sequences());
+  g1.generatePreamble(210,10,35,a.begin(),a.end());
+  g2.generatePreamble(210,10,35,b.begin(),b.end());
+  BOOST_CHECK(a == b);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
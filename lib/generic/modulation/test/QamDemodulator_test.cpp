@@ -36,6 +36,8 @@
 #include <boost/test/unit_test.hpp>
 
 #include "QamDemodulator.h"
+#include "QamModulator.h"
+#include <cstdlib>
 
 #include "irisapi/TypeInfo.h"
 
@@ -176,4 +178,247 @@ BOOST_AUTO_TEST_CASE(QamDemodulator_Qam16_Test)
     BOOST_CHECK(output[i] == expected[i]);
 }
 
+/// Branching hard decision slicer for BPSK, QPSK and QAM16, as used before
+/// the table based slicer in QamDemodulator.
+static void referenceDemodulate(const vector< complex<float> >& in,
+                                uint8_t* out, unsigned int M)
+{
+  const uint8_t qam16Lut[] = {15,13,12,14,5,7,6,4,0,2,3,1,10,8,9,11};
+  float biasValues[2] = {2.0f/sqrtf(10.0f), 0.0f};
+  int perByte = 8/M;
+  for(int count=0; count<in.size(); count++)
+  {
+    if(count%perByte == 0 && count != 0)
+      out++;
+    complex<float> x = in[count];
+    if(M == BPSK)
+    {
+      *out = *out<<1 | (x.real() > 0 ? 0 : 1);
+    }
+    else if(M == QPSK)
+    {
+      *out = *out<<2 | (x.real() > 0) << 1 | (x.imag() > 0);
+    }
+    else
+    {
+      int symIndex = 0;
+      int pointsPerQuadrant = 4;
+      for(int j=0; j<2; j++)
+      {
+        float b = biasValues[j];
+        if(x.real() > 0)
+        {
+          if(x.imag() > 0)
+            x += complex<float>(-b,-b);
+          else
+          {
+            x += complex<float>(-b,b);
+            symIndex += 3*pointsPerQuadrant;
+          }
+        }
+        else
+        {
+          if(x.imag() > 0)
+          {
+            x += complex<float>(b,-b);
+            symIndex += pointsPerQuadrant;
+          }
+          else
+          {
+            x += complex<float>(b,b);
+            symIndex += 2*pointsPerQuadrant;
+          }
+        }
+        pointsPerQuadrant >>= 2;
+      }
+      *out = *out<<4 | qam16Lut[symIndex];
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QamDemodulator_Hard_Reference_Test)
+{
+  // Noisy symbols, including zeros and points on the QAM16 decision
+  // boundaries, in blocks which end in partial bytes
+  unsigned int mods[] = {BPSK, QPSK, QAM16};
+  float levels[] = {0.0f, 2.0f/sqrtf(10.0f), -2.0f/sqrtf(10.0f)};
+  QamDemodulator q;
+  for(int m=0; m<3; m++)
+  {
+    unsigned int M = mods[m];
+    for(int num=1; num<200; num+=7)
+    {
+      vector< complex<float> > symbols(num);
+      for(int i=0; i<num; i++)
+      {
+        float re = (rand()/(float)RAND_MAX-0.5f)*3;
+        float im = (rand()/(float)RAND_MAX-0.5f)*3;
+        if(rand()%8 == 0)
+          re = levels[rand()%3];
+        if(rand()%8 == 0)
+          im = levels[rand()%3];
+        symbols[i] = complex<float>(re, im);
+      }
+
+      int numBytes = (num*M+7)/8;
+      vector< uint8_t > output(numBytes), expected(numBytes);
+      for(int i=0; i<numBytes; i++)
+        output[i] = expected[i] = rand() & 0xFF;
+
+      referenceDemodulate(symbols, &expected[0], M);
+      vector< uint8_t >::iterator last = q.demodulate(symbols.begin(),
+                                                      symbols.end(),
+                                                      output.begin(),
+                                                      output.end(), M);
+      BOOST_CHECK(last == output.end());
+      BOOST_CHECK(output == expected);
+    }
+  }
+}
+
+/// Brute force max-log LLRs of one symbol using the modulator's constellation.
+static void bruteForceLlrs(complex<float> x, float weight, unsigned int M,
+                           float* out)
+{
+  QamModulator mod;
+  int numPoints = 1 << M;
+  vector< complex<float> > points(numPoints);
+  for(int p=0; p<numPoints; p++)
+  {
+    // Modulate a byte starting with the M bits of p
+    uint8_t byte = p << (8-M);
+    vector< complex<float> > symbols((8+M-1)/M);
+    mod.modulate(&byte, &byte+1, symbols.begin(), symbols.end(), M);
+    points[p] = symbols[0];
+  }
+  for(int b=0; b<M; b++)
+  {
+    float min0 = 1e30f, min1 = 1e30f;
+    for(int p=0; p<numPoints; p++)
+    {
+      float dist = norm(x-points[p]);
+      if((p >> (M-1-b)) & 1)
+        min1 = min(min1, dist);
+      else
+        min0 = min(min0, dist);
+    }
+    out[b] = (min1-min0)*weight;
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QamDemodulator_Square_Test)
+{
+  // Random data through QAM64 and QAM256, including symbols beyond the
+  // outer levels of the constellation
+  unsigned int mods[] = {QAM64, QAM256};
+  vector< uint8_t > data(96);
+  for(int i=0; i<data.size(); i++)
+    data[i] = rand() & 0xFF;
+
+  QamModulator mod;
+  QamDemodulator q;
+  for(int m=0; m<2; m++)
+  {
+    unsigned int M = mods[m];
+    int num = data.size()*8/M;
+    vector< complex<float> > symbols(num);
+    mod.modulate(data.begin(), data.end(), symbols.begin(), symbols.end(), M);
+    for(int i=0; i<num; i++)
+      symbols[i] *= 1.05f;
+
+    vector< uint8_t > output(data.size());
+    BOOST_CHECK_NO_THROW(q.demodulate(symbols.begin(), symbols.end(),
+                                      output.begin(), output.end(), M));
+    BOOST_CHECK(output == data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QamDemodulator_Soft_Test)
+{
+  unsigned int mods[] = {BPSK, QPSK, QAM16, QAM64, QAM256};
+  int num = 37; // Not a multiple of the vector width
+
+  QamDemodulator q;
+  for(int m=0; m<5; m++)
+  {
+    unsigned int M = mods[m];
+    vector< complex<float> > input(num);
+    vector< float > weights(num);
+    for(int i=0; i<num; i++)
+    {
+      input[i] = complex<float>(rand()/(float)RAND_MAX*2.4f-1.2f,
+                                rand()/(float)RAND_MAX*2.4f-1.2f);
+      weights[i] = rand()/(float)RAND_MAX*10;
+    }
+
+    vector< float > llrs(num*M);
+    q.demodulateSoft(&input[0], &weights[0], num, &llrs[0], M);
+
+    float expected[QAM256];
+    for(int i=0; i<num; i++)
+    {
+      bruteForceLlrs(input[i], weights[i], M, expected);
+      for(int b=0; b<M; b++)
+        BOOST_CHECK_SMALL(llrs[i*M+b]-expected[b], 1e-4f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QamDemodulator_Soft_Hard_Test)
+{
+  // The sign of each LLR must agree with the hard decision
+  unsigned int mods[] = {BPSK, QPSK, QAM16, QAM64, QAM256};
+  vector< uint8_t > data(48); // A whole number of symbols for every M
+  for(int i=0; i<data.size(); i++)
+    data[i] = rand() & 0xFF;
+
+  QamModulator mod;
+  QamDemodulator q;
+  for(int m=0; m<5; m++)
+  {
+    unsigned int M = mods[m];
+    int num = data.size()*8/M;
+    vector< complex<float> > symbols(num);
+    mod.modulate(data.begin(), data.end(), symbols.begin(), symbols.end(), M);
+    float noise = (M == QAM256) ? 0.05f : 0.1f;
+    for(int i=0; i<num; i++)
+      symbols[i] += complex<float>((rand()/(float)RAND_MAX*2-1)*noise,
+                                   (rand()/(float)RAND_MAX*2-1)*noise);
+
+    // Dense constellations need a larger weight to keep int8 LLRs nonzero
+    vector< float > weights(num, (M >= QAM64) ? 100.0f : 1.0f);
+    vector< float > llrs(num*M);
+    vector< int8_t > softBytes(num*M);
+    q.demodulateSoft(&symbols[0], &weights[0], num, &llrs[0], M);
+    q.demodulateSoft(&symbols[0], &weights[0], num, &softBytes[0], M, 8.0f);
+
+    vector< uint8_t > hard(data.size());
+    q.demodulate(symbols.begin(), symbols.end(), hard.begin(), hard.end(), M);
+
+    for(int i=0; i<num*M; i++)
+    {
+      bool bit = (hard[i/8] >> (7-i%8)) & 1;
+      BOOST_CHECK((llrs[i] < 0) == bit);
+      BOOST_CHECK((softBytes[i] < 0) == bit);
+      float scaled = max(-127.0f, min(127.0f, llrs[i]*8.0f));
+      BOOST_CHECK_SMALL(softBytes[i]-scaled, 0.5f+1e-3f);
+    }
+    BOOST_CHECK(hard == data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QamDemodulator_Soft_Saturate_Test)
+{
+  vector< complex<float> > input(20, complex<float>(1,0));
+  input[1] = complex<float>(-1,0);
+  vector< float > weights(20, 1000.0f);
+  vector< int8_t > out(20);
+
+  QamDemodulator q;
+  q.demodulateSoft(&input[0], &weights[0], 20, &out[0], BPSK, 1.0f);
+  BOOST_CHECK(out[0] == 127);
+  BOOST_CHECK(out[1] == -127);
+  BOOST_CHECK(out[19] == 127);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
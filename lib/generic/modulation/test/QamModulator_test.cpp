@@ -167,4 +167,132 @@ BOOST_AUTO_TEST_CASE(QamModulator_Qam16_Test)
     BOOST_CHECK(output[i] == vec[i]);
 }
 
+BOOST_AUTO_TEST_CASE(QamModulator_Square_Test)
+{
+  unsigned int mods[] = {QAM16, QAM64, QAM256};
+  QamModulator q;
+  for(int m=0; m<3; m++)
+  {
+    unsigned int M = mods[m];
+    int numPoints = 1 << M;
+
+    // Find each point of the constellation from its bits
+    vector< complex<float> > points(numPoints);
+    for(int p=0; p<numPoints; p++)
+    {
+      uint8_t byte = p << (8-M);
+      vector< complex<float> > output((8+M-1)/M);
+      BOOST_CHECK_NO_THROW(q.modulate(&byte, &byte+1,
+                                      output.begin(), output.end(), M));
+      points[p] = output[0];
+    }
+
+    // Unit average energy, and nearest neighbours differ in one bit
+    float energy = 0;
+    float minDist = 1e30f;
+    for(int p=0; p<numPoints; p++)
+    {
+      energy += norm(points[p]);
+      for(int r=0; r<p; r++)
+        minDist = min(minDist, abs(points[p]-points[r]));
+    }
+    BOOST_CHECK_CLOSE(energy/numPoints, 1.0f, 1e-3);
+    for(int p=0; p<numPoints; p++)
+    {
+      for(int r=0; r<p; r++)
+      {
+        if(abs(points[p]-points[r]) > minDist*1.01f)
+          continue;
+        int diff = p^r;
+        BOOST_CHECK((diff & (diff-1)) == 0);
+      }
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(QamModulator_Qam64_Pad_Test)
+{
+  // 16 bits give two full symbols and one padded with zeros
+  uint8_t input[] = {0xFF, 0xFF};
+  vector< complex<float> > output(3);
+
+  QamModulator q;
+  BOOST_CHECK_NO_THROW(q.modulate(begin(input), end(input),
+                                  output.begin(), output.end(),
+                                  QAM64));
+
+  uint8_t full[] = {0xFF, 0xFF, 0xFF};
+  uint8_t padded[] = {0xFF, 0xFF, 0x00};
+  vector< complex<float> > fullOut(4), paddedOut(4);
+  q.modulate(begin(full), end(full), fullOut.begin(), fullOut.end(), QAM64);
+  q.modulate(begin(padded), end(padded),
+             paddedOut.begin(), paddedOut.end(), QAM64);
+  BOOST_CHECK(output[0] == fullOut[0]);
+  BOOST_CHECK(output[1] == fullOut[1]);
+  BOOST_CHECK(output[2] == paddedOut[2]);
+}
+
+BOOST_AUTO_TEST_CASE(QamModulator_Template_Test)
+{
+  // Every byte modulates the same with compile-time and runtime depths
+  vector<uint8_t> input(256);
+  for(int i=0; i<256; i++)
+    input[i] = i;
+
+  QamModulator q;
+  vector< complex<float> > a(256*8), b(256*8);
+  q.modulate<BPSK>(input.begin(), input.end(), a.begin(), a.end());
+  q.modulate(input.begin(), input.end(), b.begin(), b.end(), BPSK);
+  BOOST_CHECK(a == b);
+  q.modulate<QPSK>(input.begin(), input.end(), a.begin(), a.end());
+  q.modulate(input.begin(), input.end(), b.begin(), b.end(), QPSK);
+  BOOST_CHECK(a == b);
+  q.modulate<QAM16>(input.begin(), input.end(), a.begin(), a.end());
+  q.modulate(input.begin(), input.end(), b.begin(), b.end(), QAM16);
+  BOOST_CHECK(a == b);
+  q.modulate<QAM256>(input.begin(), input.end(), a.begin(), a.end());
+  q.modulate(input.begin(), input.end(), b.begin(), b.end(), QAM256);
+  BOOST_CHECK(a == b);
+
+  // Symbols of each byte come from its most significant bits first
+  uint8_t byte[] = {0x4B};
+  q.modulate<QAM16>(begin(byte), end(byte), a.begin(), a.end());
+  uint8_t nibbles[] = {0x44, 0xBB};
+  q.modulate<QAM16>(begin(nibbles), end(nibbles), b.begin(), b.end());
+  BOOST_CHECK(a[0] == b[0]);
+  BOOST_CHECK(a[1] == b[2]);
+}
+
+BOOST_AUTO_TEST_CASE(QamModulator_Mapped_Test)
+{
+  uint8_t input[] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xAB};
+  int indices[] = {9, 1, 7, 3, 5, 11};
+
+  QamModulator q;
+  int depths[] = {QAM16, QAM256};
+  for(int d=0; d<2; d++)
+  {
+    // Six symbols, one per index
+    int numBytes = 6*depths[d]/8;
+    vector< complex<float> > symbols(6);
+    q.modulate(begin(input), begin(input)+numBytes,
+               symbols.begin(), symbols.end(), depths[d]);
+
+    vector< complex<float> > bins(12);
+    int* last = q.modulateMapped(begin(input), begin(input)+numBytes,
+                                 bins.begin(), begin(indices), end(indices),
+                                 depths[d]);
+    BOOST_CHECK(last == end(indices));
+    for(int i=0; i<6; i++)
+      BOOST_CHECK(bins[indices[i]] == symbols[i]);
+    BOOST_CHECK(bins[0] == complex<float>(0,0));
+  }
+
+  // Too few indices for the symbols
+  vector< complex<float> > bins(12);
+  BOOST_CHECK_THROW(q.modulateMapped(begin(input), end(input), bins.begin(),
+                                     begin(indices), end(indices), QPSK),
+                    IrisException);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,103 @@
+/**
+ * \file lib/generic/modulation/WhitenCrc_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for WhitenCrc class.
+ */
+
+#define BOOST_TEST_MODULE WhitenCrc_Test
+
+#include "WhitenCrc.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdlib>
+#include <vector>
+#include "irisapi/TypeInfo.h"
+
+using namespace std;
+using namespace iris;
+
+BOOST_AUTO_TEST_SUITE (WhitenCrc_Test)
+
+BOOST_AUTO_TEST_CASE(WhitenCrc_Transmit_Test)
+{
+  // Matches generating the crc and whitening separately, leaving the input
+  // untouched
+  int lengths[] = {0, 1, 7, 100, 1024, 1500, 4096, 10000};
+  for(int l=0; l<8; l++)
+  {
+    vector< uint8_t > data(lengths[l]);
+    for(int i=0; i<data.size(); ++i)
+      data[i] = rand() & 0xFF;
+    vector< uint8_t > input(data), out(data.size());
+
+    uint32_t expected = Crc::generate(data.begin(), data.end());
+    Whitener::whiten(data.begin(), data.end());
+
+    const uint8_t* in = input.empty() ? NULL : &input[0];
+    uint8_t* outPtr = out.empty() ? NULL : &out[0];
+    BOOST_CHECK_EQUAL(WhitenCrc::crcThenWhiten(in, in+input.size(), outPtr),
+                      expected);
+    BOOST_CHECK(out == data);
+
+    // In place
+    vector< uint8_t > copy(input);
+    uint8_t* c = copy.empty() ? NULL : &copy[0];
+    BOOST_CHECK_EQUAL(WhitenCrc::crcThenWhiten(c, c+copy.size(), c), expected);
+    BOOST_CHECK(copy == data);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(WhitenCrc_Receive_Test)
+{
+  // Undoes crcThenWhiten and gives the same crc
+  int lengths[] = {1, 63, 1025, 4097, 9000};
+  for(int l=0; l<5; l++)
+  {
+    vector< uint8_t > data(lengths[l]), whitened(data.size()), out(data.size());
+    for(int i=0; i<data.size(); ++i)
+      data[i] = rand() & 0xFF;
+
+    uint32_t crc = WhitenCrc::crcThenWhiten(&data[0], &data[0]+data.size(),
+                                            &whitened[0]);
+    BOOST_CHECK_EQUAL(WhitenCrc::whitenThenCrc(&whitened[0],
+                                               &whitened[0]+data.size(),
+                                               &out[0]), crc);
+    BOOST_CHECK(out == data);
+
+    // In place, as in the demodulator
+    BOOST_CHECK_EQUAL(WhitenCrc::whitenThenCrc(&whitened[0],
+                                               &whitened[0]+data.size(),
+                                               &whitened[0]), crc);
+    BOOST_CHECK(whitened == data);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
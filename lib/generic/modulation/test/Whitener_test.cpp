@@ -37,6 +37,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <cstdlib>
 #include "irisapi/TypeInfo.h"
 
 using namespace std;
@@ -67,4 +68,39 @@ BOOST_AUTO_TEST_CASE(Whitener_Test)
     BOOST_CHECK(data[i] == i%256);
 }
 
+BOOST_AUTO_TEST_CASE(Whitener_Soft_Test)
+{
+  // Soft whitening must flip exactly the LLRs of the bits whiten() flips
+  vector< uint8_t > data(100, 0);
+  vector< float > llrs(data.size()*8, 1.0f);
+
+  Whitener::whiten(data.begin(), data.end());
+  Whitener::whitenSoft(llrs.begin(), llrs.end());
+
+  for(int i=0; i<llrs.size(); i++)
+  {
+    bool flipped = (data[i/8] >> (7-i%8)) & 1;
+    BOOST_CHECK(llrs[i] == (flipped ? -1.0f : 1.0f));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(Whitener_Offset_Test)
+{
+  // Whitening into a separate buffer, starting part way through the code
+  vector< uint8_t > data(9000);
+  for(int i=0; i<data.size(); ++i)
+    data[i] = rand() & 0xFF;
+
+  int offsets[] = {0, 1, 13, 4095, 4096, 5000};
+  for(int o=0; o<6; o++)
+  {
+    int offset = offsets[o];
+    vector< uint8_t > out(data.size()-3);
+    Whitener::whiten(&data[3], &data[0]+data.size(), &out[0], offset);
+    for(int i=0; i<out.size(); i++)
+      BOOST_CHECK(out[i] == (data[i+3] ^
+                             whitenerdetail::whitenCode[(i+offset)%4096]));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,340 @@
+/**
+ * \file lib/generic/utility/DebugCapture.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Capture of debug data from a processing chain without slowing it down.
+ * Data is copied into a bounded ring of records and written to a single
+ * file by a background thread.
+ */
+
+#ifndef UTILITY_DEBUGCAPTURE_H_
+#define UTILITY_DEBUGCAPTURE_H_
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <boost/scoped_ptr.hpp>
+#include <boost/thread.hpp>
+
+#include "irisapi/Exceptions.h"
+#include "irisapi/TypeInfo.h"
+
+namespace iris
+{
+
+/** Capture debug data from the stages of a processing chain.
+ *
+ * Each call to capture() copies one record into a free slot of a ring
+ * and returns. The slot is only claimed under a lock, the copy is not,
+ * and if the ring is full the record is dropped and counted rather than
+ * blocking the caller. A background thread appends the records, in the
+ * order in which their slots were claimed, to a single file.
+ *
+ * Records are indexed by stage, frame and index (e.g. symbol number) and
+ * only captured for the stages enabled in a mask and for one in every
+ * frameInterval frames. Callers should check wants() before gathering
+ * any data which is only needed for capture.
+ *
+ * The file starts with the magic "IRISCAP", a version and the stage names.
+ * Each record is a header (stage, element size, frame, index, number of
+ * bytes) followed by its data, all in native byte order. Use read() to
+ * load a file.
+ */
+class DebugCapture
+{
+ public:
+  /// A record read back from a capture file.
+  struct Record
+  {
+    uint32_t stage;           ///< Index of the stage which captured it.
+    uint32_t elementSize;     ///< Size in bytes of each element.
+    uint64_t frame;           ///< Frame number.
+    uint32_t index;           ///< Index within the frame (e.g. symbol).
+    std::vector<char> data;   ///< Captured data.
+  };
+
+  DebugCapture()
+    :stageMask_(0)
+    ,frameInterval_(1)
+    ,slotBytes_(0)
+    ,head_(0)
+    ,tail_(0)
+    ,numDropped_(0)
+    ,stop_(false)
+  {}
+
+  ~DebugCapture()
+  {
+    close();
+  }
+
+  /** Start capturing to a file.
+   *
+   * @param fileName        File to write. Any existing file is replaced.
+   * @param stageNames      Name of each stage, at most 32.
+   * @param stageMask       Bit i enables capture for stage i.
+   * @param frameInterval   Capture one in every frameInterval frames.
+   * @param numSlots        Number of records the ring can hold.
+   * @param slotBytes       Largest record which can be captured.
+   */
+  void open(const std::string& fileName,
+            const std::vector<std::string>& stageNames,
+            uint32_t stageMask,
+            int frameInterval,
+            int numSlots,
+            int slotBytes)
+  {
+    close();
+    if(stageNames.size() > 32)
+      throw IrisException("DebugCapture supports at most 32 stages.");
+    if(frameInterval < 1 || numSlots < 1 || slotBytes < 1)
+      throw IrisException("Invalid DebugCapture configuration.");
+
+    file_.open(fileName.c_str(), std::ios::binary | std::ios::trunc);
+    if(!file_.is_open())
+      throw IrisException("Failed to open debug capture file " + fileName);
+
+    uint32_t version = 1;
+    uint32_t numStages = stageNames.size();
+    file_.write("IRISCAP", 8);
+    file_.write((const char*)&version, sizeof(version));
+    file_.write((const char*)&numStages, sizeof(numStages));
+    for(int i=0; i<stageNames.size(); i++)
+    {
+      uint32_t len = stageNames[i].size();
+      file_.write((const char*)&len, sizeof(len));
+      file_.write(stageNames[i].data(), len);
+    }
+
+    stageMask_ = stageMask;
+    frameInterval_ = frameInterval;
+    slotBytes_ = slotBytes;
+    slots_.assign(numSlots, Slot());
+    storage_.assign((size_t)numSlots*slotBytes, 0);
+    head_ = tail_ = 0;
+    numDropped_ = 0;
+    stop_ = false;
+    writer_.reset(new boost::thread(&DebugCapture::writerThreadFunction,
+                                    this));
+  }
+
+  /// Write all captured records and close the file.
+  void close()
+  {
+    if(!writer_)
+      return;
+    {
+      boost::lock_guard< boost::mutex > lock(mutex_);
+      stop_ = true;
+    }
+    recordReady_.notify_all();
+    writer_->join();
+    writer_.reset();
+    file_.close();
+  }
+
+  /// Is a capture file open?
+  bool isOpen() const { return writer_.get() != NULL; }
+
+  /// Would a record for this stage and frame be captured?
+  bool wants(int stage, uint64_t frame) const
+  {
+    return writer_ && ((stageMask_ >> stage) & 1) &&
+           frame % frameInterval_ == 0;
+  }
+
+  /** Capture a record.
+   *
+   * @param stage   Index of the capturing stage.
+   * @param frame   Frame number.
+   * @param index   Index within the frame (e.g. symbol number).
+   * @param begin   Pointer to the first element.
+   * @param end     Pointer to one past the last element.
+   * @return        False if the record was not wanted or was dropped.
+   */
+  template <class T>
+  bool capture(int stage, uint64_t frame, int index,
+               const T* begin, const T* end)
+  {
+    if(!wants(stage, frame))
+      return false;
+    return capture(stage, frame, index, sizeof(T),
+                   (const char*)begin, (end-begin)*sizeof(T));
+  }
+
+  /// Number of records dropped because the ring was full or they were too big.
+  int getNumDropped()
+  {
+    boost::lock_guard< boost::mutex > lock(mutex_);
+    return numDropped_;
+  }
+
+  /** Read a capture file.
+   *
+   * @param fileName    File to read.
+   * @param stageNames  Filled with the stage names.
+   * @param records     Filled with the records in file order.
+   */
+  static void read(const std::string& fileName,
+                   std::vector<std::string>& stageNames,
+                   std::vector<Record>& records)
+  {
+    std::ifstream in(fileName.c_str(), std::ios::binary);
+    char magic[8];
+    uint32_t version = 0, numStages = 0;
+    in.read(magic, 8);
+    in.read((char*)&version, sizeof(version));
+    in.read((char*)&numStages, sizeof(numStages));
+    if(!in || std::string(magic, 8) != std::string("IRISCAP", 8) || version != 1)
+      throw IrisException("Invalid debug capture file " + fileName);
+
+    stageNames.resize(numStages);
+    for(int i=0; i<numStages; i++)
+    {
+      uint32_t len = 0;
+      in.read((char*)&len, sizeof(len));
+      stageNames[i].resize(len);
+      if(len > 0)
+        in.read(&stageNames[i][0], len);
+    }
+
+    records.clear();
+    RecordHeader h;
+    while(in.read((char*)&h, sizeof(h)))
+    {
+      Record r;
+      r.stage = h.stage;
+      r.elementSize = h.elementSize;
+      r.frame = h.frame;
+      r.index = h.index;
+      r.data.resize(h.numBytes);
+      if(h.numBytes > 0)
+        in.read(&r.data[0], h.numBytes);
+      records.push_back(r);
+    }
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "DebugCapture"; }
+
+ private:
+  /// Header written before the data of each record.
+  struct RecordHeader
+  {
+    uint32_t stage;
+    uint32_t elementSize;
+    uint64_t frame;
+    uint32_t index;
+    uint32_t numBytes;
+  };
+
+  /// A slot in the ring.
+  struct Slot
+  {
+    enum State {FREE, WRITING, READY};
+    Slot() : state(FREE) {}
+    State state;
+    RecordHeader header;
+  };
+
+  bool capture(int stage, uint64_t frame, int index, int elementSize,
+               const char* data, size_t numBytes)
+  {
+    int s;
+    {
+      boost::lock_guard< boost::mutex > lock(mutex_);
+      if(numBytes > slotBytes_ || slots_[head_].state != Slot::FREE)
+      {
+        numDropped_++;
+        return false;
+      }
+      s = head_;
+      slots_[s].state = Slot::WRITING;
+      head_ = (head_+1)%slots_.size();
+    }
+
+    RecordHeader& h = slots_[s].header;
+    h.stage = stage;
+    h.elementSize = elementSize;
+    h.frame = frame;
+    h.index = index;
+    h.numBytes = numBytes;
+    memcpy(&storage_[(size_t)s*slotBytes_], data, numBytes);
+
+    {
+      boost::lock_guard< boost::mutex > lock(mutex_);
+      slots_[s].state = Slot::READY;
+    }
+    recordReady_.notify_one();
+    return true;
+  }
+
+  /// Append records to the file in slot order until closed.
+  void writerThreadFunction()
+  {
+    boost::unique_lock< boost::mutex > lock(mutex_);
+    while(true)
+    {
+      while(slots_[tail_].state != Slot::READY && !stop_)
+        recordReady_.wait(lock);
+      if(slots_[tail_].state != Slot::READY)
+        break;
+
+      int s = tail_;
+      lock.unlock();
+      const RecordHeader& h = slots_[s].header;
+      file_.write((const char*)&h, sizeof(h));
+      file_.write(&storage_[(size_t)s*slotBytes_], h.numBytes);
+      lock.lock();
+
+      slots_[s].state = Slot::FREE;
+      tail_ = (tail_+1)%slots_.size();
+    }
+    file_.flush();
+  }
+
+  uint32_t stageMask_;          ///< Bit i enables stage i.
+  int frameInterval_;           ///< Capture one in this many frames.
+  size_t slotBytes_;            ///< Capacity of each slot.
+  std::vector<Slot> slots_;     ///< Ring of record headers.
+  std::vector<char> storage_;   ///< Data of each slot.
+  int head_;                    ///< Next slot to be claimed.
+  int tail_;                    ///< Next slot to be written.
+  int numDropped_;              ///< Count of dropped records.
+  bool stop_;                   ///< Should the writer stop?
+  std::ofstream file_;          ///< The capture file.
+  boost::mutex mutex_;
+  boost::condition_variable recordReady_;
+  boost::scoped_ptr< boost::thread > writer_;
+};
+
+} // namespace iris
+
+#endif // UTILITY_DEBUGCAPTURE_H_
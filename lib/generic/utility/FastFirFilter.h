@@ -0,0 +1,318 @@
+/**
+ * \file FastFirFilter.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * FIR filtering of complex samples with fast convolution.
+ *
+ * Long filters are applied by overlap-save: each block of input is
+ * transformed together with the end of the previous one, multiplied
+ * by the spectrum of the taps and transformed back. Short filters, for
+ * which the transforms cost more than the taps, are applied directly.
+ */
+
+#ifndef UTILITY_FASTFIRFILTER_H_
+#define UTILITY_FASTFIRFILTER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <string>
+#include <vector>
+
+#include "fftw3.h"
+#include "irisapi/Exceptions.h"
+#include "math/FftwPlanner.h"
+#include "utility/FirEngine.h"
+
+namespace iris
+{
+
+/** An FIR filter of complex samples using direct or fast convolution.
+ *
+ * With fast convolution the filter of numTaps taps uses ffts of length
+ * N, a power of two, and filters N-numTaps+1 new samples with each pair
+ * of transforms. The last numTaps-1 samples of each block are kept to
+ * be transformed again with the next one.
+ *
+ * Every input sample gives one output, without delay. A block which is
+ * only partly filled at the end of a call to filter() is transformed
+ * with zeros in place of its missing samples, which gives the exact
+ * outputs of the samples it has, and is transformed again once full.
+ * Calls with at least a block of samples avoid this extra work.
+ *
+ * With AUTO the method and fft length are chosen by counting the
+ * multiplies per output. Direct convolution costs one per tap. A pair
+ * of transforms of length N is counted as 2*N*log2(N) + 4*N and shared
+ * by the outputs of a block: N-numTaps+1, or fewer if filter() is
+ * usually called with less than that.
+ *
+ * @tparam CoeffT   Tap type, float or std::complex<float>.
+ */
+template<class CoeffT = float>
+class FastFirFilter
+{
+ public:
+  typedef std::complex<float> Cplx;
+
+  /// Convolution method.
+  enum Method
+  {
+    AUTO,     ///< Direct or fft, whichever needs fewer multiplies.
+    DIRECT,   ///< Direct convolution with FirEngine.
+    FFT       ///< Overlap-save fast convolution.
+  };
+
+  /// Longest fft considered with AUTO.
+  static const int maxFftLength = 65536;
+
+  FastFirFilter()
+    :fftLength_(0), historyLength_(0), step_(0), filled_(0), done_(0),
+     time_(NULL), bins_(NULL), forward_(NULL), backward_(NULL)
+  {}
+
+  /** Construct a filter with the given taps.
+   *
+   * @param begin         Iterator to the first tap.
+   * @param end           Iterator to one past the last tap.
+   * @param blockLength   Typical number of samples per call to filter(),
+   *                      or 0 if unknown.
+   * @param method        Convolution method.
+   * @param rigor         Rigor of fft planning.
+   * @param wisdomFile    File used to store fftw wisdom, or empty for none.
+   */
+  template<class It>
+  FastFirFilter(It begin, It end,
+                int blockLength = 0,
+                Method method = AUTO,
+                const std::string& rigor = "estimate",
+                const std::string& wisdomFile = "")
+    :fftLength_(0), historyLength_(0), step_(0), filled_(0), done_(0),
+     time_(NULL), bins_(NULL), forward_(NULL), backward_(NULL)
+  {
+    setCoeffs(begin, end, blockLength, method, rigor, wisdomFile);
+  }
+
+  ~FastFirFilter()
+  {
+    destroy();
+  }
+
+  /** Set the taps of the filter and clear its history.
+   *
+   * Parameters are as for the constructor.
+   */
+  template<class It>
+  void setCoeffs(It begin, It end,
+                 int blockLength = 0,
+                 Method method = AUTO,
+                 const std::string& rigor = "estimate",
+                 const std::string& wisdomFile = "")
+  {
+    destroy();
+    std::vector<CoeffT> coeffs(begin, end);
+    int numTaps = coeffs.size();
+    if(numTaps == 0)
+      throw IrisException("FastFirFilter needs at least one tap.");
+
+    if(method == DIRECT)
+      fftLength_ = 0;
+    else if(method == FFT)
+      fftLength_ = fftLengthFor(numTaps, blockLength, true);
+    else
+      fftLength_ = fftLengthFor(numTaps, blockLength, false);
+
+    if(fftLength_ == 0)
+    {
+      direct_.setTaps(coeffs.begin(), coeffs.end());
+      direct_.reset();
+      return;
+    }
+
+    int n = fftLength_;
+    historyLength_ = numTaps-1;
+    step_ = n-historyLength_;
+    filled_ = done_ = 0;
+    time_ = reinterpret_cast<Cplx*>(fftwf_malloc(sizeof(fftwf_complex)*n));
+    bins_ = reinterpret_cast<Cplx*>(fftwf_malloc(sizeof(fftwf_complex)*n));
+    forward_ = FftwPlanner::planDft1d(n, (fftwf_complex*)bins_,
+                                      (fftwf_complex*)bins_, FFTW_FORWARD,
+                                      rigor, wisdomFile);
+    backward_ = FftwPlanner::planDft1d(n, (fftwf_complex*)bins_,
+                                       (fftwf_complex*)bins_, FFTW_BACKWARD,
+                                       rigor, wisdomFile);
+
+    // Spectrum of the taps, including the 1/N of the inverse transform
+    std::fill(bins_, bins_+n, Cplx(0,0));
+    for(int i=0; i<numTaps; i++)
+      bins_[i] = Cplx(coeffs[i])/(float)n;
+    fftwf_execute(forward_);
+    taps_.assign(bins_, bins_+n);
+
+    std::fill(time_, time_+n, Cplx(0,0));
+  }
+
+  /// Clear the history of the filter.
+  void reset()
+  {
+    if(fftLength_ == 0)
+    {
+      direct_.reset();
+      return;
+    }
+    std::fill(time_, time_+fftLength_, Cplx(0,0));
+    filled_ = done_ = 0;
+  }
+
+  /// Whether fast convolution is used.
+  bool usesFft() const { return fftLength_ > 0; }
+
+  /// Length of the ffts, or 0 with direct convolution.
+  int fftLength() const { return fftLength_; }
+
+  /** Filter a sequence of samples.
+   *
+   * @param in      Iterator to the first input sample.
+   * @param inEnd   Iterator to one past the last input sample.
+   * @param out     Iterator to the first output sample.
+   * @return        Iterator to one past the last output sample.
+   */
+  template<class InIt, class OutIt>
+  OutIt filter(InIt in, InIt inEnd, OutIt out)
+  {
+    if(fftLength_ == 0)
+      return direct_.filter(in, inEnd, out);
+
+    Cplx* block = time_+historyLength_;
+    while(in != inEnd)
+    {
+      for(; filled_<step_ && in != inEnd; filled_++)
+        block[filled_] = *in++;
+
+      // Transform the history and the samples we have, zero padded
+      int numValid = historyLength_+filled_;
+      std::copy(time_, time_+numValid, bins_);
+      std::fill(bins_+numValid, bins_+fftLength_, Cplx(0,0));
+      fftwf_execute(forward_);
+      multiply(bins_, &taps_[0], fftLength_);
+      fftwf_execute(backward_);
+      out = std::copy(bins_+historyLength_+done_, bins_+numValid, out);
+      done_ = filled_;
+
+      // Keep the end of a full block as the history of the next
+      if(filled_ == step_)
+      {
+        std::copy(time_+step_, time_+fftLength_, time_);
+        filled_ = done_ = 0;
+      }
+    }
+    return out;
+  }
+
+  /** Choose the fft length for a filter.
+   *
+   * @param numTaps       Number of taps.
+   * @param blockLength   Typical number of samples per call to filter(),
+   *                      or 0 if unknown.
+   * @param force         Choose an fft length even if direct convolution
+   *                      needs fewer multiplies.
+   * @return              The fft length, or 0 for direct convolution.
+   */
+  static int fftLengthFor(int numTaps, int blockLength, bool force)
+  {
+    double best = force ? 1e300 : numTaps;
+    int bestLength = 0;
+    for(int n=2; n<=maxFftLength; n*=2)
+    {
+      int step = n-numTaps+1;
+      if(step < 1)
+        continue;
+      if(blockLength > 0)
+        step = std::min(step, blockLength);
+      double cost = (2.0*n*log((double)n)/log(2.0) + 4.0*n)/step;
+      if(cost < best)
+      {
+        best = cost;
+        bestLength = n;
+      }
+    }
+    if(force && bestLength == 0)
+      throw IrisException("Too many taps for FastFirFilter fft convolution.");
+    return bestLength;
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "FastFirFilter"; }
+
+ private:
+  FastFirFilter(const FastFirFilter&);
+  FastFirFilter& operator=(const FastFirFilter&);
+
+  /// Multiply x by y in place, avoiding the checks of std::complex.
+  static void multiply(Cplx* x, const Cplx* y, int n)
+  {
+    float* a = reinterpret_cast<float*>(x);
+    const float* b = reinterpret_cast<const float*>(y);
+    for(int i=0; i<2*n; i+=2)
+    {
+      float re = a[i]*b[i] - a[i+1]*b[i+1];
+      float im = a[i]*b[i+1] + a[i+1]*b[i];
+      a[i] = re;
+      a[i+1] = im;
+    }
+  }
+
+  void destroy()
+  {
+    FftwPlanner::destroyPlan(forward_);
+    FftwPlanner::destroyPlan(backward_);
+    if(time_ != NULL)
+      fftwf_free(time_);
+    if(bins_ != NULL)
+      fftwf_free(bins_);
+    forward_ = backward_ = NULL;
+    time_ = bins_ = NULL;
+    fftLength_ = 0;
+  }
+
+  int fftLength_;       ///< Length of the ffts, 0 for direct convolution.
+  int historyLength_;   ///< Samples kept from the previous block.
+  int step_;            ///< New samples per block.
+  int filled_;          ///< New samples in the current block.
+  int done_;            ///< Samples of the current block already output.
+  Cplx* time_;          ///< History followed by the current block.
+  Cplx* bins_;          ///< Fft input and output.
+  std::vector<Cplx> taps_;  ///< Spectrum of the taps, scaled by 1/N.
+  fftwf_plan forward_;
+  fftwf_plan backward_;
+  FirEngine<Cplx, CoeffT, Cplx> direct_;  ///< Used without fft.
+};
+
+} // namespace iris
+
+#endif // UTILITY_FASTFIRFILTER_H_
@@ -0,0 +1,445 @@
+/**
+ * \file FirEngine.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Block-based FIR filtering with SIMD dot products.
+ *
+ * Input is filtered a block at a time. Each block is appended to the
+ * history of the filter in a single contiguous buffer, so the samples
+ * under the taps for any output are one contiguous window and each
+ * output is a single dot product with the time-reversed taps.
+ */
+
+#ifndef UTILITY_FIRENGINE_H_
+#define UTILITY_FIRENGINE_H_
+
+#include <algorithm>
+#include <complex>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IRIS_FIRENGINE_SSE2
+#endif
+
+namespace iris
+{
+
+namespace firdetail
+{
+
+/** Time-reversed taps and their dot product with a window of samples.
+ *
+ * The generic kernel works with any types for which OutT += InT*CoeffT
+ * is defined. Kernels for float and std::complex<float> samples store
+ * their taps as floats laid out to match the interleaved samples.
+ */
+template<class InT, class CoeffT, class OutT>
+struct FirKernel
+{
+  std::vector<CoeffT> taps;
+
+  /// Set n time-reversed taps.
+  void setTaps(const CoeffT* reversed, int n)
+  {
+    taps.assign(reversed, reversed+n);
+  }
+
+  /// Dot product of the taps with the samples starting at x.
+  OutT dot(const InT* x) const
+  {
+    OutT sum = OutT();
+    for(size_t i=0; i<taps.size(); i++)
+      sum += x[i]*taps[i];
+    return sum;
+  }
+};
+
+#ifdef IRIS_FIRENGINE_SSE2
+/// Sum of the four floats of v.
+inline float hsum(__m128 v)
+{
+  __m128 s = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, _MM_SHUFFLE(1,1,1,1)));
+  return _mm_cvtss_f32(s);
+}
+
+/// Sum of the two complex numbers held in v.
+inline std::complex<float> csum(__m128 v)
+{
+  float out[4];
+  _mm_storeu_ps(out, _mm_add_ps(v, _mm_movehl_ps(v, v)));
+  return std::complex<float>(out[0], out[1]);
+}
+#endif
+
+/// Real taps on real samples.
+template<>
+struct FirKernel<float, float, float>
+{
+  std::vector<float> taps;
+
+  void setTaps(const float* reversed, int n)
+  {
+    taps.assign(reversed, reversed+n);
+  }
+
+  float dot(const float* x) const
+  {
+    const float* t = taps.empty() ? NULL : &taps[0];
+    int n = taps.size();
+    int i = 0;
+    float sum = 0;
+#ifdef IRIS_FIRENGINE_SSE2
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for(; i+8<=n; i+=8)
+    {
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x+i), _mm_loadu_ps(t+i)));
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x+i+4), _mm_loadu_ps(t+i+4)));
+    }
+    for(; i+4<=n; i+=4)
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x+i), _mm_loadu_ps(t+i)));
+    sum = hsum(_mm_add_ps(acc0, acc1));
+#endif
+    for(; i<n; i++)
+      sum += x[i]*t[i];
+    return sum;
+  }
+};
+
+/// Real taps on complex samples. Each tap is stored twice, once for the
+/// real and once for the imaginary part of its sample.
+template<>
+struct FirKernel<std::complex<float>, float, std::complex<float> >
+{
+  typedef std::complex<float> Cplx;
+  std::vector<float> taps;
+
+  void setTaps(const float* reversed, int n)
+  {
+    taps.resize(2*n);
+    for(int i=0; i<n; i++)
+      taps[2*i] = taps[2*i+1] = reversed[i];
+  }
+
+  Cplx dot(const Cplx* samples) const
+  {
+    const float* x = reinterpret_cast<const float*>(samples);
+    const float* t = taps.empty() ? NULL : &taps[0];
+    int n = taps.size();
+    int i = 0;
+    Cplx sum(0, 0);
+#ifdef IRIS_FIRENGINE_SSE2
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for(; i+8<=n; i+=8)
+    {
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x+i), _mm_loadu_ps(t+i)));
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(x+i+4), _mm_loadu_ps(t+i+4)));
+    }
+    for(; i+4<=n; i+=4)
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(x+i), _mm_loadu_ps(t+i)));
+    sum = csum(_mm_add_ps(acc0, acc1));
+#endif
+    for(; i<n; i+=2)
+      sum += Cplx(x[i]*t[i], x[i+1]*t[i+1]);
+    return sum;
+  }
+};
+
+/// Complex taps on complex samples. With a tap a+jb and a sample x+jy,
+/// the real part is x*a + y*(-b) and the imaginary part is y*a + x*b, so
+/// the taps are stored as (a,a) and (-b,b) pairs to multiply the samples
+/// and the samples with their parts swapped.
+template<>
+struct FirKernel<std::complex<float>, std::complex<float>, std::complex<float> >
+{
+  typedef std::complex<float> Cplx;
+  std::vector<float> real;
+  std::vector<float> imag;
+
+  void setTaps(const Cplx* reversed, int n)
+  {
+    real.resize(2*n);
+    imag.resize(2*n);
+    for(int i=0; i<n; i++)
+    {
+      real[2*i] = real[2*i+1] = reversed[i].real();
+      imag[2*i] = -reversed[i].imag();
+      imag[2*i+1] = reversed[i].imag();
+    }
+  }
+
+  Cplx dot(const Cplx* samples) const
+  {
+    const float* x = reinterpret_cast<const float*>(samples);
+    const float* a = real.empty() ? NULL : &real[0];
+    const float* b = imag.empty() ? NULL : &imag[0];
+    int n = real.size();
+    int i = 0;
+    Cplx sum(0, 0);
+#ifdef IRIS_FIRENGINE_SSE2
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for(; i+4<=n; i+=4)
+    {
+      __m128 v = _mm_loadu_ps(x+i);
+      __m128 swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2,3,0,1));
+      acc0 = _mm_add_ps(acc0, _mm_mul_ps(v, _mm_loadu_ps(a+i)));
+      acc1 = _mm_add_ps(acc1, _mm_mul_ps(swapped, _mm_loadu_ps(b+i)));
+    }
+    sum = csum(_mm_add_ps(acc0, acc1));
+#endif
+    for(; i<n; i+=2)
+      sum += Cplx(x[i]*a[i] + x[i+1]*b[i], x[i+1]*a[i+1] + x[i]*b[i+1]);
+    return sum;
+  }
+};
+
+} // namespace firdetail
+
+/** A block-based FIR filter engine with one or more phases.
+ *
+ * Every input sample produces one output per phase, each the dot product
+ * of the phase's taps with the most recent input samples. A single phase
+ * is a plain FIR filter. The phases of a polyphase decomposition make an
+ * interpolator which never multiplies by the zeros of upsampling. With a
+ * decimation factor as well, only every decimation'th output of the
+ * interpolator is computed, giving a rational resampler.
+ *
+ * The taps of every phase are stored time-reversed and padded at the
+ * start with zeros to a multiple of four. The input history is kept in
+ * front of the current block in one contiguous buffer, so the window of
+ * each output starts at its input sample less the padded number of taps
+ * plus one. After each block the newest history is moved back to the
+ * front of the buffer.
+ *
+ * Specialised kernels with SSE2 dot products are used for float taps on
+ * float or std::complex<float> samples and for std::complex<float> taps
+ * on std::complex<float> samples.
+ */
+template<class InT, class CoeffT = InT, class OutT = InT>
+class FirEngine
+{
+ public:
+  /// Input samples filtered per block.
+  static const int blockLength = 256;
+
+  FirEngine()
+    :numTaps_(0), historyLength_(0), numPhases_(0), decimation_(1),
+     nextPhase_(0), nextInput_(0)
+  {}
+
+  /** Set the taps of a single-phase filter.
+   *
+   * @param begin   Iterator to the first tap, applied to the newest sample.
+   * @param end     Iterator to one past the last tap.
+   */
+  template<class It>
+  void setTaps(It begin, It end)
+  {
+    setPhases(begin, end, 1);
+  }
+
+  /** Set the taps of a polyphase interpolator.
+   *
+   * Phase p of numPhases uses taps p, p+numPhases, p+2*numPhases, ... of
+   * the full filter. Its output for input sample n is output sample
+   * n*numPhases+p of the full filter run over the input upsampled by
+   * numPhases with zeros.
+   *
+   * The newest samples of the current history are kept.
+   *
+   * @param begin       Iterator to the first tap of the full filter.
+   * @param end         Iterator to one past the last tap.
+   * @param numPhases   Number of phases, i.e. the upsampling factor.
+   */
+  template<class It>
+  void setPhases(It begin, It end, int numPhases)
+  {
+    setResampling(begin, end, numPhases, 1);
+  }
+
+  /** Set the taps of a polyphase rational resampler.
+   *
+   * The output is every decimation'th output of the interpolator with
+   * numPhases phases, starting with phase 0 of the next input sample.
+   * Output k is output sample k*decimation of the full filter run over
+   * the input upsampled by numPhases with zeros.
+   *
+   * The newest samples of the current history are kept.
+   *
+   * @param begin       Iterator to the first tap of the full filter.
+   * @param end         Iterator to one past the last tap.
+   * @param numPhases   Number of phases, i.e. the upsampling factor.
+   * @param decimation  Downsampling factor applied after interpolation.
+   */
+  template<class It>
+  void setResampling(It begin, It end, int numPhases, int decimation)
+  {
+    std::vector<CoeffT> coeffs(begin, end);
+    int numCoeffs = coeffs.size();
+    numPhases_ = std::max(numPhases, 1);
+    decimation_ = std::max(decimation, 1);
+    nextPhase_ = 0;
+    nextInput_ = 0;
+    numTaps_ = (numCoeffs+numPhases_-1)/numPhases_;
+    int padded = (numTaps_+3)/4*4;
+
+    phases_.resize(numPhases_);
+    std::vector<CoeffT> reversed(padded);
+    for(int p=0; p<numPhases_; p++)
+    {
+      std::fill(reversed.begin(), reversed.end(), CoeffT());
+      for(int m=0; m<numTaps_ && p+m*numPhases_<numCoeffs; m++)
+        reversed[padded-1-m] = coeffs[p+m*numPhases_];
+      phases_[p].setTaps(reversed.empty() ? NULL : &reversed[0], padded);
+    }
+
+    // Keep the newest samples of the old history
+    int newLength = std::max(padded-1, 0);
+    std::vector<InT> buffer(newLength+blockLength);
+    int keep = std::min(newLength, historyLength_);
+    std::copy(history_.begin()+historyLength_-keep,
+              history_.begin()+historyLength_,
+              buffer.begin()+newLength-keep);
+    history_.swap(buffer);
+    historyLength_ = newLength;
+  }
+
+  /// Clear the history of the filter.
+  void reset()
+  {
+    std::fill(history_.begin(), history_.end(), InT());
+    nextPhase_ = 0;
+    nextInput_ = 0;
+  }
+
+  /// Number of taps of each phase, without padding.
+  int numTaps() const { return numTaps_; }
+
+  /// Number of phases, i.e. the upsampling factor.
+  int numPhases() const { return numPhases_; }
+
+  /// Downsampling factor applied after interpolation.
+  int decimation() const { return decimation_; }
+
+  /// Phase of the next output, i.e. its offset after the next input
+  /// sample in units of the input period divided by numPhases().
+  int nextPhase() const { return nextPhase_ + nextInput_*numPhases_; }
+
+  /// Number of outputs the next numInputs input samples will produce.
+  int numOutputs(int numInputs) const
+  {
+    long up = (long)numInputs*numPhases_ - nextPhase();
+    return up > 0 ? (int)((up+decimation_-1)/decimation_) : 0;
+  }
+
+  /** Filter a sequence of input samples.
+   *
+   * The output must have room for numOutputs() of the number of input
+   * samples.
+   *
+   * @param in      Iterator to the first input sample.
+   * @param inEnd   Iterator to one past the last input sample.
+   * @param out     Iterator to the first output sample.
+   * @return        Iterator to one past the last output sample.
+   */
+  template<class InIt, class OutIt>
+  OutIt filter(InIt in, InIt inEnd, OutIt out)
+  {
+    if(numPhases_ == 0)
+      setTaps((CoeffT*)NULL, (CoeffT*)NULL);
+
+    InT* window = &history_[0];
+    InT* block = window + historyLength_;
+    while(in != inEnd)
+    {
+      int n = 0;
+      for(; n<blockLength && in != inEnd; n++)
+        block[n] = *in++;
+
+      if(numPhases_ == 1 && decimation_ == 1)
+      {
+        const firdetail::FirKernel<InT, CoeffT, OutT>& k = phases_[0];
+        for(int i=0; i<n; i++)
+          *out++ = k.dot(window+i);
+      }
+      else if(decimation_ == 1)
+      {
+        for(int i=0; i<n; i++)
+          for(int p=0; p<numPhases_; p++)
+            *out++ = phases_[p].dot(window+i);
+      }
+      else
+      {
+        // Step through the interpolator outputs decimation_ at a time
+        int stepInput = decimation_/numPhases_;
+        int stepPhase = decimation_%numPhases_;
+        int i = nextInput_;
+        int p = nextPhase_;
+        while(i < n)
+        {
+          *out++ = phases_[p].dot(window+i);
+          i += stepInput;
+          p += stepPhase;
+          if(p >= numPhases_)
+          {
+            p -= numPhases_;
+            i++;
+          }
+        }
+        nextInput_ = i-n;
+        nextPhase_ = p;
+      }
+
+      std::copy(window+n, window+n+historyLength_, window);
+    }
+    return out;
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "FirEngine"; }
+
+ private:
+  int numTaps_;         ///< Taps per phase, without padding.
+  int historyLength_;   ///< Samples kept from previous blocks.
+  int numPhases_;       ///< Upsampling factor.
+  int decimation_;      ///< Downsampling factor after interpolation.
+  int nextPhase_;       ///< Phase of the next output.
+  int nextInput_;       ///< Input samples before the next output.
+  std::vector< firdetail::FirKernel<InT, CoeffT, OutT> > phases_;
+  std::vector<InT> history_;  ///< History followed by the current block.
+};
+
+} // namespace iris
+
+#endif // UTILITY_FIRENGINE_H_
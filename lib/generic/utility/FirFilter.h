@@ -28,17 +28,15 @@
  *
  * \section DESCRIPTION
  *
- * FIR Filter classes.
+ * FIR Filter classes, built on the block filtering of FirEngine.
  */
 
 #ifndef _FIRFILTER_H_
 #define _FIRFILTER_H_
 
 #include <vector>
-#include <deque>
-#include <algorithm>
 
-#include <boost/lambda/lambda.hpp>
+#include "utility/FirEngine.h"
 
 namespace iris
 {
@@ -56,19 +54,17 @@ public:
 
   //! constructor setting the filter coefficients
   template<class It>
-  FirFilter(It coeff_start, It coeff_end) :
-    coeffs_(coeff_start, coeff_end), sums_(coeffs_.size() + 1)
+  FirFilter(It coeff_start, It coeff_end)
   {
+    setCoeffs(coeff_start, coeff_end);
   }
 
   //! set the filter coefficients
   template<class It>
   void setCoeffs(It coeff_start, It coeff_end)
   {
-    coeffs_.clear();
-    coeffs_.assign(coeff_start, coeff_end);
-    sums_.clear();
-    sums_.resize(coeffs_.size() + 1);
+    engine_.setTaps(coeff_start, coeff_end);
+    engine_.reset();
   }
 
   //! \brief Apply filter to given input sequence, writing output to output iterator.
@@ -77,18 +73,10 @@ public:
   template<class InIt, class OutIt>
   OutIt filter(InIt istart, InIt iend, OutIt ostart)
   {
-    while (istart != iend)
-    {
-      // multiply with each coefficient & add
-      std::transform(coeffs_.begin(), coeffs_.end(), ++sums_.begin(), sums_.begin(),
-          *istart++ * boost::lambda::_1 + boost::lambda::_2);
-      *ostart++ = sums_.front();
-    }
-    return ostart;
+    return engine_.filter(istart, iend, ostart);
   }
 private:
-  std::vector<CoeffT> coeffs_; //!< coefficient vector
-  std::vector<OutT> sums_; //!< keeps sums in a delay line
+  FirEngine<InT, CoeffT, OutT> engine_; //!< block filter with the coefficients
 };
 
 //! \brief Upsampling & interpolating filter.
@@ -100,34 +88,34 @@ class FirFilterUpsamp
 {
 public:
   //! Default constructor -- no coefficients are set
-  FirFilterUpsamp()
+  FirFilterUpsamp() : factor_(1)
   {
   }
 
   //! Constructor initialising the coefficients.
   //! Also sets the upsampling factor
   template<class It>
-  FirFilterUpsamp(unsigned factor, It start, It end) :
-    coeffs_(start, end), delayLine_(coeffs_.size()), factor_(factor)
+  FirFilterUpsamp(unsigned factor, It start, It end) : factor_(factor)
   {
+    setCoeffs(start, end);
   }
 
   //! initialises the coefficients
   template<class It>
   void setCoeffs(It start, It end)
   {
-    coeffs_.clear();
     coeffs_.assign(start, end);
-    delayLine_.clear();
-    delayLine_.resize(coeffs_.size());
+    engine_.setPhases(coeffs_.begin(), coeffs_.end(), factor_);
+    engine_.reset();
   }
 
   std::vector<CoeffT> getCoeffs() { return coeffs_; }
 
-  //! set the upsampling factor of the filter
+  //! set the upsampling factor of the filter, keeping its history
   void setUpsamplingFactor(unsigned factor)
   {
     factor_ = factor;
+    engine_.setPhases(coeffs_.begin(), coeffs_.end(), factor_);
   }
 
   //! \brief Apply filter to given input sequence, writing output to output iterator.
@@ -136,40 +124,13 @@ public:
   template<class InIt, class OutIt>
   OutIt filter(InIt istart, InIt iend, OutIt ostart)
   {
-    while (istart != iend)
-    {
-      delayLine_.pop_back();
-      delayLine_.push_front(*istart++);
-
-      OutIt oend = ostart;
-      advance(oend, factor_);
-      coeff_iterator coeff_start = coeffs_.begin();
-      coeff_iterator cend = coeffs_.end();
-      while (ostart != oend)
-      {
-        *ostart = OutT();
-        delay_iterator di = delayLine_.begin();
-        coeff_iterator ci = coeff_start++;
-        while (ci < cend)
-        {
-          *ostart += *ci * *di++;
-          ci += factor_;
-        }
-        ostart++;
-      }
-    }
-    return ostart;
+    return engine_.filter(istart, iend, ostart);
   }
 
 private:
   std::vector<CoeffT> coeffs_; //!< vector holding the coefficients
-  std::deque<InT> delayLine_; //!< vector holding the delay line
+  FirEngine<InT, CoeffT, OutT> engine_; //!< polyphase filter, one phase per output
   unsigned factor_; //!< upsampling factor
-
-  //! iterator type for the coefficients vector
-  typedef typename std::vector<CoeffT>::iterator coeff_iterator;
-  //! iterator type for the delay line deque
-  typedef typename std::deque<InT>::iterator delay_iterator;
 };
 
 } // end of iris namespace
@@ -0,0 +1,120 @@
+/**
+ * \file SharedTables.h
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Read-only tables shared by every object of a process.
+ *
+ * Lookup tables, constellations and preambles are the same for every
+ * component instance which uses them. Building them once and sharing
+ * them keeps a single copy in the cache however many channels are run,
+ * and makes creating all but the first instance cheap.
+ */
+
+#ifndef UTILITY_SHAREDTABLES_H_
+#define UTILITY_SHAREDTABLES_H_
+
+#include <map>
+#include <string>
+#include <boost/shared_ptr.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/thread/recursive_mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace iris
+{
+
+/** Lazily created, immutable tables shared by all users in a process.
+ *
+ * A table is any class T which builds its contents in its constructor
+ * and is only read afterwards. get<T>() creates the single table of
+ * type T on first use and keeps it for the life of the process.
+ * get<T>(key) creates a table with T(key) for each key, e.g. for each
+ * set of OFDM parameters, and keeps it for as long as one of its users
+ * holds on to it.
+ *
+ * Tables are created under a single lock, so that the first users on
+ * different threads wait for one table rather than each building their
+ * own. The lock is recursive, which allows the constructor of a table
+ * to get the other tables it is built from.
+ */
+class SharedTables
+{
+ public:
+  /** Get the table of type T, creating it on first use.
+   *
+   * @return  The table, never null.
+   */
+  template <class T>
+  static boost::shared_ptr<const T> get()
+  {
+    boost::lock_guard< boost::recursive_mutex > lock(mutex());
+    static boost::shared_ptr<const T> table;
+    if(!table)
+      table.reset(new T);
+    return table;
+  }
+
+  /** Get the table of type T for a key, creating it if it has no users.
+   *
+   * @param key   Parameters of the table, passed to the constructor of T.
+   *              Key must be less-than comparable.
+   * @return      The table, never null.
+   */
+  template <class T, class Key>
+  static boost::shared_ptr<const T> get(const Key& key)
+  {
+    typedef std::map< Key, boost::weak_ptr<const T> > Cache;
+
+    boost::lock_guard< boost::recursive_mutex > lock(mutex());
+    static Cache cache;
+    boost::weak_ptr<const T>& entry = cache[key];
+    boost::shared_ptr<const T> table = entry.lock();
+    if(!table)
+    {
+      table.reset(new T(key));
+      entry = table;
+    }
+    return table;
+  }
+
+  /// Convenience function for logging.
+  std::string getName(){ return "SharedTables"; }
+
+ private:
+  /// Lock held while looking up or creating a table.
+  static boost::recursive_mutex& mutex()
+  {
+    static boost::recursive_mutex m;
+    return m;
+  }
+};
+
+} // namespace iris
+
+#endif // UTILITY_SHAREDTABLES_H_
@@ -0,0 +1,166 @@
+/**
+ * \file lib/generic/utility/test/DebugCapture_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for DebugCapture class.
+ */
+
+#define BOOST_TEST_MODULE DebugCapture_Test
+
+#include "DebugCapture.h"
+#include <complex>
+#include <cstdio>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float> Cplx;
+
+static const char* fileName = "DebugCapture_test.cap";
+
+static vector<string> stageNames()
+{
+  vector<string> names;
+  names.push_back("Bins");
+  names.push_back("Symbols");
+  names.push_back("Bytes");
+  return names;
+}
+
+BOOST_AUTO_TEST_SUITE (DebugCapture_Test)
+
+BOOST_AUTO_TEST_CASE(DebugCapture_Basic_Test)
+{
+  DebugCapture cap;
+  BOOST_CHECK(!cap.isOpen());
+  BOOST_CHECK(!cap.wants(0, 0));
+  Cplx c[4];
+  BOOST_CHECK(!cap.capture(0, 0, 0, c, c+4));
+}
+
+BOOST_AUTO_TEST_CASE(DebugCapture_RoundTrip_Test)
+{
+  vector<Cplx> bins(64);
+  for(int i=0; i<bins.size(); i++)
+    bins[i] = Cplx(i, -i);
+  vector<uint8_t> bytes(10);
+  for(int i=0; i<bytes.size(); i++)
+    bytes[i] = i;
+
+  {
+    DebugCapture cap;
+    cap.open(fileName, stageNames(), 0x5, 1, 16, 1024);
+    BOOST_REQUIRE(cap.isOpen());
+    for(int frame=0; frame<3; frame++)
+    {
+      for(int sym=0; sym<2; sym++)
+      {
+        BOOST_CHECK(cap.capture(0, frame, sym, &bins[0], &bins[0]+64));
+        BOOST_CHECK(!cap.capture(1, frame, sym, &bins[0], &bins[0]+64));
+      }
+      BOOST_CHECK(cap.capture(2, frame, 0, &bytes[0], &bytes[0]+10));
+    }
+    cap.close();
+    BOOST_CHECK(cap.getNumDropped() == 0);
+  }
+
+  vector<string> names;
+  vector<DebugCapture::Record> records;
+  DebugCapture::read(fileName, names, records);
+  BOOST_CHECK(names == stageNames());
+  BOOST_REQUIRE(records.size() == 9);
+  for(int frame=0; frame<3; frame++)
+  {
+    for(int sym=0; sym<2; sym++)
+    {
+      DebugCapture::Record& r = records[frame*3+sym];
+      BOOST_CHECK(r.stage == 0);
+      BOOST_CHECK(r.frame == frame);
+      BOOST_CHECK(r.index == sym);
+      BOOST_CHECK(r.elementSize == sizeof(Cplx));
+      BOOST_REQUIRE(r.data.size() == 64*sizeof(Cplx));
+      BOOST_CHECK(memcmp(&r.data[0], &bins[0], r.data.size()) == 0);
+    }
+    DebugCapture::Record& r = records[frame*3+2];
+    BOOST_CHECK(r.stage == 2);
+    BOOST_CHECK(r.elementSize == 1);
+    BOOST_REQUIRE(r.data.size() == 10);
+    BOOST_CHECK(memcmp(&r.data[0], &bytes[0], 10) == 0);
+  }
+  remove(fileName);
+}
+
+BOOST_AUTO_TEST_CASE(DebugCapture_Interval_Test)
+{
+  DebugCapture cap;
+  cap.open(fileName, stageNames(), 0xFFFFFFFF, 4, 16, 64);
+  uint8_t b[8] = {0};
+  for(int frame=0; frame<16; frame++)
+  {
+    BOOST_CHECK(cap.wants(2, frame) == (frame%4 == 0));
+    cap.capture(2, frame, 0, b, b+8);
+  }
+  cap.close();
+
+  vector<string> names;
+  vector<DebugCapture::Record> records;
+  DebugCapture::read(fileName, names, records);
+  BOOST_REQUIRE(records.size() == 4);
+  for(int i=0; i<4; i++)
+    BOOST_CHECK(records[i].frame == i*4);
+  remove(fileName);
+}
+
+BOOST_AUTO_TEST_CASE(DebugCapture_Overflow_Test)
+{
+  DebugCapture cap;
+  cap.open(fileName, stageNames(), 0xFFFFFFFF, 1, 4, 64);
+
+  // Records larger than a slot are dropped
+  uint8_t big[128] = {0};
+  BOOST_CHECK(!cap.capture(2, 0, 0, big, big+128));
+
+  // Capture never blocks, so records may be dropped when the ring is full
+  int numCaptured = 0;
+  for(int i=0; i<1000; i++)
+    numCaptured += cap.capture(2, 0, i, big, big+64);
+  cap.close();
+  BOOST_CHECK(numCaptured + cap.getNumDropped() == 1001);
+
+  vector<string> names;
+  vector<DebugCapture::Record> records;
+  DebugCapture::read(fileName, names, records);
+  BOOST_CHECK(records.size() == numCaptured);
+  for(int i=1; i<records.size(); i++)
+    BOOST_CHECK(records[i].index > records[i-1].index);
+  remove(fileName);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,159 @@
+/**
+ * \file lib/generic/utility/test/FastFirFilter_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for FastFirFilter class.
+ */
+
+#define BOOST_TEST_MODULE FastFirFilter_Test
+
+#include "FastFirFilter.h"
+#include <complex>
+#include <cstdlib>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float> Cplx;
+
+/// Direct form FIR filter, used as a reference.
+template<class CoeffT>
+static vector<Cplx> directFilter(const vector<CoeffT>& coeffs,
+                                 const vector<Cplx>& in)
+{
+  vector<Cplx> out(in.size());
+  for(size_t n=0; n<in.size(); n++)
+    for(size_t k=0; k<coeffs.size() && k<=n; k++)
+      out[n] += in[n-k]*coeffs[k];
+  return out;
+}
+
+static float randf()
+{
+  return rand()/(float)RAND_MAX - 0.5f;
+}
+
+static void randomize(vector<float>& v)
+{
+  for(size_t i=0; i<v.size(); i++)
+    v[i] = randf();
+}
+
+static void randomize(vector<Cplx>& v)
+{
+  for(size_t i=0; i<v.size(); i++)
+    v[i] = Cplx(randf(), randf());
+}
+
+/// Filter in pieces of varying length, some shorter than a block.
+template<class CoeffT>
+static vector<Cplx> filterInPieces(FastFirFilter<CoeffT>& f,
+                                   const vector<Cplx>& in)
+{
+  vector<Cplx> out(in.size());
+  size_t i = 0;
+  vector<Cplx>::iterator it = out.begin();
+  for(int piece=1; i<in.size(); piece = piece*7%1999+1)
+  {
+    size_t len = min((size_t)piece, in.size()-i);
+    it = f.filter(in.begin()+i, in.begin()+i+len, it);
+    i += len;
+  }
+  BOOST_CHECK(it == out.end());
+  return out;
+}
+
+template<class CoeffT>
+static void testMethod(int numTaps,
+                       typename FastFirFilter<CoeffT>::Method method)
+{
+  vector<CoeffT> coeffs(numTaps);
+  vector<Cplx> in(5000);
+  randomize(coeffs);
+  randomize(in);
+
+  FastFirFilter<CoeffT> f(coeffs.begin(), coeffs.end(), 0, method);
+  vector<Cplx> out = filterInPieces(f, in);
+  vector<Cplx> ref = directFilter(coeffs, in);
+  for(size_t i=0; i<in.size(); i++)
+    BOOST_CHECK_SMALL(abs(out[i]-ref[i]), 1e-4f);
+}
+
+BOOST_AUTO_TEST_SUITE (FastFirFilter_Test)
+
+BOOST_AUTO_TEST_CASE(FastFirFilter_Fft_Test)
+{
+  int lengths[] = {1, 2, 17, 64, 255, 513};
+  for(int i=0; i<6; i++)
+  {
+    testMethod<float>(lengths[i], FastFirFilter<float>::FFT);
+    testMethod<Cplx>(lengths[i], FastFirFilter<Cplx>::FFT);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FastFirFilter_Direct_Test)
+{
+  testMethod<float>(33, FastFirFilter<float>::DIRECT);
+  testMethod<Cplx>(33, FastFirFilter<Cplx>::DIRECT);
+}
+
+BOOST_AUTO_TEST_CASE(FastFirFilter_Auto_Test)
+{
+  vector<float> shortTaps(8, 0.1f), longTaps(512, 0.1f);
+  FastFirFilter<float> s(shortTaps.begin(), shortTaps.end());
+  FastFirFilter<float> l(longTaps.begin(), longTaps.end());
+  BOOST_CHECK(!s.usesFft());
+  BOOST_CHECK(l.usesFft());
+  BOOST_CHECK(l.fftLength() > 512);
+
+  // Short calls share the transforms between fewer outputs
+  BOOST_CHECK(FastFirFilter<float>::fftLengthFor(128, 16, false) == 0);
+  BOOST_CHECK(FastFirFilter<float>::fftLengthFor(128, 16, true) > 0);
+}
+
+BOOST_AUTO_TEST_CASE(FastFirFilter_Reset_Test)
+{
+  vector<float> coeffs(100);
+  vector<Cplx> in(300);
+  randomize(coeffs);
+  randomize(in);
+
+  FastFirFilter<float> f(coeffs.begin(), coeffs.end(), 0,
+                         FastFirFilter<float>::FFT);
+  vector<Cplx> a(300), b(300);
+  f.filter(in.begin(), in.end(), a.begin());
+  f.reset();
+  f.filter(in.begin(), in.end(), b.begin());
+  for(size_t i=0; i<a.size(); i++)
+    BOOST_CHECK_SMALL(abs(a[i]-b[i]), 1e-6f);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
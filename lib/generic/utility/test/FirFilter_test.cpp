@@ -0,0 +1,250 @@
+/**
+ * \file lib/generic/utility/test/FirFilter_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for FirFilter, FirFilterUpsamp and FirEngine classes.
+ */
+
+#define BOOST_TEST_MODULE FirFilter_Test
+
+#include "FirFilter.h"
+#include <complex>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+typedef complex<float> Cplx;
+
+/// Direct form FIR filter, used as a reference.
+template<class InT, class CoeffT, class OutT>
+static vector<OutT> directFilter(const vector<CoeffT>& coeffs,
+                                 const vector<InT>& in)
+{
+  vector<OutT> out(in.size());
+  for(size_t n=0; n<in.size(); n++)
+    for(size_t k=0; k<coeffs.size() && k<=n; k++)
+      out[n] += in[n-k]*coeffs[k];
+  return out;
+}
+
+/// Upsampling followed by a direct form FIR filter, used as a reference.
+template<class InT, class CoeffT, class OutT>
+static vector<OutT> directUpsamp(unsigned factor,
+                                 const vector<CoeffT>& coeffs,
+                                 const vector<InT>& in)
+{
+  vector<InT> up(in.size()*factor);
+  for(size_t n=0; n<in.size(); n++)
+    up[n*factor] = in[n];
+  return directFilter<InT, CoeffT, OutT>(coeffs, up);
+}
+
+static float randf()
+{
+  return rand()/(float)RAND_MAX - 0.5f;
+}
+
+template<class T>
+static void randomize(vector<T>& v)
+{
+  for(size_t i=0; i<v.size(); i++)
+    v[i] = randf();
+}
+
+static void randomize(vector<Cplx>& v)
+{
+  for(size_t i=0; i<v.size(); i++)
+    v[i] = Cplx(randf(), randf());
+}
+
+/// Filter in pieces of varying length to exercise the block boundaries.
+template<class Filter, class InT, class OutT>
+static void filterInPieces(Filter& f, const vector<InT>& in,
+                           vector<OutT>& out, int outPerIn)
+{
+  out.resize(in.size()*outPerIn);
+  size_t i = 0;
+  typename vector<OutT>::iterator it = out.begin();
+  for(int piece=1; i<in.size(); piece = piece*3%601+1)
+  {
+    size_t len = min((size_t)piece, in.size()-i);
+    it = f.filter(in.begin()+i, in.begin()+i+len, it);
+    i += len;
+  }
+  BOOST_CHECK(it == out.end());
+}
+
+template<class OutT>
+static void checkClose(const vector<OutT>& a, const vector<OutT>& b)
+{
+  BOOST_REQUIRE_EQUAL(a.size(), b.size());
+  for(size_t i=0; i<a.size(); i++)
+    BOOST_CHECK_SMALL((float)abs(a[i]-b[i]), 1e-5f);
+}
+
+template<class InT, class CoeffT, class OutT>
+static void testFilter(int numCoeffs, int numSamples)
+{
+  vector<CoeffT> coeffs(numCoeffs);
+  vector<InT> in(numSamples);
+  randomize(coeffs);
+  randomize(in);
+
+  FirFilter<InT, CoeffT, OutT> f(coeffs.begin(), coeffs.end());
+  vector<OutT> out;
+  filterInPieces(f, in, out, 1);
+  checkClose(out, directFilter<InT, CoeffT, OutT>(coeffs, in));
+}
+
+template<class InT, class CoeffT, class OutT>
+static void testUpsamp(unsigned factor, int numCoeffs, int numSamples)
+{
+  vector<CoeffT> coeffs(numCoeffs);
+  vector<InT> in(numSamples);
+  randomize(coeffs);
+  randomize(in);
+
+  FirFilterUpsamp<InT, CoeffT, OutT> f(factor, coeffs.begin(), coeffs.end());
+  vector<OutT> out;
+  filterInPieces(f, in, out, factor);
+  checkClose(out, directUpsamp<InT, CoeffT, OutT>(factor, coeffs, in));
+}
+
+template<class InT, class CoeffT, class OutT>
+static void testResampling(int up, int down, int numCoeffs, int numSamples)
+{
+  vector<CoeffT> coeffs(numCoeffs);
+  vector<InT> in(numSamples);
+  randomize(coeffs);
+  randomize(in);
+
+  FirEngine<InT, CoeffT, OutT> f;
+  f.setResampling(coeffs.begin(), coeffs.end(), up, down);
+  vector<OutT> out;
+  size_t i = 0;
+  for(int piece=1; i<in.size(); piece = piece*3%601+1)
+  {
+    size_t len = min((size_t)piece, in.size()-i);
+    size_t pos = out.size();
+    out.resize(pos + f.numOutputs(len));
+    typename vector<OutT>::iterator it;
+    it = f.filter(in.begin()+i, in.begin()+i+len, out.begin()+pos);
+    BOOST_REQUIRE(it == out.end());
+    i += len;
+  }
+
+  vector<OutT> full = directUpsamp<InT, CoeffT, OutT>(up, coeffs, in);
+  vector<OutT> ref;
+  for(size_t k=0; k<full.size(); k+=down)
+    ref.push_back(full[k]);
+  checkClose(out, ref);
+}
+
+BOOST_AUTO_TEST_SUITE (FirFilter_Test)
+
+BOOST_AUTO_TEST_CASE(FirFilter_Real_Test)
+{
+  int lengths[] = {1, 3, 4, 7, 8, 33, 64, 301};
+  for(int i=0; i<8; i++)
+    testFilter<float, float, float>(lengths[i], 2000);
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_ComplexRealTaps_Test)
+{
+  int lengths[] = {1, 3, 4, 7, 8, 33, 64, 301};
+  for(int i=0; i<8; i++)
+    testFilter<Cplx, float, Cplx>(lengths[i], 2000);
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_ComplexTaps_Test)
+{
+  int lengths[] = {1, 3, 4, 7, 8, 33, 64, 301};
+  for(int i=0; i<8; i++)
+    testFilter<Cplx, Cplx, Cplx>(lengths[i], 2000);
+}
+
+BOOST_AUTO_TEST_CASE(FirFilter_Generic_Test)
+{
+  // Double precision uses the generic kernel
+  testFilter<double, double, double>(17, 1000);
+}
+
+BOOST_AUTO_TEST_CASE(FirFilterUpsamp_Test)
+{
+  int lengths[] = {1, 5, 16, 31, 96};
+  for(unsigned factor=1; factor<=4; factor++)
+  {
+    for(int i=0; i<5; i++)
+    {
+      testUpsamp<float, float, float>(factor, lengths[i], 700);
+      testUpsamp<Cplx, float, Cplx>(factor, lengths[i], 700);
+      testUpsamp<Cplx, Cplx, Cplx>(factor, lengths[i], 700);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(FirFilterUpsamp_SetFactor_Test)
+{
+  // Changing the factor keeps the history of the filter
+  vector<float> coeffs(12);
+  randomize(coeffs);
+  vector<float> in(20);
+  randomize(in);
+
+  FirFilterUpsamp<float> f(2, coeffs.begin(), coeffs.end());
+  vector<float> out(20*3);
+  f.filter(in.begin(), in.begin()+10, out.begin());
+  f.setUpsamplingFactor(3);
+  f.filter(in.begin()+10, in.end(), out.begin());
+
+  FirFilterUpsamp<float> g(3, coeffs.begin(), coeffs.end());
+  vector<float> ref(20*3);
+  g.filter(in.begin(), in.end(), ref.begin());
+  for(int i=0; i<30; i++)
+    BOOST_CHECK_SMALL(out[i]-ref[30+i], 1e-5f);
+}
+
+BOOST_AUTO_TEST_CASE(FirEngine_Resampling_Test)
+{
+  int ratios[][2] = {{1,2}, {1,5}, {2,3}, {3,2}, {5,7}, {7,5}, {4,4}, {3,1}};
+  for(int r=0; r<8; r++)
+  {
+    int up = ratios[r][0];
+    int down = ratios[r][1];
+    testResampling<float, float, float>(up, down, 13*up, 1500);
+    testResampling<Cplx, float, Cplx>(up, down, 13*up+5, 1500);
+    testResampling<Cplx, Cplx, Cplx>(up, down, 2, 1500);
+  }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
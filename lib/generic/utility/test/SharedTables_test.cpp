@@ -0,0 +1,139 @@
+/**
+ * \file lib/generic/utility/test/SharedTables_test.cpp
+ * \version 1.0
+ *
+ * \section COPYRIGHT
+ *
+ * Copyright 2012-2013 The Iris Project Developers. See the
+ * COPYRIGHT file at the top-level directory of this distribution
+ * and at http://www.softwareradiosystems.com/iris/copyright.html.
+ *
+ * \section LICENSE
+ *
+ * This file is part of the Iris Project.
+ *
+ * Iris is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation, either version 3 of
+ * the License, or (at your option) any later version.
+ *
+ * Iris is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * A copy of the GNU Lesser General Public License can be found in
+ * the LICENSE file in the top-level directory of this distribution
+ * and at http://www.gnu.org/licenses/.
+ *
+ * \section DESCRIPTION
+ *
+ * Main test file for SharedTables class.
+ */
+
+#define BOOST_TEST_MODULE SharedTables_Test
+
+#include "SharedTables.h"
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+using namespace iris;
+
+/// A table which counts how often it has been built.
+struct CountedTable
+{
+  static int numBuilt;
+  vector<int> values;
+
+  CountedTable()
+    :values(1024, 1)
+  {
+    numBuilt++;
+  }
+};
+int CountedTable::numBuilt = 0;
+
+/// A table built from a key, which counts how many exist.
+struct KeyedTable
+{
+  static int numAlive;
+  vector<int> values;
+
+  explicit KeyedTable(int key)
+    :values(key, key)
+  {
+    numAlive++;
+  }
+  ~KeyedTable()
+  {
+    numAlive--;
+  }
+};
+int KeyedTable::numAlive = 0;
+
+/// A table built from other shared tables.
+struct NestedTable
+{
+  boost::shared_ptr<const CountedTable> counted;
+  boost::shared_ptr<const KeyedTable> keyed;
+
+  NestedTable()
+    :counted(SharedTables::get<CountedTable>()),
+     keyed(SharedTables::get<KeyedTable>(4))
+  {}
+};
+
+static void getCounted(boost::shared_ptr<const CountedTable>* out)
+{
+  *out = SharedTables::get<CountedTable>();
+}
+
+BOOST_AUTO_TEST_SUITE (SharedTables_Test)
+
+BOOST_AUTO_TEST_CASE(SharedTables_Threads_Test)
+{
+  // The first users on several threads must all get the same table
+  const int numThreads = 8;
+  vector< boost::shared_ptr<const CountedTable> > tables(numThreads);
+  boost::thread_group threads;
+  for(int i=0; i<numThreads; i++)
+    threads.create_thread(boost::bind(&getCounted, &tables[i]));
+  threads.join_all();
+
+  BOOST_CHECK_EQUAL(CountedTable::numBuilt, 1);
+  for(int i=0; i<numThreads; i++)
+    BOOST_CHECK(tables[i] == tables[0]);
+  BOOST_CHECK(SharedTables::get<CountedTable>() == tables[0]);
+}
+
+BOOST_AUTO_TEST_CASE(SharedTables_Keyed_Test)
+{
+  boost::shared_ptr<const KeyedTable> a = SharedTables::get<KeyedTable>(16);
+  boost::shared_ptr<const KeyedTable> b = SharedTables::get<KeyedTable>(16);
+  boost::shared_ptr<const KeyedTable> c = SharedTables::get<KeyedTable>(32);
+  BOOST_CHECK(a == b);
+  BOOST_CHECK(a != c);
+  BOOST_CHECK_EQUAL(a->values.size(), 16u);
+  BOOST_CHECK_EQUAL(c->values.size(), 32u);
+  BOOST_CHECK_EQUAL(KeyedTable::numAlive, 2);
+
+  // A keyed table is freed with its last user and rebuilt if needed again
+  a.reset();
+  BOOST_CHECK_EQUAL(KeyedTable::numAlive, 2);
+  b.reset();
+  BOOST_CHECK_EQUAL(KeyedTable::numAlive, 1);
+  a = SharedTables::get<KeyedTable>(16);
+  BOOST_CHECK_EQUAL(KeyedTable::numAlive, 2);
+}
+
+BOOST_AUTO_TEST_CASE(SharedTables_Nested_Test)
+{
+  boost::shared_ptr<const NestedTable> t = SharedTables::get<NestedTable>();
+  BOOST_CHECK(t->counted == SharedTables::get<CountedTable>());
+  BOOST_CHECK(t->keyed == SharedTables::get<KeyedTable>(4));
+}
+
+BOOST_AUTO_TEST_SUITE_END()